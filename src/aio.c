@@ -0,0 +1,576 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+#include "aio.h"
+
+/*
+ * Two backends behind one request table. With io_uring each request is
+ * one submission at a time, tagged with its DSAioOp; the completion
+ * queue has twice the submission entries, so it cannot overflow with
+ * at most depth requests out. Without it, a few I/O threads of their
+ * own (not the CPU pool of parallel.c, which must not block) run
+ * pread/pwrite. Both hand finished requests to ds_aio_poll through the
+ * finished list, which is LIFO and reversed on delivery.
+ */
+#define DS_AIO_THREADS 4
+#define DS_AIO_PIECE   (1u << 30)   /* largest single transfer handed to the kernel */
+
+#define DS_AIO_WRITE 0
+#define DS_AIO_READ  1
+
+struct DSAioOp {
+    struct DSVector *vec;
+    DSAioCallback cb;
+    void *arg;
+    UINT8 *buf;
+    UINT64 offset;
+    UINT64 length;
+    UINT64 done;
+    INT64 result;
+    INT32 fd;
+    INT32 buf_index;        /* registered buffer, -1 for none */
+    UINT32 kind;            /* DS_AIO_WRITE or DS_AIO_READ */
+    struct DSAioOp *next;   /* free, queued or finished list */
+};
+
+#if defined(__linux__)
+struct DSUring {
+    int fd;
+    UINT8 *rings;           /* submission and completion rings, one mapping */
+    size_t rings_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    UINT32 *sq_tail;
+    UINT32 *sq_array;
+    UINT32 sq_mask;
+    UINT32 *cq_head;
+    UINT32 *cq_tail;
+    UINT32 cq_mask;
+    struct io_uring_cqe *cqes;
+    UINT32 unsubmitted;     /* queued submissions the kernel has not taken yet */
+    struct iovec *buffers;  /* registered storage */
+    UINT32 nbuffers;
+};
+#endif
+
+struct DSAio {
+    struct DSAioOp *ops;
+    struct DSAioOp *free_ops;
+    UINT32 depth;
+    UINT32 pending;
+    MYBOOL uring;
+#if defined(__linux__)
+    struct DSUring ring;
+#endif
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    struct DSAioOp *queue_head; /* submitted to the I/O threads, FIFO */
+    struct DSAioOp *queue_tail;
+    struct DSAioOp *finished;
+    pthread_t threads[DS_AIO_THREADS];
+    UINT32 nthreads;
+    MYBOOL stop;
+};
+
+static void ds_aio_finish(struct DSAio *aio, struct DSAioOp *op)
+{
+    pthread_mutex_lock(&aio->lock);
+    op->next = aio->finished;
+    aio->finished = op;
+    pthread_cond_signal(&aio->done);
+    pthread_mutex_unlock(&aio->lock);
+}
+
+/* private function to account for res more bytes, returns TRUE when op is complete */
+static MYBOOL ds_aio_advance(struct DSAioOp *op, INT64 res)
+{
+    if (res == -EINTR || res == -EAGAIN) {
+        return FALSE;
+    }
+    if (res < 0) {
+        op->result = res;
+        return TRUE;
+    }
+    op->done += (UINT64)res;
+    if (res == 0 || op->done == op->length) {
+        op->result = (INT64)op->done;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static UINT64 ds_aio_piece(struct DSAioOp *op)
+{
+    UINT64 left = op->length - op->done;
+    return left > DS_AIO_PIECE ? DS_AIO_PIECE : left;
+}
+
+#if defined(__linux__)
+static int ds_uring_enter(struct DSUring *ring, UINT32 to_submit, UINT32 min_complete, UINT32 flags)
+{
+    return (int)syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static MYBOOL ds_uring_init(struct DSUring *ring, UINT32 depth)
+{
+    struct io_uring_params params;
+    size_t sq_size, cq_size;
+    void *mem;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, depth, &params);
+    if (ring->fd < 0) {
+        return FALSE;
+    }
+    /* IORING_OP_READ and IORING_OP_WRITE came with IORING_FEAT_RW_CUR_POS */
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_RW_CUR_POS)) {
+        close(ring->fd);
+        return FALSE;
+    }
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(UINT32);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->rings_size = sq_size > cq_size ? sq_size : cq_size;
+    mem = mmap(NULL, ring->rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (mem == MAP_FAILED) {
+        close(ring->fd);
+        return FALSE;
+    }
+    ring->rings = (UINT8 *)mem;
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    mem = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (mem == MAP_FAILED) {
+        munmap(ring->rings, ring->rings_size);
+        close(ring->fd);
+        return FALSE;
+    }
+    ring->sqes = (struct io_uring_sqe *)mem;
+    ring->sq_tail = (UINT32 *)(ring->rings + params.sq_off.tail);
+    ring->sq_array = (UINT32 *)(ring->rings + params.sq_off.array);
+    ring->sq_mask = *(UINT32 *)(ring->rings + params.sq_off.ring_mask);
+    ring->cq_head = (UINT32 *)(ring->rings + params.cq_off.head);
+    ring->cq_tail = (UINT32 *)(ring->rings + params.cq_off.tail);
+    ring->cq_mask = *(UINT32 *)(ring->rings + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(ring->rings + params.cq_off.cqes);
+    return TRUE;
+}
+
+static void ds_uring_unregister(struct DSUring *ring)
+{
+    if (ring->buffers) {
+        syscall(__NR_io_uring_register, ring->fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+        free(ring->buffers);
+        ring->buffers = NULL;
+        ring->nbuffers = 0;
+    }
+}
+
+static void ds_uring_free(struct DSUring *ring)
+{
+    ds_uring_unregister(ring);
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->rings, ring->rings_size);
+    close(ring->fd);
+}
+
+/* returns the registered buffer holding [buf, buf + length), -1 for none */
+static INT32 ds_uring_buffer(struct DSUring *ring, const UINT8 *buf, UINT64 length)
+{
+    UINT32 i;
+    const UINT8 *base;
+
+    for (i = 0; i < ring->nbuffers; ++i) {
+        base = (const UINT8 *)ring->buffers[i].iov_base;
+        if (buf >= base && (size_t)(buf - base) <= ring->buffers[i].iov_len
+            && length <= ring->buffers[i].iov_len - (size_t)(buf - base)) {
+            return (INT32)i;
+        }
+    }
+    return -1;
+}
+
+/* queues the next piece of op; the ring has room, every op holds at most one entry */
+static void ds_uring_push(struct DSUring *ring, struct DSAioOp *op)
+{
+    UINT32 tail = *ring->sq_tail, index = tail & ring->sq_mask;
+    struct io_uring_sqe *sqe = ring->sqes + index;
+    MYBOOL fixed = op->buf_index >= 0;
+
+    memset(sqe, 0, sizeof(*sqe));
+    if (op->kind == DS_AIO_WRITE) {
+        sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    } else {
+        sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    }
+    sqe->fd = op->fd;
+    sqe->off = op->offset + op->done;
+    sqe->addr = (UINT64)(size_t)(op->buf + op->done);
+    sqe->len = (UINT32)ds_aio_piece(op);
+    sqe->buf_index = fixed ? (UINT16)op->buf_index : 0;
+    sqe->user_data = (UINT64)(size_t)op;
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++ring->unsubmitted;
+}
+
+/* submits what is queued, optionally waits for a completion, and moves finished ops to the list */
+static void ds_uring_reap(struct DSAio *aio, MYBOOL wait)
+{
+    struct DSUring *ring = &aio->ring;
+    UINT32 head, tail;
+    struct DSAioOp *op;
+    int n;
+
+    n = ds_uring_enter(ring, ring->unsubmitted, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0);
+    if (n > 0) {
+        ring->unsubmitted -= (UINT32)n;
+    }
+    head = *ring->cq_head;
+    tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = ring->cqes + (head & ring->cq_mask);
+        op = (struct DSAioOp *)(size_t)cqe->user_data;
+        ++head;
+        if (ds_aio_advance(op, cqe->res)) {
+            ds_aio_finish(aio, op);
+        } else {
+            ds_uring_push(ring, op);
+        }
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+#endif
+
+/* runs op to completion with blocking calls, on an I/O thread */
+static void ds_aio_transfer(struct DSAioOp *op)
+{
+    ssize_t n;
+
+    do {
+        if (op->kind == DS_AIO_WRITE) {
+            n = pwrite(op->fd, op->buf + op->done, (size_t)ds_aio_piece(op), (off_t)(op->offset + op->done));
+        } else {
+            n = pread(op->fd, op->buf + op->done, (size_t)ds_aio_piece(op), (off_t)(op->offset + op->done));
+        }
+    } while (!ds_aio_advance(op, n < 0 ? -(INT64)errno : (INT64)n));
+}
+
+static void *ds_aio_worker(void *arg)
+{
+    struct DSAio *aio = (struct DSAio *)arg;
+    struct DSAioOp *op;
+
+    pthread_mutex_lock(&aio->lock);
+    for (;;) {
+        while (!aio->queue_head && !aio->stop) {
+            pthread_cond_wait(&aio->work, &aio->lock);
+        }
+        op = aio->queue_head;
+        if (!op) {
+            break;
+        }
+        aio->queue_head = op->next;
+        if (!aio->queue_head) {
+            aio->queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&aio->lock);
+        ds_aio_transfer(op);
+        pthread_mutex_lock(&aio->lock);
+        op->next = aio->finished;
+        aio->finished = op;
+        pthread_cond_signal(&aio->done);
+    }
+    pthread_mutex_unlock(&aio->lock);
+    return NULL;
+}
+
+struct DSAio *ds_aio_create(UINT32 depth, UINT32 flags)
+{
+    struct DSAio *aio;
+    UINT32 i;
+
+    if (depth == 0 || depth > DS_AIO_MAX_DEPTH) {
+        return NULL;
+    }
+    aio = (struct DSAio *)calloc(1, sizeof(struct DSAio));
+    if (!aio) {
+        return NULL;
+    }
+    aio->ops = (struct DSAioOp *)calloc(depth, sizeof(struct DSAioOp));
+    if (!aio->ops) {
+        free(aio);
+        return NULL;
+    }
+    aio->depth = depth;
+    for (i = 0; i < depth; ++i) {
+        aio->ops[i].next = i + 1 < depth ? aio->ops + i + 1 : NULL;
+    }
+    aio->free_ops = aio->ops;
+    pthread_mutex_init(&aio->lock, NULL);
+    pthread_cond_init(&aio->work, NULL);
+    pthread_cond_init(&aio->done, NULL);
+
+#if defined(__linux__)
+    if (!(flags & DS_AIO_THREAD_POOL) && ds_uring_init(&aio->ring, depth)) {
+        aio->uring = TRUE;
+        return aio;
+    }
+#endif
+    while (aio->nthreads < DS_AIO_THREADS && aio->nthreads < depth
+           && pthread_create(aio->threads + aio->nthreads, NULL, ds_aio_worker, aio) == 0) {
+        ++aio->nthreads;
+    }
+    if (aio->nthreads == 0) {
+        ds_aio_destroy(aio);
+        return NULL;
+    }
+    return aio;
+}
+
+void ds_aio_destroy(struct DSAio *aio)
+{
+    UINT32 i;
+
+    if (!aio) {
+        return;
+    }
+    ds_aio_wait(aio);
+#if defined(__linux__)
+    if (aio->uring) {
+        ds_uring_free(&aio->ring);
+    }
+#endif
+    pthread_mutex_lock(&aio->lock);
+    aio->stop = TRUE;
+    pthread_cond_broadcast(&aio->work);
+    pthread_mutex_unlock(&aio->lock);
+    for (i = 0; i < aio->nthreads; ++i) {
+        pthread_join(aio->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&aio->lock);
+    pthread_cond_destroy(&aio->work);
+    pthread_cond_destroy(&aio->done);
+    free(aio->ops);
+    free(aio);
+}
+
+MYBOOL ds_aio_uses_uring(struct DSAio *aio)
+{
+    return aio ? aio->uring : FALSE;
+}
+
+MYBOOL ds_aio_register(struct DSAio *aio, struct DSVector **vecs, UINT32 n)
+{
+#if defined(__linux__)
+    struct iovec *buffers;
+    UINT32 i;
+
+    if (!aio || (n && !vecs)) {
+        return FALSE;
+    }
+    if (!aio->uring) {
+        return TRUE;
+    }
+    ds_uring_unregister(&aio->ring);
+    if (n == 0) {
+        return TRUE;
+    }
+    buffers = (struct iovec *)malloc(n * sizeof(struct iovec));
+    if (!buffers) {
+        return FALSE;
+    }
+    for (i = 0; i < n; ++i) {
+        if (!vecs[i]) {
+            free(buffers);
+            return FALSE;
+        }
+        buffers[i].iov_base = vecs[i]->data;
+        buffers[i].iov_len = vecs[i]->capacity;
+    }
+    if (syscall(__NR_io_uring_register, aio->ring.fd, IORING_REGISTER_BUFFERS, buffers, n) != 0) {
+        free(buffers);
+        return FALSE;
+    }
+    aio->ring.buffers = buffers;
+    aio->ring.nbuffers = n;
+    return TRUE;
+#else
+    (void)vecs;
+    (void)n;
+    return aio != NULL;
+#endif
+}
+
+void ds_aio_unregister(struct DSAio *aio)
+{
+#if defined(__linux__)
+    if (aio && aio->uring) {
+        ds_uring_unregister(&aio->ring);
+    }
+#else
+    (void)aio;
+#endif
+}
+
+/* private function to take a free op and hand it to the backend */
+static MYBOOL ds_aio_submit(struct DSAio *aio, UINT32 kind, int fd, UINT64 offset, struct DSVector *vec,
+                            UINT8 *buf, UINT64 length, DSAioCallback cb, void *arg)
+{
+    struct DSAioOp *op = aio->free_ops;
+
+    if (!op) {
+        return FALSE;
+    }
+    aio->free_ops = op->next;
+    ++aio->pending;
+    op->vec = vec;
+    op->cb = cb;
+    op->arg = arg;
+    op->buf = buf;
+    op->offset = offset;
+    op->length = length;
+    op->done = 0;
+    op->result = 0;
+    op->fd = fd;
+    op->buf_index = -1;
+    op->kind = kind;
+    op->next = NULL;
+
+    if (length == 0) {
+        ds_aio_finish(aio, op);
+        return TRUE;
+    }
+#if defined(__linux__)
+    if (aio->uring) {
+        op->buf_index = ds_uring_buffer(&aio->ring, buf, length);
+        ds_uring_push(&aio->ring, op);
+        ds_uring_reap(aio, FALSE);
+        return TRUE;
+    }
+#endif
+    pthread_mutex_lock(&aio->lock);
+    if (aio->queue_tail) {
+        aio->queue_tail->next = op;
+    } else {
+        aio->queue_head = op;
+    }
+    aio->queue_tail = op;
+    pthread_cond_signal(&aio->work);
+    pthread_mutex_unlock(&aio->lock);
+    return TRUE;
+}
+
+MYBOOL ds_aio_flush(struct DSAio *aio, int fd, UINT64 offset, struct DSVector *vec,
+                    DSAioCallback cb, void* arg)
+{
+    if (!aio || !vec || fd < 0) {
+        return FALSE;
+    }
+    ds_vector_settle(vec);
+    return ds_aio_submit(aio, DS_AIO_WRITE, fd, offset, vec, vec->data, vec->size, cb, arg);
+}
+
+MYBOOL ds_aio_fill(struct DSAio *aio, int fd, UINT64 offset, struct DSVector *vec, UINT32 length,
+                   DSAioCallback cb, void* arg)
+{
+    if (!aio || !vec || fd < 0 || !aio->free_ops || length >= DS_SIZE_MAX - vec->size) {
+        return FALSE;
+    }
+    if (!ds_vector_reserve(vec, vec->size + length)) {
+        return FALSE;
+    }
+    ds_vector_modified(vec, vec->size);
+    return ds_aio_submit(aio, DS_AIO_READ, fd, offset, vec, vec->data + vec->size, length, cb, arg);
+}
+
+UINT32 ds_aio_pending(struct DSAio *aio)
+{
+    return aio ? aio->pending : 0;
+}
+
+/* private function to take the finished ops in completion order, waiting for one if asked */
+static struct DSAioOp *ds_aio_collect(struct DSAio *aio, MYBOOL wait)
+{
+    struct DSAioOp *list, *ordered = NULL, *op;
+
+#if defined(__linux__)
+    if (aio->uring) {
+        ds_uring_reap(aio, FALSE);
+        while (wait && !aio->finished) {
+            ds_uring_reap(aio, TRUE);
+        }
+    }
+#endif
+    pthread_mutex_lock(&aio->lock);
+    while (wait && !aio->finished) {
+        pthread_cond_wait(&aio->done, &aio->lock);
+    }
+    list = aio->finished;
+    aio->finished = NULL;
+    pthread_mutex_unlock(&aio->lock);
+
+    while (list) {
+        op = list;
+        list = op->next;
+        op->next = ordered;
+        ordered = op;
+    }
+    return ordered;
+}
+
+UINT32 ds_aio_poll(struct DSAio *aio, UINT32 min_complete)
+{
+    struct DSAioOp *list, *op;
+    struct DSVector *vec;
+    DSAioCallback cb;
+    UINT32 delivered = 0;
+    INT64 result;
+    void *arg;
+
+    if (!aio) {
+        return 0;
+    }
+    if (min_complete > aio->pending) {
+        min_complete = aio->pending;
+    }
+    do {
+        list = ds_aio_collect(aio, delivered < min_complete);
+        while (list) {
+            op = list;
+            list = op->next;
+            vec = op->vec;
+            cb = op->cb;
+            arg = op->arg;
+            result = op->result;
+            if (op->kind == DS_AIO_READ && result > 0) {
+                ds_vector_resize(vec, vec->size + (DSSize)result);
+            }
+            /* the op is free before the callback, so the callback may queue more */
+            op->next = aio->free_ops;
+            aio->free_ops = op;
+            --aio->pending;
+            ++delivered;
+            if (cb) {
+                cb(vec, result, arg);
+            }
+        }
+    } while (delivered < min_complete);
+    return delivered;
+}
+
+void ds_aio_wait(struct DSAio *aio)
+{
+    while (aio && aio->pending) {
+        ds_aio_poll(aio, aio->pending);
+    }
+}
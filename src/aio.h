@@ -0,0 +1,94 @@
+#ifndef __LIBDS_AIO_H__
+#define __LIBDS_AIO_H__
+
+#include "vector.h"
+
+/*
+ * Asynchronous flush and fill of vector storage. Requests are queued
+ * with io_uring when the kernel has it and on a few I/O threads
+ * otherwise; either way ds_aio_poll runs the completion callbacks on
+ * the calling thread, in completion order. Short transfers are
+ * continued internally, so a request completes once all of its bytes
+ * are through, on end of file or on an error.
+ *
+ * A vector must not be modified, grown or freed while a request on it
+ * is in flight. A context is used by one thread at a time.
+ */
+
+/* flags for ds_aio_create */
+#define DS_AIO_THREAD_POOL 0x1  /* use the I/O threads even when io_uring is available */
+
+/* most requests in flight per context */
+#define DS_AIO_MAX_DEPTH 4096
+
+/* result is the number of bytes transferred or a negative errno */
+typedef void (*DSAioCallback)(struct DSVector* vec, INT64 result, void* arg);
+
+struct DSAio;
+
+/**
+ * Creates a context for up to depth requests in flight.
+ * Returns NULL on bad arguments or no memory. ds_aio_destroy will need
+ * to be called.
+ */
+struct DSAio *ds_aio_create(UINT32 depth, UINT32 flags);
+
+/**
+ * Waits for the requests in flight, running their callbacks, and frees
+ * the context.
+ */
+void ds_aio_destroy(struct DSAio *aio);
+
+/**
+ * Returns TRUE when the context submits through io_uring.
+ */
+MYBOOL ds_aio_uses_uring(struct DSAio *aio);
+
+/**
+ * Registers the storage of n vectors with the kernel, so requests on
+ * them skip the per-request page pinning. Replaces any earlier set. The
+ * vectors must not be reallocated while registered. Does nothing with
+ * the I/O threads. Returns FALSE if the kernel refuses (e.g. over the
+ * RLIMIT_MEMLOCK limit); requests then work unregistered.
+ */
+MYBOOL ds_aio_register(struct DSAio *aio, struct DSVector **vecs, UINT32 n);
+
+/**
+ * Drops the registered storage. Must not be called with requests in flight.
+ */
+void ds_aio_unregister(struct DSAio *aio);
+
+/**
+ * Queues a write of the whole contents of vec to fd at offset.
+ * Returns FALSE when the queue is full or the request is bad.
+ */
+MYBOOL ds_aio_flush(struct DSAio *aio, int fd, UINT64 offset, struct DSVector *vec,
+                    DSAioCallback cb, void* arg);
+
+/**
+ * Queues a read of up to length bytes from fd at offset, appended to
+ * vec. The storage is reserved now and the size grows by the bytes read
+ * just before the callback runs. Returns FALSE when the queue is full,
+ * the request is bad or there is no memory.
+ */
+MYBOOL ds_aio_fill(struct DSAio *aio, int fd, UINT64 offset, struct DSVector *vec, UINT32 length,
+                   DSAioCallback cb, void* arg);
+
+/**
+ * Returns the number of requests in flight.
+ */
+UINT32 ds_aio_pending(struct DSAio *aio);
+
+/**
+ * Runs the callbacks of finished requests, first waiting until at least
+ * min_complete of them (or all in flight, if fewer) have finished.
+ * Returns the number of callbacks run.
+ */
+UINT32 ds_aio_poll(struct DSAio *aio, UINT32 min_complete);
+
+/**
+ * Waits for every request in flight and runs the callbacks.
+ */
+void ds_aio_wait(struct DSAio *aio);
+
+#endif
@@ -0,0 +1,210 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "async.h"
+
+#define DS_ASYNC_EVENTS 64
+
+namespace ds {
+
+static thread_local Executor* ds_current_executor = nullptr;
+
+/* suspends the awaiting coroutine until fd is ready on the current executor */
+struct FdWait {
+    int fd;
+    MYBOOL write;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) { Executor::current()->watch(fd, write, handle); }
+    void await_resume() const noexcept {}
+};
+
+Executor::Executor() : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)), waiting_(0) {}
+
+Executor::~Executor()
+{
+    /* frames of unfinished tasks go with their Task objects */
+    tasks_.clear();
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+    }
+}
+
+Executor* Executor::current()
+{
+    return ds_current_executor;
+}
+
+void Executor::spawn(Task<void> task)
+{
+    if (!task.done()) {
+        ready_.push_back(task.handle());
+        tasks_.push_back(std::move(task));
+    }
+}
+
+/* private function to bring the epoll registration of fd in line with its waiters */
+void Executor::update(int fd)
+{
+    Waiters& w = waiters_[fd];
+    struct epoll_event event;
+
+    event.events = (w.reader ? (UINT32)EPOLLIN : 0u) | (w.writer ? (UINT32)EPOLLOUT : 0u);
+    event.data.fd = fd;
+    if (!event.events) {
+        if (w.registered) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, &event);
+        }
+        waiters_.erase(fd);
+        return;
+    }
+    if (epoll_ctl(epoll_fd_, w.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) == 0) {
+        w.registered = TRUE;
+        return;
+    }
+    /* fds epoll cannot watch (regular files) are always ready: retry at once */
+    if (w.reader) {
+        ready_.push_back(std::exchange(w.reader, {}));
+        --waiting_;
+    }
+    if (w.writer) {
+        ready_.push_back(std::exchange(w.writer, {}));
+        --waiting_;
+    }
+    waiters_.erase(fd);
+}
+
+void Executor::watch(int fd, MYBOOL write, std::coroutine_handle<> handle)
+{
+    Waiters& w = waiters_[fd];
+
+    (write ? w.writer : w.reader) = handle;
+    ++waiting_;
+    update(fd);
+}
+
+UINT32 Executor::run()
+{
+    Executor* outer = ds_current_executor;
+    struct epoll_event events[DS_ASYNC_EVENTS];
+    std::coroutine_handle<> handle;
+    int n, i;
+
+    if (!valid()) {
+        return (UINT32)tasks_.size();
+    }
+    ds_current_executor = this;
+    for (;;) {
+        while (!ready_.empty()) {
+            handle = ready_.front();
+            ready_.pop_front();
+            handle.resume();
+        }
+        tasks_.erase(std::remove_if(tasks_.begin(), tasks_.end(), [](const Task<void>& t) { return t.done(); }),
+                     tasks_.end());
+        if (tasks_.empty() || waiting_ == 0) {
+            break;
+        }
+        n = epoll_wait(epoll_fd_, events, DS_ASYNC_EVENTS, -1);
+        if (n < 0 && errno != EINTR) {
+            break;
+        }
+        /* wake-ups are queued, not resumed here, so resumed code can change the registrations */
+        for (i = 0; i < n; ++i) {
+            auto it = waiters_.find(events[i].data.fd);
+            if (it == waiters_.end()) {
+                continue;
+            }
+            if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && it->second.reader) {
+                ready_.push_back(std::exchange(it->second.reader, {}));
+                --waiting_;
+            }
+            if ((events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) && it->second.writer) {
+                ready_.push_back(std::exchange(it->second.writer, {}));
+                --waiting_;
+            }
+            update(events[i].data.fd);
+        }
+    }
+    ds_current_executor = outer;
+    return (UINT32)tasks_.size();
+}
+
+static void ds_async_nonblock(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags >= 0 && !(flags & O_NONBLOCK)) {
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+}
+
+Task<INT64> async_write(int fd, struct DSVector* vec)
+{
+    MYBOOL socket = TRUE;
+    DSSize done = 0;
+    ssize_t n;
+
+    if (!vec || fd < 0 || !Executor::current()) {
+        co_return -EINVAL;
+    }
+    ds_vector_settle(vec);
+    ds_async_nonblock(fd);
+    while (done < vec->size) {
+        /* send() keeps a closed peer from raising SIGPIPE; other fds fall back to write() */
+        n = socket ? send(fd, vec->data + done, vec->size - done, MSG_NOSIGNAL) : -1;
+        if (socket && n < 0 && errno == ENOTSOCK) {
+            socket = FALSE;
+        }
+        if (!socket) {
+            n = write(fd, vec->data + done, vec->size - done);
+        }
+        if (n > 0) {
+            done += (DSSize)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            co_await FdWait{fd, TRUE};
+        } else {
+            co_return n < 0 ? -(INT64)errno : (INT64)done;
+        }
+    }
+    co_return (INT64)done;
+}
+
+Task<INT64> async_read_into(int fd, struct DSVector* vec, DSSize n)
+{
+    DSSize got = 0;
+    ssize_t r;
+
+    if (!vec || fd < 0 || !Executor::current()) {
+        co_return -EINVAL;
+    }
+    if (n >= DS_SIZE_MAX - vec->size || !ds_vector_reserve(vec, vec->size + n)) {
+        co_return -ENOMEM;
+    }
+    ds_async_nonblock(fd);
+    while (got < n) {
+        ds_vector_modified(vec, vec->size);
+        r = read(fd, vec->data + vec->size, n - got);
+        if (r > 0) {
+            ds_vector_resize(vec, vec->size + (DSSize)r);
+            got += (DSSize)r;
+        } else if (r == 0) {
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            co_await FdWait{fd, FALSE};
+        } else {
+            co_return -(INT64)errno;
+        }
+    }
+    co_return (INT64)got;
+}
+
+} // namespace ds
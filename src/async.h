@@ -0,0 +1,215 @@
+#ifndef __LIBDS_ASYNC_H__
+#define __LIBDS_ASYNC_H__
+
+/*
+ * C++20 coroutine front end for streaming vectors through pipes and
+ * sockets. ds::async_write and ds::async_read_into are awaitable tasks
+ * that suspend on EAGAIN and are resumed by a single-threaded epoll
+ * executor, so one thread drives any number of streams. Results follow
+ * the rest of the library: bytes transferred, or a negative errno, with
+ * no exceptions.
+ *
+ * Build with -std=c++20.
+ */
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include "vector.h"
+}
+
+namespace ds {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+/* resumes the awaiting coroutine, if any, when a task finishes */
+struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+
+    template <typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> self) noexcept
+    {
+        std::coroutine_handle<> next = self.promise().continuation;
+        return next ? next : std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+};
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { std::terminate(); }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    T value{};
+
+    Task<T> get_return_object() noexcept;
+    void return_value(T result) noexcept { value = std::move(result); }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+};
+
+} // namespace detail
+
+/**
+ * A lazily started coroutine. It runs when awaited (or spawned on an
+ * Executor) and owns its frame.
+ */
+template <typename T>
+class Task {
+public:
+    using promise_type = detail::Promise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+
+    ~Task()
+    {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    bool done() const noexcept { return !handle_ || handle_.done(); }
+    std::coroutine_handle<promise_type> handle() const noexcept { return handle_; }
+
+    bool await_ready() const noexcept { return done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+    {
+        handle_.promise().continuation = caller;
+        return handle_;
+    }
+
+    T await_resume() noexcept
+    {
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(handle_.promise().value);
+        }
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept
+{
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+/**
+ * Single-threaded epoll loop. Tasks spawned on it, and everything they
+ * await, run on the thread that calls run().
+ */
+class Executor {
+public:
+    Executor();
+    ~Executor();
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    /**
+     * Returns FALSE when the epoll instance could not be created.
+     */
+    MYBOOL valid() const { return epoll_fd_ >= 0; }
+
+    /**
+     * Takes ownership of task and starts it on the next run().
+     */
+    void spawn(Task<void> task);
+
+    /**
+     * Runs the spawned tasks until all of them have finished, or until
+     * the ones left wait on nothing. Returns the number left unfinished.
+     */
+    UINT32 run();
+
+    /**
+     * Returns the executor running on this thread, nullptr outside run().
+     */
+    static Executor* current();
+
+    /**
+     * Resumes handle once fd is readable (or writable when write is
+     * TRUE), hung up or in error. One reader and one writer per fd.
+     */
+    void watch(int fd, MYBOOL write, std::coroutine_handle<> handle);
+
+private:
+    struct Waiters {
+        std::coroutine_handle<> reader;
+        std::coroutine_handle<> writer;
+        MYBOOL registered = FALSE;
+    };
+
+    void update(int fd);
+
+    int epoll_fd_;
+    UINT32 waiting_;
+    std::vector<Task<void>> tasks_;
+    std::deque<std::coroutine_handle<>> ready_;
+    std::unordered_map<int, Waiters> waiters_;
+};
+
+/**
+ * Writes the whole contents of vec to fd, which is switched to
+ * non-blocking mode. Must be awaited inside Executor::run(). The vector
+ * must not change until the task completes. Writes to sockets do not
+ * raise SIGPIPE; writes to pipes do unless it is ignored.
+ * Returns the number of bytes written or a negative errno.
+ */
+Task<INT64> async_write(int fd, struct DSVector* vec);
+
+/**
+ * Appends up to n bytes read from fd, which is switched to non-blocking
+ * mode, to vec; fewer only at end of file. The storage is reserved up
+ * front. Must be awaited inside Executor::run().
+ * Returns the number of bytes appended or a negative errno; bytes read
+ * before an error stay appended.
+ */
+Task<INT64> async_read_into(int fd, struct DSVector* vec, DSSize n);
+
+} // namespace ds
+
+#endif
@@ -0,0 +1,845 @@
+/*
+ * Micro benchmarks for the vector library.
+ * Usage: bench_vector [section...]   (no argument runs every section)
+ */
+#include <immintrin.h>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+extern "C" {
+#include "vector.c"
+#include "parallel.c"
+#include "flatmap.c"
+#include "aio.c"
+}
+
+#define BENCH_LOG_BYTES (64u << 20)
+
+static volatile UINT32 bench_sink;
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_report(const char *name, double seconds, double bytes)
+{
+    printf("  %-32s %8.3f ms %9.2f GB/s\n", name, seconds * 1e3, bytes / seconds / 1e9);
+}
+
+/* builds a buffer of access-log style lines, roughly 100 bytes each */
+static struct DSVector *bench_log_lines(UINT32 bytes)
+{
+    static const char *levels[] = {"INFO", "WARN", "DEBUG", "ERROR"};
+    static const char *paths[] = {"/api/v1/items", "/api/v1/users/profile", "/healthz", "/static/app.js"};
+    struct DSVector *vec = ds_vector_create(bytes + 256, 1.5);
+    UINT32 i = 0;
+
+    srand(42);
+    while (vec->size < bytes) {
+        ds_vector_sprintf(vec, "2026-10-19T08:%02u:%02u.%03uZ %s [worker-%u] request id=%08x path=%s status=%u latency_ms=%u\n",
+                          i / 60 % 60, i % 60, i % 1000, levels[rand() % 4], rand() % 32, rand(),
+                          paths[rand() % 4], rand() % 8 ? 200 : 503, rand() % 900);
+        ++i;
+    }
+    return vec;
+}
+
+static void bench_search(void)
+{
+    struct DSVector *vec = bench_log_lines(BENCH_LOG_BYTES);
+    const UINT8 set[] = {' ', '=', '\n'};
+    const UINT8 sparse[] = {'[', ']', '\n'};
+    const char *needle = "status=503";
+    UINT32 pos, count;
+    const UINT8 *p, *end = vec->data + vec->size;
+    double t;
+
+    printf("search: %u bytes of log lines\n", (UINT32)vec->size);
+
+    t = bench_now();
+    for (count = 0, pos = 0; (pos = ds_vector_find_byte(vec, pos, '\n')) != DS_VECTOR_NPOS; ++pos) {
+        ++count;
+    }
+    bench_report("ds_vector_find_byte('\\n')", bench_now() - t, vec->size);
+    bench_sink = count;
+
+    t = bench_now();
+    for (count = 0, p = vec->data; (p = (const UINT8 *)memchr(p, '\n', end - p)) != NULL; ++p) {
+        ++count;
+    }
+    bench_report("memchr('\\n')", bench_now() - t, vec->size);
+    bench_sink = count;
+
+    t = bench_now();
+    for (count = 0, pos = DS_VECTOR_NPOS; (pos = ds_vector_rfind(vec, pos, '\n')) != DS_VECTOR_NPOS;) {
+        ++count;
+    }
+    bench_report("ds_vector_rfind('\\n')", bench_now() - t, vec->size);
+    bench_sink = count;
+
+    t = bench_now();
+    for (count = 0, p = end; (p = (const UINT8 *)memrchr(vec->data, '\n', p - vec->data)) != NULL;) {
+        ++count;
+    }
+    bench_report("memrchr('\\n')", bench_now() - t, vec->size);
+    bench_sink = count;
+
+    t = bench_now();
+    for (count = 0, pos = 0; (pos = ds_vector_find_any(vec, pos, set, sizeof(set))) != DS_VECTOR_NPOS; ++pos) {
+        ++count;
+    }
+    bench_report("ds_vector_find_any(' =\\n')", bench_now() - t, vec->size);
+    bench_sink = count;
+
+    t = bench_now();
+    for (count = 0, p = vec->data; p < end; ++p) {
+        if (*p == ' ' || *p == '=' || *p == '\n') {
+            ++count;
+        }
+    }
+    bench_report("scalar loop(' =\\n')", bench_now() - t, vec->size);
+    bench_sink = count;
+
+    t = bench_now();
+    for (count = 0, pos = 0; (pos = ds_vector_find_any(vec, pos, sparse, sizeof(sparse))) != DS_VECTOR_NPOS; ++pos) {
+        ++count;
+    }
+    bench_report("ds_vector_find_any('[]\\n')", bench_now() - t, vec->size);
+    bench_sink = count;
+
+    t = bench_now();
+    for (count = 0, p = vec->data; p < end; ++p) {
+        if (*p == '[' || *p == ']' || *p == '\n') {
+            ++count;
+        }
+    }
+    bench_report("scalar loop('[]\\n')", bench_now() - t, vec->size);
+    bench_sink = count;
+
+    t = bench_now();
+    for (count = 0, pos = 0; (pos = ds_vector_find_bytes(vec, pos, (const UINT8 *)needle, strlen(needle))) != DS_VECTOR_NPOS; ++pos) {
+        ++count;
+    }
+    bench_report("ds_vector_find_bytes(status=503)", bench_now() - t, vec->size);
+    bench_sink = count;
+
+    t = bench_now();
+    for (count = 0, p = vec->data; (p = (const UINT8 *)memmem(p, end - p, needle, strlen(needle))) != NULL; ++p) {
+        ++count;
+    }
+    bench_report("memmem(status=503)", bench_now() - t, vec->size);
+    bench_sink = count;
+
+    ds_vector_free(vec);
+}
+
+/* byte-at-a-time FNV-1a, the kind of loop ds_vector_hash64 replaces */
+static UINT64 bench_fnv1a(const UINT8 *data, UINT32 length)
+{
+    UINT64 h = 0xCBF29CE484222325ULL;
+    while (length--) {
+        h = (h ^ *data++) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static void bench_hash(void)
+{
+    struct DSVector *vec = bench_log_lines(BENCH_LOG_BYTES);
+    UINT64 h = 0;
+    double t;
+
+    printf("hash: %u bytes of log lines\n", (UINT32)vec->size);
+
+    t = bench_now();
+    h += ds_vector_crc32c(vec);
+    bench_report("ds_vector_crc32c", bench_now() - t, vec->size);
+
+    ds_isa_level = DS_ISA_SCALAR;
+    t = bench_now();
+    h += ds_vector_crc32c(vec);
+    bench_report("ds_vector_crc32c (software)", bench_now() - t, vec->size);
+    ds_isa_level = -1;
+
+    t = bench_now();
+    h += ds_vector_hash64(vec, 0);
+    bench_report("ds_vector_hash64", bench_now() - t, vec->size);
+
+    t = bench_now();
+    h += bench_fnv1a(vec->data, vec->size);
+    bench_report("fnv1a byte loop", bench_now() - t, vec->size);
+
+    bench_sink = (UINT32)h;
+    ds_vector_free(vec);
+}
+
+static void bench_compress(void)
+{
+    struct DSVector *vec = bench_log_lines(BENCH_LOG_BYTES / 4);
+    struct DSVector *packed = ds_vector_create_capacity(16);
+    struct DSVector *out = ds_vector_create_capacity(16);
+    static const INT32 levels[] = {1, 3, 6, 9};
+    char name[64];
+    UINT32 i;
+    double t;
+
+    printf("compress: %u bytes of log lines\n", (UINT32)vec->size);
+    for (i = 0; i < sizeof(levels) / sizeof(levels[0]); ++i) {
+        packed->size = 0;
+        out->size = 0;
+        t = bench_now();
+        ds_vector_compress(packed, vec, levels[i]);
+        snprintf(name, sizeof(name), "compress level %d (ratio %.2f)", levels[i], (double)vec->size / packed->size);
+        bench_report(name, bench_now() - t, vec->size);
+
+        t = bench_now();
+        ds_vector_decompress(out, packed);
+        snprintf(name, sizeof(name), "decompress level %d", levels[i]);
+        bench_report(name, bench_now() - t, vec->size);
+        if (out->size != vec->size || memcmp(out->data, vec->data, vec->size) != 0) {
+            printf("  round trip mismatch\n");
+        }
+    }
+    ds_vector_free(vec);
+    ds_vector_free(packed);
+    ds_vector_free(out);
+}
+
+static void bench_codec(void)
+{
+    struct DSVector *raw = ds_vector_create_capacity(1u << 20);
+    struct DSVector *text = ds_vector_create_capacity(16);
+    struct DSVector *out = ds_vector_create_capacity(16);
+    UINT32 i, chunk = 4096, rounds = 64;
+    double t;
+
+    srand(7);
+    for (i = 0; i < (1u << 20) - 1; ++i) {
+        raw->data[i] = (UINT8)rand();
+    }
+    raw->size = (1u << 20) - 1;
+    printf("codec: %u x %u byte chunks\n", (UINT32)(rounds * (raw->size / chunk)), chunk);
+
+    t = bench_now();
+    for (i = 0; i < raw->size / chunk; ++i) {
+        UINT32 j, off = i % (raw->size / chunk) * chunk;
+        if (off == 0) {
+            text->size = 0;
+        }
+        for (j = 0; j < chunk; ++j) {
+            ds_vector_sprintf(text, "%02x", raw->data[off + j]);
+        }
+    }
+    bench_report("sprintf(\"%02x\") per byte", bench_now() - t, raw->size);
+
+    t = bench_now();
+    for (i = 0; i < rounds * (raw->size / chunk); ++i) {
+        UINT32 off = i % (raw->size / chunk) * chunk;
+        if (off == 0) {
+            text->size = 0;
+        }
+        ds_vector_append_hex(text, raw->data + off, chunk);
+    }
+    bench_report("ds_vector_append_hex", bench_now() - t, (double)rounds * raw->size);
+
+    t = bench_now();
+    for (i = 0; i < rounds; ++i) {
+        out->size = 0;
+        ds_vector_decode_hex(out, text->data, text->size);
+    }
+    bench_report("ds_vector_decode_hex", bench_now() - t, (double)rounds * raw->size);
+
+    ds_isa_level = DS_ISA_SCALAR;
+    t = bench_now();
+    for (i = 0; i < rounds; ++i) {
+        text->size = 0;
+        ds_vector_append_base64(text, raw->data, raw->size);
+    }
+    bench_report("ds_vector_append_base64 (scalar)", bench_now() - t, (double)rounds * raw->size);
+    ds_isa_level = -1;
+
+    t = bench_now();
+    for (i = 0; i < rounds; ++i) {
+        text->size = 0;
+        ds_vector_append_base64(text, raw->data, raw->size);
+    }
+    bench_report("ds_vector_append_base64", bench_now() - t, (double)rounds * raw->size);
+
+    ds_isa_level = DS_ISA_SCALAR;
+    t = bench_now();
+    for (i = 0; i < rounds; ++i) {
+        out->size = 0;
+        ds_vector_decode_base64(out, text->data, text->size);
+    }
+    bench_report("ds_vector_decode_base64 (scalar)", bench_now() - t, (double)rounds * raw->size);
+    ds_isa_level = -1;
+
+    t = bench_now();
+    for (i = 0; i < rounds; ++i) {
+        out->size = 0;
+        ds_vector_decode_base64(out, text->data, text->size);
+    }
+    bench_report("ds_vector_decode_base64", bench_now() - t, (double)rounds * raw->size);
+
+    ds_vector_free(raw);
+    ds_vector_free(text);
+    ds_vector_free(out);
+}
+
+static int bench_qsort_u32(const void *a, const void *b)
+{
+    UINT32 x = *(const UINT32 *)a, y = *(const UINT32 *)b;
+    return x < y ? -1 : x > y;
+}
+
+static INT32 bench_compare_u32(const void *a, const void *b, void *arg)
+{
+    UINT32 x = *(const UINT32 *)a, y = *(const UINT32 *)b;
+    (void)arg;
+    return x < y ? -1 : x > y;
+}
+
+static int bench_qsort_u64(const void *a, const void *b)
+{
+    UINT64 x = *(const UINT64 *)a, y = *(const UINT64 *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void bench_sort_fill(struct DSVector *vec, UINT32 key_size, UINT32 n)
+{
+    UINT64 state = 88172645463325252ULL;
+    UINT32 i;
+
+    vec->size = 0;
+    for (i = 0; i < n; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        ds_vector_append(vec, (UINT8 *)&state, key_size);
+    }
+}
+
+static void bench_sort(void)
+{
+    UINT32 n = 4u << 20;
+    struct DSVector *vec = ds_vector_create_capacity(n * 8 + 1);
+    double t;
+
+    printf("sort: %u random keys\n", n);
+
+    bench_sort_fill(vec, 4, n);
+    t = bench_now();
+    ds_vector_sort_keys(vec, 4);
+    bench_report("u32 ds_vector_sort_keys", bench_now() - t, vec->size);
+
+    bench_sort_fill(vec, 4, n);
+    t = bench_now();
+    ds_vector_sort(vec, 4, bench_compare_u32, NULL);
+    bench_report("u32 ds_vector_sort (pdq)", bench_now() - t, vec->size);
+
+    bench_sort_fill(vec, 4, n);
+    t = bench_now();
+    qsort(vec->data, n, 4, bench_qsort_u32);
+    bench_report("u32 qsort", bench_now() - t, vec->size);
+
+    bench_sort_fill(vec, 4, n);
+    t = bench_now();
+    std::sort((UINT32 *)vec->data, (UINT32 *)vec->data + n);
+    bench_report("u32 std::sort", bench_now() - t, vec->size);
+
+    bench_sort_fill(vec, 8, n);
+    t = bench_now();
+    ds_vector_sort_keys(vec, 8);
+    bench_report("u64 ds_vector_sort_keys", bench_now() - t, vec->size);
+
+    bench_sort_fill(vec, 8, n);
+    t = bench_now();
+    qsort(vec->data, n, 8, bench_qsort_u64);
+    bench_report("u64 qsort", bench_now() - t, vec->size);
+
+    bench_sort_fill(vec, 8, n);
+    t = bench_now();
+    std::sort((UINT64 *)vec->data, (UINT64 *)vec->data + n);
+    bench_report("u64 std::sort", bench_now() - t, vec->size);
+
+    ds_vector_free(vec);
+}
+
+static UINT64 bench_hash_chunk(const UINT8 *data, UINT32 count, UINT32 first, void *arg)
+{
+    return ds_crc32c_update(0, data, count);
+}
+
+static UINT64 bench_xor(UINT64 a, UINT64 b, void *arg)
+{
+    return a ^ b;
+}
+
+static void bench_parallel(void)
+{
+    UINT32 n = 4u << 20, threads[] = {1, 2, 4, 0}, i, used;
+    struct DSVector *vec = ds_vector_create_capacity(n * 4 + 1), *shards[1000], *merged;
+    char name[64];
+    double t;
+
+    printf("parallel: %u u32 keys, %ld cpus online\n", n, sysconf(_SC_NPROCESSORS_ONLN));
+    for (i = 0; i < 1000; ++i) {
+        shards[i] = ds_vector_create_capacity(64u << 10);
+        ds_vector_resize(shards[i], 64u << 10);
+        memset(shards[i]->data, i, shards[i]->size);
+    }
+    merged = ds_vector_create_capacity(16);
+    t = bench_now();
+    for (i = 0; i < 1000; ++i) {
+        ds_vector_concat(merged, shards[i]);
+    }
+    bench_report("1000 x 64K ds_vector_concat", bench_now() - t, merged->size);
+    ds_vector_free(merged);
+    merged = ds_vector_create_capacity(16);
+    t = bench_now();
+    ds_vector_concat_many(merged, shards, 1000);
+    bench_report("1000 x 64K ds_vector_concat_many", bench_now() - t, merged->size);
+    ds_vector_free(merged);
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+        used = ds_parallel_init(threads[i], 0);
+
+        bench_sort_fill(vec, 4, n);
+        t = bench_now();
+        bench_sink = (UINT32)ds_parallel_reduce(vec, 1, 0, bench_hash_chunk, bench_xor, NULL);
+        snprintf(name, sizeof(name), "crc32c chunks, %u threads", used);
+        bench_report(name, bench_now() - t, vec->size);
+
+        t = bench_now();
+        ds_parallel_sort(vec, 4, NULL, NULL);
+        snprintf(name, sizeof(name), "u32 ds_parallel_sort, %u threads", used);
+        bench_report(name, bench_now() - t, vec->size);
+
+        merged = ds_vector_create_capacity(16);
+        t = bench_now();
+        ds_parallel_concat(merged, shards, 1000);
+        snprintf(name, sizeof(name), "concat 1000 x 64K, %u threads", used);
+        bench_report(name, bench_now() - t, merged->size);
+        ds_vector_free(merged);
+
+        ds_parallel_shutdown();
+    }
+    for (i = 0; i < 1000; ++i) {
+        ds_vector_free(shards[i]);
+    }
+    ds_vector_free(vec);
+}
+
+/* opens a counter of user-space dTLB load misses for this thread, -1 if unavailable */
+static int bench_dtlb_open(void)
+{
+#if defined(__linux__)
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static long long bench_dtlb_read(int fd)
+{
+    long long count = -1;
+    if (fd < 0 || read(fd, &count, sizeof(count)) != sizeof(count)) {
+        return -1;
+    }
+    return count;
+}
+
+static void bench_tlb_run(const char *name, UINT32 flags)
+{
+    UINT32 size = 512u << 20, i;
+    struct DSVector *vec = ds_vector_create_flags(size, 1.5, flags);
+    UINT64 state = 88172645463325252ULL, sum = 0;
+    long long before, after;
+    char label[64];
+    double t;
+    int fd;
+
+    ds_vector_resize(vec, size);
+    memset(vec->data, 1, size);
+    fd = bench_dtlb_open();
+
+    /* one read per 4K page, then random 8-byte reads across the buffer */
+    before = bench_dtlb_read(fd);
+    t = bench_now();
+    for (i = 0; i < size; i += 4096) {
+        sum += vec->data[i];
+    }
+    after = bench_dtlb_read(fd);
+    snprintf(label, sizeof(label), "%s page stride", name);
+    bench_report(label, bench_now() - t, size);
+    if (before >= 0 && after >= 0) {
+        printf("  %-32s %lld dTLB load misses\n", "", after - before);
+    }
+
+    before = bench_dtlb_read(fd);
+    t = bench_now();
+    for (i = 0; i < (16u << 20); ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        sum += *(const UINT64 *)(vec->data + (state % (size / 8)) * 8);
+    }
+    after = bench_dtlb_read(fd);
+    snprintf(label, sizeof(label), "%s 16M random reads", name);
+    bench_report(label, bench_now() - t, (16u << 20) * 8.0);
+    if (before >= 0 && after >= 0) {
+        printf("  %-32s %lld dTLB load misses\n", "", after - before);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    bench_sink = (UINT32)sum;
+    ds_vector_free(vec);
+}
+
+static void bench_tlb(void)
+{
+    int fd = bench_dtlb_open();
+
+    printf("tlb: 512MB buffer%s\n", fd < 0 ? " (dTLB counter unavailable)" : "");
+    if (fd >= 0) {
+        close(fd);
+    }
+    bench_tlb_run("4K pages", DS_VECTOR_ALIGN_64);
+    bench_tlb_run("huge pages", DS_VECTOR_HUGE_PAGES);
+}
+
+static int bench_u32_less(const void *a, const void *b)
+{
+    UINT32 x = *(const UINT32 *)a, y = *(const UINT32 *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* times every 64-byte append, into storage reserved up front unless growing */
+static void bench_latency_run(const char *name, UINT32 flags, MYBOOL growing)
+{
+    UINT32 count = (256u << 20) / 64, i;
+    struct DSVector *vec = ds_vector_create_flags(growing ? 1u << 20 : 10, 1.5, flags);
+    UINT32 *ns = (UINT32 *)malloc(sizeof(UINT32) * count);
+    UINT8 record[64];
+    struct timespec a, b;
+    double t;
+
+    memset(record, 'r', sizeof(record));
+    memset(ns, 0, sizeof(UINT32) * count);
+    t = bench_now();
+    if (!growing) {
+        ds_vector_reserve(vec, 256u << 20);
+    }
+    t = bench_now() - t;
+    for (i = 0; i < count; ++i) {
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        ds_vector_append(vec, record, sizeof(record));
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        ns[i] = (UINT32)((b.tv_sec - a.tv_sec) * 1000000000LL + (b.tv_nsec - a.tv_nsec));
+    }
+    qsort(ns, count, sizeof(UINT32), bench_u32_less);
+    printf("  %-20s reserve %7.2f ms  p50 %5u ns  p99 %5u ns  p99.9 %6u ns  max %7u ns%s\n", name, t * 1e3,
+           ns[count / 2], ns[count / 100 * 99], ns[count / 1000 * 999], ns[count - 1],
+           (flags & DS_VECTOR_LOCKED) && !(vec->flags & DS_VECTOR_LOCKED) ? " (mlock refused)" : "");
+    free(ns);
+    ds_vector_free(vec);
+}
+
+static void bench_latency(void)
+{
+    printf("latency: 4M appends of 64 bytes into 256MB reserved up front\n");
+    bench_latency_run("plain", 0, FALSE);
+    bench_latency_run("prefault", DS_VECTOR_PREFAULT, FALSE);
+    bench_latency_run("prefault + mlock", DS_VECTOR_PREFAULT | DS_VECTOR_LOCKED, FALSE);
+    /* aligned storage grows by copying; plain glibc realloc can move large blocks with mremap */
+    printf("latency: the same appends into 64-byte aligned storage growing from 1MB\n");
+    bench_latency_run("aligned", DS_VECTOR_ALIGN_64, TRUE);
+    bench_latency_run("aligned + pregrow", DS_VECTOR_ALIGN_64 | DS_VECTOR_PREGROW, TRUE);
+    bench_latency_run("aligned + incremental", DS_VECTOR_ALIGN_64 | DS_VECTOR_INCREMENTAL, TRUE);
+}
+
+static void bench_lookup_report(const char *name, double seconds, UINT32 lookups)
+{
+    printf("  %-32s %8.3f ms %9.2f M lookups/s\n", name, seconds * 1e3, lookups / seconds / 1e6);
+}
+
+static void bench_flatmap(void)
+{
+    UINT32 n = 4u << 20, lookups = 4u << 20, i;
+    UINT64 *keys = (UINT64 *)malloc((size_t)n * sizeof(UINT64));
+    UINT64 *probes = (UINT64 *)malloc((size_t)lookups * sizeof(UINT64));
+    UINT64 state = 88172645463325252ULL, sum;
+    struct DSFlatMap *sorted, *eytzinger;
+    std::map<UINT64, UINT64> tree;
+    std::unordered_map<UINT64, UINT64> hash;
+    double t;
+
+    printf("flatmap: %u u64 keys, %u random hits\n", n, lookups);
+    for (i = 0; i < n; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        keys[i] = state;
+    }
+    for (i = 0; i < lookups; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        probes[i] = keys[state % n];
+    }
+
+    t = bench_now();
+    sorted = ds_flatmap_build(keys, (const UINT8 *)keys, n, sizeof(UINT64), 0);
+    printf("  %-32s %8.3f ms\n", "build sorted", (bench_now() - t) * 1e3);
+    t = bench_now();
+    eytzinger = ds_flatmap_build(keys, (const UINT8 *)keys, n, sizeof(UINT64), DS_FLATMAP_EYTZINGER);
+    printf("  %-32s %8.3f ms\n", "build eytzinger", (bench_now() - t) * 1e3);
+    for (i = 0; i < n; ++i) {
+        tree[keys[i]] = keys[i];
+        hash[keys[i]] = keys[i];
+    }
+
+    t = bench_now();
+    for (i = 0, sum = 0; i < lookups; ++i) {
+        sum += *(const UINT64 *)ds_flatmap_find(sorted, probes[i]);
+    }
+    bench_lookup_report("ds_flatmap sorted", bench_now() - t, lookups);
+    bench_sink = (UINT32)sum;
+
+    t = bench_now();
+    for (i = 0, sum = 0; i < lookups; ++i) {
+        sum += *(const UINT64 *)ds_flatmap_find(eytzinger, probes[i]);
+    }
+    bench_lookup_report("ds_flatmap eytzinger", bench_now() - t, lookups);
+    bench_sink = (UINT32)sum;
+
+    t = bench_now();
+    for (i = 0, sum = 0; i < lookups; ++i) {
+        sum += tree.find(probes[i])->second;
+    }
+    bench_lookup_report("std::map", bench_now() - t, lookups);
+    bench_sink = (UINT32)sum;
+
+    t = bench_now();
+    for (i = 0, sum = 0; i < lookups; ++i) {
+        sum += hash.find(probes[i])->second;
+    }
+    bench_lookup_report("std::unordered_map", bench_now() - t, lookups);
+    bench_sink = (UINT32)sum;
+
+    ds_flatmap_free(sorted);
+    ds_flatmap_free(eytzinger);
+    free(keys);
+    free(probes);
+}
+
+#define BENCH_AIO_BUFFERS 256
+#define BENCH_AIO_BUFFER  (1u << 20)
+
+static void bench_aio_run(const char *name, struct DSVector **vecs, UINT32 flags, MYBOOL blocking)
+{
+    const char *path = "bench_vector.aio";
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    struct DSAio *aio = blocking ? NULL : ds_aio_create(16, flags);
+    char label[64];
+    double t;
+    UINT32 i;
+
+    if (fd < 0 || (!blocking && !aio)) {
+        printf("  %-32s unavailable\n", name);
+        return;
+    }
+    if (aio && ds_aio_uses_uring(aio)) {
+        ds_aio_register(aio, vecs, BENCH_AIO_BUFFERS);
+    }
+    t = bench_now();
+    for (i = 0; i < BENCH_AIO_BUFFERS; ++i) {
+        if (blocking) {
+            bench_sink += pwrite(fd, vecs[i]->data, vecs[i]->size, (off_t)i * BENCH_AIO_BUFFER) > 0;
+            continue;
+        }
+        while (!ds_aio_flush(aio, fd, (UINT64)i * BENCH_AIO_BUFFER, vecs[i], NULL, NULL)) {
+            ds_aio_poll(aio, 1);
+        }
+    }
+    ds_aio_wait(aio);
+    snprintf(label, sizeof(label), "%s flush", name);
+    bench_report(label, bench_now() - t, (double)BENCH_AIO_BUFFERS * BENCH_AIO_BUFFER);
+
+    t = bench_now();
+    for (i = 0; i < BENCH_AIO_BUFFERS; ++i) {
+        if (blocking) {
+            bench_sink += pread(fd, vecs[i]->data, BENCH_AIO_BUFFER, (off_t)i * BENCH_AIO_BUFFER) > 0;
+            continue;
+        }
+        vecs[i]->size = 0;
+        while (!ds_aio_fill(aio, fd, (UINT64)i * BENCH_AIO_BUFFER, vecs[i], BENCH_AIO_BUFFER, NULL, NULL)) {
+            ds_aio_poll(aio, 1);
+        }
+    }
+    ds_aio_wait(aio);
+    snprintf(label, sizeof(label), "%s fill", name);
+    bench_report(label, bench_now() - t, (double)BENCH_AIO_BUFFERS * BENCH_AIO_BUFFER);
+
+    ds_aio_destroy(aio);
+    close(fd);
+    unlink(path);
+}
+
+static void bench_aio(void)
+{
+    struct DSVector *vecs[BENCH_AIO_BUFFERS];
+    UINT32 i;
+
+    printf("aio: %u buffers of %u bytes to a local file, 16 in flight\n", BENCH_AIO_BUFFERS, BENCH_AIO_BUFFER);
+    for (i = 0; i < BENCH_AIO_BUFFERS; ++i) {
+        vecs[i] = ds_vector_create_capacity(BENCH_AIO_BUFFER + 1);
+        ds_vector_resize(vecs[i], BENCH_AIO_BUFFER);
+        memset(vecs[i]->data, i, BENCH_AIO_BUFFER);
+    }
+    bench_aio_run("blocking pwrite/pread", vecs, 0, TRUE);
+    bench_aio_run("io_uring", vecs, 0, FALSE);
+    bench_aio_run("thread pool", vecs, DS_AIO_THREAD_POOL, FALSE);
+    for (i = 0; i < BENCH_AIO_BUFFERS; ++i) {
+        ds_vector_free(vecs[i]);
+    }
+}
+
+/* log lines with a non-ASCII user name in about one line in four */
+static struct DSVector *bench_utf8_lines(UINT32 bytes)
+{
+    static const char *names[] = {"alice", "Jos\xC3\xA9", "\xE5\xBC\xA0\xE4\xBC\x9F", "bob", "\xF0\x9F\x90\xA7 bot", "carol", "dan", "eve"};
+    struct DSVector *vec = ds_vector_create(bytes + 256, 1.5);
+    UINT32 i = 0;
+
+    srand(42);
+    while (vec->size < bytes) {
+        ds_vector_sprintf(vec, "{\"ts\":\"2026-10-19T08:%02u:%02uZ\",\"user\":\"%s\",\"id\":\"%08x\",\"status\":%u}\n",
+                          i / 60 % 60, i % 60, names[rand() % 8], rand(), rand() % 8 ? 200 : 503);
+        ++i;
+    }
+    return vec;
+}
+
+static void bench_utf8_kernels(const char *label, struct DSVector *vec)
+{
+    static const char *isa_names[] = {"scalar", "sse2", "ssse3", "sse4.2", "avx2"};
+    struct DSVectorView view = ds_vector_view(vec, 0, vec->size);
+    char name[64];
+    UINT32 ok = 0;
+    INT32 isa, top = ds_vector_isa();
+    double t;
+
+    printf("utf8: %u bytes of %s\n", (UINT32)vec->size, label);
+    for (isa = DS_ISA_SCALAR; isa <= top; ++isa) {
+        if (isa == DS_ISA_SSE42) {
+            continue;
+        }
+        ds_isa_level = isa;
+        t = bench_now();
+        ok += ds_view_validate_utf8(view);
+        snprintf(name, sizeof(name), "validate_utf8 (%s)", isa_names[isa]);
+        bench_report(name, bench_now() - t, vec->size);
+        t = bench_now();
+        ok += ds_view_is_ascii(view);
+        snprintf(name, sizeof(name), "is_ascii (%s)", isa_names[isa]);
+        bench_report(name, bench_now() - t, vec->size);
+    }
+    ds_isa_level = -1;
+    bench_sink = ok;
+}
+
+static void bench_utf8(void)
+{
+    struct DSVector *ascii = bench_log_lines(BENCH_LOG_BYTES);
+    struct DSVector *mixed = bench_utf8_lines(BENCH_LOG_BYTES);
+    struct DSVector *vec;
+    const UINT32 chunk = 16384, total = 4u << 20;
+    UINT32 ok = 0;
+    DSSize pos;
+    double t;
+
+    bench_utf8_kernels("log lines", ascii);
+    bench_utf8_kernels("json lines with non-ascii names", mixed);
+
+    /* a payload built up by appends and validated after each one */
+    printf("utf8: %u bytes appended %u at a time, validated after each\n", total, chunk);
+    vec = ds_vector_create_capacity(total + 1);
+    t = bench_now();
+    for (pos = 0; pos < total; pos += chunk) {
+        ds_vector_append(vec, mixed->data + pos, chunk);
+        ok += ds_vector_validate_utf8(vec);
+    }
+    bench_report("incremental", bench_now() - t, total);
+    ds_vector_clear(vec);
+    t = bench_now();
+    for (pos = 0; pos < total; pos += chunk) {
+        ds_vector_append(vec, mixed->data + pos, chunk);
+        ok += ds_view_validate_utf8(ds_vector_view(vec, 0, vec->size));
+    }
+    bench_report("whole buffer each time", bench_now() - t, total);
+
+    bench_sink = ok;
+    ds_vector_free(vec);
+    ds_vector_free(ascii);
+    ds_vector_free(mixed);
+}
+
+struct bench_section {
+    const char *name;
+    void (*run)(void);
+};
+
+static const struct bench_section bench_sections[] = {
+    {"search", bench_search},
+    {"hash", bench_hash},
+    {"compress", bench_compress},
+    {"codec", bench_codec},
+    {"sort", bench_sort},
+    {"parallel", bench_parallel},
+    {"tlb", bench_tlb},
+    {"latency", bench_latency},
+    {"flatmap", bench_flatmap},
+    {"aio", bench_aio},
+    {"utf8", bench_utf8},
+};
+
+int main(int argc, char **argv)
+{
+    UINT32 i;
+    int j;
+
+    for (i = 0; i < sizeof(bench_sections) / sizeof(bench_sections[0]); ++i) {
+        for (j = 1; j < argc && strcmp(argv[j], bench_sections[i].name) != 0; ++j) {
+        }
+        if (argc == 1 || j < argc) {
+            bench_sections[i].run();
+        }
+    }
+    return 0;
+}
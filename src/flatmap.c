@@ -0,0 +1,193 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "flatmap.h"
+
+/*
+ * Keys per prefetch in the Eytzinger search: the 16 descendants four
+ * levels below node k start at slot 16k and fill two cache lines, so
+ * the loads of level i + 4 are in flight while level i is compared.
+ */
+#define DS_FLATMAP_PREFETCH 16
+
+/* a key and its position in the input, sorted by key then position */
+struct DSFlatPair {
+    UINT64 key;
+    UINT32 index;
+    UINT32 pad;
+};
+
+static INT32 ds_flatmap_compare_pair(const void *a, const void *b, void *arg)
+{
+    const struct DSFlatPair *x = (const struct DSFlatPair *)a, *y = (const struct DSFlatPair *)b;
+
+    (void)arg;
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+static void ds_flatmap_put(struct DSFlatMap *map, UINT32 slot, const struct DSFlatPair *pair, const UINT8 *values)
+{
+    ((UINT64 *)map->keys->data)[slot] = pair->key;
+    if (map->value_size) {
+        memcpy(map->values->data + (size_t)slot * map->value_size,
+               values + (size_t)pair->index * map->value_size, map->value_size);
+    }
+}
+
+/* in-order walk of the implicit tree rooted at slot k, taking pairs in sorted order */
+static UINT32 ds_flatmap_fill(struct DSFlatMap *map, const struct DSFlatPair *pairs, const UINT8 *values,
+                              UINT32 next, UINT64 k)
+{
+    if (k <= map->count) {
+        next = ds_flatmap_fill(map, pairs, values, next, 2 * k);
+        ds_flatmap_put(map, (UINT32)k, pairs + next++, values);
+        next = ds_flatmap_fill(map, pairs, values, next, 2 * k + 1);
+    }
+    return next;
+}
+
+struct DSFlatMap *ds_flatmap_build(const UINT64* keys, const UINT8* values, UINT32 count,
+                                   UINT32 value_size, UINT32 flags)
+{
+    struct DSFlatMap *map;
+    struct DSFlatPair *pairs;
+    UINT64 slots = (UINT64)count + 1;
+    UINT32 i, n = 0;
+
+    if ((!keys && count) || (value_size && !values && count)
+        || slots * (value_size > sizeof(UINT64) ? value_size : sizeof(UINT64)) >= DS_SIZE_MAX) {
+        return NULL;
+    }
+    map = (struct DSFlatMap *)malloc(sizeof(struct DSFlatMap));
+    if (!map) {
+        return NULL;
+    }
+    map->value_size = value_size;
+    map->flags = flags & DS_FLATMAP_EYTZINGER;
+    /* aligned keys keep each prefetched group of descendants on whole cache lines */
+    map->keys = ds_vector_create_flags(slots * sizeof(UINT64) + 1, -1, DS_VECTOR_ALIGN_64);
+    map->values = ds_vector_create_capacity(slots * value_size + 1);
+    pairs = (struct DSFlatPair *)malloc((count ? count : 1) * sizeof(struct DSFlatPair));
+    if (!map->keys || !map->values || !pairs) {
+        free(pairs);
+        ds_flatmap_free(map);
+        return NULL;
+    }
+
+    for (i = 0; i < count; ++i) {
+        pairs[i].key = keys[i];
+        pairs[i].index = i;
+        pairs[i].pad = 0;
+    }
+    ds_sort_range((UINT8 *)pairs, count, sizeof(struct DSFlatPair), ds_flatmap_compare_pair, NULL, NULL);
+    /* equal keys are ordered by input position, so the last one wins */
+    for (i = 0; i < count; ++i) {
+        if (n && pairs[n - 1].key == pairs[i].key) {
+            pairs[n - 1] = pairs[i];
+        } else {
+            pairs[n++] = pairs[i];
+        }
+    }
+    map->count = n;
+
+    /* the Eytzinger layout is 1-based; slot 0 is padding */
+    slots = (map->flags & DS_FLATMAP_EYTZINGER) ? (UINT64)n + 1 : n;
+    ds_vector_resize(map->keys, slots * sizeof(UINT64));
+    ds_vector_resize(map->values, slots * value_size);
+    if (map->flags & DS_FLATMAP_EYTZINGER) {
+        ((UINT64 *)map->keys->data)[0] = 0;
+        memset(map->values->data, 0, value_size);
+        ds_flatmap_fill(map, pairs, values, 0, 1);
+    } else {
+        for (i = 0; i < n; ++i) {
+            ds_flatmap_put(map, i, pairs + i, values);
+        }
+    }
+    free(pairs);
+    return map;
+}
+
+void ds_flatmap_free(struct DSFlatMap *map)
+{
+    if (map) {
+        if (map->keys) {
+            ds_vector_free(map->keys);
+        }
+        if (map->values) {
+            ds_vector_free(map->values);
+        }
+        free(map);
+    }
+}
+
+UINT32 ds_flatmap_count(struct DSFlatMap *map)
+{
+    return map ? map->count : 0;
+}
+
+static UINT32 ds_flatmap_lower_bound_sorted(const UINT64 *keys, UINT32 count, UINT64 key)
+{
+    const UINT64 *base = keys;
+    UINT32 n = count, half, index;
+
+    if (!n) {
+        return DS_FLATMAP_NONE;
+    }
+    /* the range narrows by a conditional move; both candidates of the next step are prefetched */
+    while (n > 1) {
+        half = n / 2;
+        __builtin_prefetch(base + half / 2);
+        __builtin_prefetch(base + half + half / 2);
+        base = base[half] < key ? base + half : base;
+        n -= half;
+    }
+    index = (UINT32)(base - keys) + (*base < key);
+    return index < count ? index : DS_FLATMAP_NONE;
+}
+
+static UINT32 ds_flatmap_lower_bound_eytzinger(const UINT64 *keys, UINT32 count, UINT64 key)
+{
+    UINT64 k = 1;
+
+    while (k <= count) {
+        __builtin_prefetch((const UINT8 *)keys + k * DS_FLATMAP_PREFETCH * sizeof(UINT64));
+        k = 2 * k + (keys[k] < key);
+    }
+    /* undo the right turns taken after the last left turn, which was at the answer */
+    k >>= __builtin_ffsll((long long)~k);
+    return k ? (UINT32)k : DS_FLATMAP_NONE;
+}
+
+UINT32 ds_flatmap_lower_bound(struct DSFlatMap *map, UINT64 key)
+{
+    if (!map) {
+        return DS_FLATMAP_NONE;
+    }
+    if (map->flags & DS_FLATMAP_EYTZINGER) {
+        return ds_flatmap_lower_bound_eytzinger((const UINT64 *)map->keys->data, map->count, key);
+    }
+    return ds_flatmap_lower_bound_sorted((const UINT64 *)map->keys->data, map->count, key);
+}
+
+const UINT8* ds_flatmap_find(struct DSFlatMap *map, UINT64 key)
+{
+    UINT32 slot = ds_flatmap_lower_bound(map, key);
+
+    if (slot == DS_FLATMAP_NONE || ((const UINT64 *)map->keys->data)[slot] != key) {
+        return NULL;
+    }
+    return map->values->data + (size_t)slot * map->value_size;
+}
+
+UINT64 ds_flatmap_key(struct DSFlatMap *map, UINT32 slot)
+{
+    return ((const UINT64 *)map->keys->data)[slot];
+}
+
+const UINT8* ds_flatmap_value(struct DSFlatMap *map, UINT32 slot)
+{
+    return map->values->data + (size_t)slot * map->value_size;
+}
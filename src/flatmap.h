@@ -0,0 +1,75 @@
+#ifndef __LIBDS_FLATMAP_H__
+#define __LIBDS_FLATMAP_H__
+
+#include "vector.h"
+
+/*
+ * Read-mostly map from UINT64 keys to fixed-size values, built once in
+ * bulk and kept as two flat vectors instead of a tree of nodes. Keys
+ * are either sorted, searched with a branchless binary search, or laid
+ * out in Eytzinger (breadth-first) order, where the nodes visited by a
+ * search sit close together near the top and the search can prefetch
+ * several levels ahead.
+ *
+ * Lookups return a slot, the position of a key in storage order. Slots
+ * are only meaningful to ds_flatmap_key and ds_flatmap_value; with the
+ * Eytzinger layout they are not in key order.
+ */
+
+/* layout flags for ds_flatmap_build */
+#define DS_FLATMAP_EYTZINGER 0x1
+
+/* returned by lookups when there is no such key */
+#define DS_FLATMAP_NONE 0xFFFFFFFFu
+
+struct DSFlatMap {
+    struct DSVector* keys;      /* UINT64 keys, slot order */
+    struct DSVector* values;    /* value_size bytes per slot */
+    UINT32 count;
+    UINT32 value_size;
+    UINT32 flags;
+};
+
+/**
+ * Builds a map from count keys and, when value_size is not 0, count
+ * values of value_size bytes stored back to back. For a key given more
+ * than once the last value wins. The inputs are copied.
+ * Returns NULL on bad arguments or no memory.
+ * ds_flatmap_free will need to be called.
+ */
+struct DSFlatMap *ds_flatmap_build(const UINT64* keys, const UINT8* values, UINT32 count,
+                                   UINT32 value_size, UINT32 flags);
+
+/**
+ * Frees the map and its vectors.
+ */
+void ds_flatmap_free(struct DSFlatMap *map);
+
+/**
+ * Returns the number of distinct keys.
+ */
+UINT32 ds_flatmap_count(struct DSFlatMap *map);
+
+/**
+ * Returns the slot of the smallest key not less than key,
+ * DS_FLATMAP_NONE when every key is less.
+ */
+UINT32 ds_flatmap_lower_bound(struct DSFlatMap *map, UINT64 key);
+
+/**
+ * Returns the value stored for key, NULL when there is none.
+ * Valid until the map is freed.
+ */
+const UINT8* ds_flatmap_find(struct DSFlatMap *map, UINT64 key);
+
+/**
+ * Returns the key in slot.
+ */
+UINT64 ds_flatmap_key(struct DSFlatMap *map, UINT32 slot);
+
+/**
+ * Returns the value in slot.
+ */
+const UINT8* ds_flatmap_value(struct DSFlatMap *map, UINT32 slot);
+
+#endif
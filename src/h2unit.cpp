@@ -2355,7 +2355,7 @@ public:
     }
 
     if (old_blob) {
-      memcpy(new_blob->ptr, old_blob->ptr, old_size);
+      memcpy(new_blob->ptr, old_blob->ptr, old_size < size ? old_size : size);
       del_blob(old_blob);
     }
     limited -= size;
@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "intern.h"
+
+#define DS_INTERN_MIN_SLOTS 16
+
+static UINT64 ds_intern_hash(const UINT8 *str, UINT32 length)
+{
+    struct DSVectorView view;
+    view.data = str;
+    view.size = length;
+    return ds_view_hash64(view, 0);
+}
+
+/* returns the slot holding the string, or the empty slot where it belongs */
+static UINT32 ds_intern_probe(struct DSInterner *table, const UINT8 *str, UINT32 length, UINT64 hash)
+{
+    UINT32 slot = (UINT32)hash & table->mask, id;
+    struct DSVectorView view;
+
+    for (;;) {
+        id = table->slots[slot];
+        if (!id) {
+            return slot;
+        }
+        view = ds_records_get(table->strings, id - 1);
+        if (view.size == length && (!length || memcmp(view.data, str, length) == 0)) {
+            return slot;
+        }
+        slot = (slot + 1) & table->mask;
+    }
+}
+
+/* doubles the index; the strings are rehashed from the arena, which never moves ids */
+static MYBOOL ds_intern_grow(struct DSInterner *table)
+{
+    UINT32 old_count = table->mask + 1, i, slot;
+    UINT32 *old = table->slots, *slots;
+    struct DSVectorView view;
+
+    if (old_count > 0x80000000u / 2) {
+        return FALSE;
+    }
+    slots = (UINT32 *)calloc((size_t)old_count * 2, sizeof(UINT32));
+    if (!slots) {
+        return FALSE;
+    }
+    table->slots = slots;
+    table->mask = old_count * 2 - 1;
+    for (i = 0; i < old_count; ++i) {
+        if (old[i]) {
+            view = ds_records_get(table->strings, old[i] - 1);
+            slot = (UINT32)ds_intern_hash(view.data, (UINT32)view.size) & table->mask;
+            while (slots[slot]) {
+                slot = (slot + 1) & table->mask;
+            }
+            slots[slot] = old[i];
+        }
+    }
+    free(old);
+    return TRUE;
+}
+
+struct DSInterner *ds_interner_create(UINT32 capacity)
+{
+    struct DSInterner *table = (struct DSInterner *)malloc(sizeof(struct DSInterner));
+    UINT32 count = DS_INTERN_MIN_SLOTS;
+
+    if (!table) {
+        return NULL;
+    }
+    /* keep the load under 3/4 */
+    while (count < 0x80000000u && (UINT64)count * 3 < (UINT64)capacity * 4) {
+        count *= 2;
+    }
+    table->mask = count - 1;
+    table->strings = ds_records_create(0, capacity);
+    table->slots = (UINT32 *)calloc(count, sizeof(UINT32));
+    if (!table->strings || !table->slots) {
+        ds_interner_free(table);
+        return NULL;
+    }
+    return table;
+}
+
+void ds_interner_free(struct DSInterner *table)
+{
+    if (table) {
+        ds_records_free(table->strings);
+        free(table->slots);
+        free(table);
+    }
+}
+
+UINT32 ds_interner_count(struct DSInterner *table)
+{
+    return table ? (UINT32)ds_records_count(table->strings) : 0;
+}
+
+UINT32 ds_intern(struct DSInterner *table, const UINT8* str, UINT32 length)
+{
+    UINT64 hash;
+    UINT32 slot, count;
+
+    if (!table || (!str && length)) {
+        return DS_INTERN_NONE;
+    }
+    hash = ds_intern_hash(str, length);
+    slot = ds_intern_probe(table, str, length, hash);
+    if (table->slots[slot]) {
+        return table->slots[slot] - 1;
+    }
+
+    count = ds_interner_count(table);
+    if (count >= DS_INTERN_NONE - 1) {
+        return DS_INTERN_NONE;
+    }
+    if (((UINT64)count + 1) * 4 > ((UINT64)table->mask + 1) * 3) {
+        if (!ds_intern_grow(table)) {
+            return DS_INTERN_NONE;
+        }
+        slot = ds_intern_probe(table, str, length, hash);
+    }
+    if (!ds_records_append(table->strings, str, length)) {
+        return DS_INTERN_NONE;
+    }
+    table->slots[slot] = count + 1;
+    return count;
+}
+
+UINT32 ds_intern_find(struct DSInterner *table, const UINT8* str, UINT32 length)
+{
+    UINT32 slot;
+
+    if (!table || (!str && length)) {
+        return DS_INTERN_NONE;
+    }
+    slot = ds_intern_probe(table, str, length, ds_intern_hash(str, length));
+    return table->slots[slot] ? table->slots[slot] - 1 : DS_INTERN_NONE;
+}
+
+struct DSVectorView ds_intern_string(struct DSInterner *table, UINT32 id)
+{
+    struct DSVectorView view = {NULL, 0};
+    return table ? ds_records_get(table->strings, id) : view;
+}
+
+UINT64 ds_interner_memory_usage(struct DSInterner *table)
+{
+    if (!table) {
+        return 0;
+    }
+    return sizeof(*table) + sizeof(*table->strings) + ds_vector_memory_usage(table->strings->bytes)
+        + ds_vector_memory_usage(table->strings->offsets) + ((UINT64)table->mask + 1) * sizeof(UINT32);
+}
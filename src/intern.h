@@ -0,0 +1,63 @@
+#ifndef __LIBDS_INTERN_H__
+#define __LIBDS_INTERN_H__
+
+#include "records.h"
+
+/*
+ * String interning: every distinct byte string is stored once, in an
+ * append-only record store, and named by a 32-bit id, its record index.
+ * An open-addressing hash index of ids finds existing strings. Ids are
+ * dense from 0 and stable for the life of the table, so equal strings
+ * compare as equal integers. Each string costs its bytes, one offset and
+ * about two index slots.
+ */
+
+/* returned when a string is not interned or cannot be added */
+#define DS_INTERN_NONE 0xFFFFFFFFu
+
+struct DSInterner {
+    struct DSRecords* strings;  /* id -> bytes */
+    UINT32* slots;              /* id + 1 per slot, 0 = empty */
+    UINT32 mask;                /* slot count - 1, a power of two minus one */
+};
+
+/**
+ * Creates an empty table sized for about capacity strings.
+ * Returns NULL on no memory. ds_interner_free will need to be called.
+ */
+struct DSInterner *ds_interner_create(UINT32 capacity);
+
+/**
+ * Frees the table. Views of its strings become invalid.
+ */
+void ds_interner_free(struct DSInterner *table);
+
+/**
+ * Returns the number of distinct strings.
+ */
+UINT32 ds_interner_count(struct DSInterner *table);
+
+/**
+ * Returns the id of the length bytes at str, adding them to the table
+ * when they are new. Returns DS_INTERN_NONE on bad arguments or no memory.
+ */
+UINT32 ds_intern(struct DSInterner *table, const UINT8* str, UINT32 length);
+
+/**
+ * Returns the id of the length bytes at str without adding them,
+ * DS_INTERN_NONE when they are not in the table.
+ */
+UINT32 ds_intern_find(struct DSInterner *table, const UINT8* str, UINT32 length);
+
+/**
+ * Returns the bytes of string id, valid until the next ds_intern.
+ * An unknown id gives an empty view with data == NULL.
+ */
+struct DSVectorView ds_intern_string(struct DSInterner *table, UINT32 id);
+
+/**
+ * Returns the bytes of heap memory held by the table.
+ */
+UINT64 ds_interner_memory_usage(struct DSInterner *table);
+
+#endif
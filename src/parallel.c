@@ -0,0 +1,628 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "parallel.h"
+
+/*
+ * Work-stealing pool. Each participant owns a small deque of index
+ * ranges. A participant pops from the back of its own deque and, when
+ * the range holds more than one index, pushes the upper half back
+ * before running the lower half, so big ranges stay at the front
+ * where idle participants steal them. The last deque belongs to
+ * threads calling into the pool from outside.
+ */
+#define DS_QUEUE_SIZE     256
+#define DS_PARALLEL_MAX   256
+#define DS_SORT_MIN_PART  (16u << 10)
+#define DS_COPY_PIECE     (1u << 20)
+
+struct DSJob {
+    void (*run)(UINT32 index, void *arg);
+    void *arg;
+    UINT32 remaining;
+};
+
+struct DSTaskRange {
+    struct DSJob *job;
+    UINT32 begin;
+    UINT32 end;
+};
+
+struct DSWorkQueue {
+    pthread_mutex_t lock;
+    UINT32 head;
+    UINT32 tail;
+    struct DSTaskRange items[DS_QUEUE_SIZE];
+};
+
+struct DSPool {
+    UINT32 threads;
+    UINT32 chunk_bytes;
+    struct DSWorkQueue *queues;
+    pthread_t *workers;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    UINT32 pending;
+    UINT32 sleepers;
+    MYBOOL stop;
+};
+
+static struct DSPool ds_pool;
+static MYBOOL ds_pool_running = FALSE;
+
+static MYBOOL ds_queue_push(struct DSWorkQueue *queue, struct DSTaskRange range)
+{
+    MYBOOL pushed = FALSE;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->tail - queue->head < DS_QUEUE_SIZE) {
+        queue->items[queue->tail++ % DS_QUEUE_SIZE] = range;
+        pushed = TRUE;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return pushed;
+}
+
+static MYBOOL ds_queue_pop(struct DSWorkQueue *queue, struct DSTaskRange *range, MYBOOL steal)
+{
+    MYBOOL popped = FALSE;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->tail != queue->head) {
+        *range = steal ? queue->items[queue->head++ % DS_QUEUE_SIZE] : queue->items[--queue->tail % DS_QUEUE_SIZE];
+        popped = TRUE;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return popped;
+}
+
+/* queues a range on participant self and wakes a sleeping worker if there is one */
+static MYBOOL ds_pool_push(UINT32 self, struct DSTaskRange range)
+{
+    if (!ds_queue_push(&ds_pool.queues[self], range)) {
+        return FALSE;
+    }
+    __atomic_add_fetch(&ds_pool.pending, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ds_pool.sleepers, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&ds_pool.lock);
+        pthread_cond_signal(&ds_pool.wake);
+        pthread_mutex_unlock(&ds_pool.lock);
+    }
+    return TRUE;
+}
+
+/* takes a range from our own deque first, then steals from the others */
+static MYBOOL ds_pool_take(UINT32 self, struct DSTaskRange *range)
+{
+    UINT32 i, victim;
+
+    if (ds_queue_pop(&ds_pool.queues[self], range, FALSE)) {
+        __atomic_sub_fetch(&ds_pool.pending, 1, __ATOMIC_SEQ_CST);
+        return TRUE;
+    }
+    for (i = 1; i < ds_pool.threads; ++i) {
+        victim = (self + i) % ds_pool.threads;
+        if (ds_queue_pop(&ds_pool.queues[victim], range, TRUE)) {
+            __atomic_sub_fetch(&ds_pool.pending, 1, __ATOMIC_SEQ_CST);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static void ds_pool_execute(UINT32 self, struct DSTaskRange range)
+{
+    struct DSTaskRange upper;
+    UINT32 done;
+
+    while (range.end - range.begin > 1) {
+        upper = range;
+        upper.begin = range.begin + (range.end - range.begin) / 2;
+        if (!ds_pool_push(self, upper)) {
+            break;
+        }
+        range.end = upper.begin;
+    }
+    for (done = 0; range.begin < range.end; ++range.begin, ++done) {
+        range.job->run(range.begin, range.job->arg);
+    }
+    if (__atomic_sub_fetch(&range.job->remaining, done, __ATOMIC_ACQ_REL) == 0) {
+        pthread_mutex_lock(&ds_pool.lock);
+        pthread_cond_broadcast(&ds_pool.done);
+        pthread_mutex_unlock(&ds_pool.lock);
+    }
+}
+
+static void *ds_pool_worker(void *arg)
+{
+    UINT32 self = (UINT32)(size_t)arg;
+    struct DSTaskRange range;
+
+    for (;;) {
+        if (ds_pool_take(self, &range)) {
+            ds_pool_execute(self, range);
+            continue;
+        }
+        pthread_mutex_lock(&ds_pool.lock);
+        __atomic_add_fetch(&ds_pool.sleepers, 1, __ATOMIC_SEQ_CST);
+        while (!ds_pool.stop && __atomic_load_n(&ds_pool.pending, __ATOMIC_SEQ_CST) == 0) {
+            pthread_cond_wait(&ds_pool.wake, &ds_pool.lock);
+        }
+        __atomic_sub_fetch(&ds_pool.sleepers, 1, __ATOMIC_SEQ_CST);
+        if (ds_pool.stop) {
+            pthread_mutex_unlock(&ds_pool.lock);
+            return NULL;
+        }
+        pthread_mutex_unlock(&ds_pool.lock);
+    }
+}
+
+UINT32 ds_parallel_init(UINT32 threads, UINT32 chunk_bytes)
+{
+    UINT32 i;
+    long cpus;
+
+    if (ds_pool_running) {
+        ds_parallel_shutdown();
+    }
+    if (threads == 0) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (UINT32)cpus : 1;
+    }
+    if (threads > DS_PARALLEL_MAX) {
+        threads = DS_PARALLEL_MAX;
+    }
+    memset(&ds_pool, 0, sizeof(ds_pool));
+    ds_pool.threads = threads;
+    ds_pool.chunk_bytes = chunk_bytes ? chunk_bytes : DS_PARALLEL_CHUNK_BYTES;
+    ds_pool.queues = (struct DSWorkQueue *)malloc(sizeof(struct DSWorkQueue) * threads);
+    ds_pool.workers = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+    if (!ds_pool.queues || !ds_pool.workers) {
+        free(ds_pool.queues);
+        free(ds_pool.workers);
+        return 0;
+    }
+    for (i = 0; i < threads; ++i) {
+        pthread_mutex_init(&ds_pool.queues[i].lock, NULL);
+        ds_pool.queues[i].head = 0;
+        ds_pool.queues[i].tail = 0;
+    }
+    pthread_mutex_init(&ds_pool.lock, NULL);
+    pthread_cond_init(&ds_pool.wake, NULL);
+    pthread_cond_init(&ds_pool.done, NULL);
+
+    /* participant threads - 1 is the calling side */
+    for (i = 0; i + 1 < threads; ++i) {
+        if (pthread_create(&ds_pool.workers[i], NULL, ds_pool_worker, (void *)(size_t)i) != 0) {
+            break;
+        }
+    }
+    if (i + 1 < threads) {
+        ds_pool.threads = i + 1;
+        ds_pool_running = TRUE;
+        ds_parallel_shutdown();
+        return 0;
+    }
+    ds_pool_running = TRUE;
+    return threads;
+}
+
+void ds_parallel_shutdown(void)
+{
+    UINT32 i;
+
+    if (!ds_pool_running) {
+        return;
+    }
+    pthread_mutex_lock(&ds_pool.lock);
+    ds_pool.stop = TRUE;
+    pthread_cond_broadcast(&ds_pool.wake);
+    pthread_mutex_unlock(&ds_pool.lock);
+    for (i = 0; i + 1 < ds_pool.threads; ++i) {
+        pthread_join(ds_pool.workers[i], NULL);
+    }
+    for (i = 0; i < ds_pool.threads; ++i) {
+        pthread_mutex_destroy(&ds_pool.queues[i].lock);
+    }
+    pthread_mutex_destroy(&ds_pool.lock);
+    pthread_cond_destroy(&ds_pool.wake);
+    pthread_cond_destroy(&ds_pool.done);
+    free(ds_pool.queues);
+    free(ds_pool.workers);
+    ds_pool_running = FALSE;
+}
+
+UINT32 ds_parallel_threads(void)
+{
+    return ds_pool_running ? ds_pool.threads : 1;
+}
+
+void ds_parallel_run(UINT32 count, void (*run)(UINT32 index, void *arg), void *arg)
+{
+    struct DSJob job;
+    struct DSTaskRange range;
+    UINT32 self, i, parts;
+
+    if (count == 0) {
+        return;
+    }
+    if (!ds_pool_running || ds_pool.threads == 1 || count == 1) {
+        for (i = 0; i < count; ++i) {
+            run(i, arg);
+        }
+        return;
+    }
+
+    job.run = run;
+    job.arg = arg;
+    job.remaining = count;
+    self = ds_pool.threads - 1;
+
+    /* hand every participant one contiguous slice up front */
+    parts = count < ds_pool.threads ? count : ds_pool.threads;
+    for (i = parts; i-- > 0;) {
+        range.job = &job;
+        range.begin = (UINT32)((UINT64)count * i / parts);
+        range.end = (UINT32)((UINT64)count * (i + 1) / parts);
+        if (!ds_pool_push((self + 1 + i) % ds_pool.threads, range)) {
+            ds_pool_execute(self, range);
+        }
+    }
+
+    while (__atomic_load_n(&job.remaining, __ATOMIC_ACQUIRE) > 0) {
+        if (ds_pool_take(self, &range)) {
+            ds_pool_execute(self, range);
+            continue;
+        }
+        pthread_mutex_lock(&ds_pool.lock);
+        while (__atomic_load_n(&job.remaining, __ATOMIC_ACQUIRE) > 0 &&
+               __atomic_load_n(&ds_pool.pending, __ATOMIC_SEQ_CST) == 0) {
+            pthread_cond_wait(&ds_pool.done, &ds_pool.lock);
+        }
+        pthread_mutex_unlock(&ds_pool.lock);
+    }
+}
+
+/* chunk layout shared by the vector level functions */
+struct DSChunks {
+    UINT8 *data;
+    const UINT8 *src;
+    UINT32 elem_size;
+    UINT32 elems;
+    UINT32 per_chunk;
+    UINT32 count;
+    void *fn;
+    void *combine;
+    void *arg;
+    UINT64 *partial;
+};
+
+static MYBOOL ds_chunks_init(struct DSChunks *chunks, struct DSVector *vec, UINT32 elem_size)
+{
+    UINT32 chunk_bytes = ds_pool_running ? ds_pool.chunk_bytes : DS_PARALLEL_CHUNK_BYTES;
+
+    if (!vec || elem_size == 0 || vec->size % elem_size || vec->size / elem_size > 0xFFFFFFFFu) {
+        return FALSE;
+    }
+    ds_vector_settle(vec);
+    memset(chunks, 0, sizeof(*chunks));
+    chunks->data = vec->data;
+    chunks->elem_size = elem_size;
+    chunks->elems = (UINT32)(vec->size / elem_size);
+    chunks->per_chunk = chunk_bytes / elem_size ? chunk_bytes / elem_size : 1;
+    chunks->count = (UINT32)(((UINT64)chunks->elems + chunks->per_chunk - 1) / chunks->per_chunk);
+    return TRUE;
+}
+
+static UINT32 ds_chunk_first(struct DSChunks *chunks, UINT32 index, UINT32 *count)
+{
+    UINT32 first = index * chunks->per_chunk;
+    *count = chunks->elems - first < chunks->per_chunk ? chunks->elems - first : chunks->per_chunk;
+    return first;
+}
+
+static void ds_parallel_for_chunk(UINT32 index, void *arg)
+{
+    struct DSChunks *chunks = (struct DSChunks *)arg;
+    UINT32 count, first = ds_chunk_first(chunks, index, &count);
+    ((DSParallelFn)chunks->fn)(chunks->data + (size_t)first * chunks->elem_size, count, first, chunks->arg);
+}
+
+UINT32 ds_parallel_for(struct DSVector *vec, UINT32 elem_size, DSParallelFn fn, void *arg)
+{
+    struct DSChunks chunks;
+
+    if (!fn || !ds_chunks_init(&chunks, vec, elem_size)) {
+        return 0;
+    }
+    chunks.fn = (void *)fn;
+    chunks.arg = arg;
+    ds_vector_modified(vec, 0);
+    ds_parallel_run(chunks.count, ds_parallel_for_chunk, &chunks);
+    return chunks.elems;
+}
+
+static void ds_parallel_transform_chunk(UINT32 index, void *arg)
+{
+    struct DSChunks *chunks = (struct DSChunks *)arg;
+    UINT32 count, first = ds_chunk_first(chunks, index, &count);
+    size_t offset = (size_t)first * chunks->elem_size;
+    ((DSTransformFn)chunks->fn)(chunks->src + offset, chunks->data + offset, count, first, chunks->arg);
+}
+
+UINT32 ds_parallel_transform(struct DSVector *dst, struct DSVector *src, UINT32 elem_size, DSTransformFn fn, void *arg)
+{
+    struct DSChunks chunks;
+
+    if (!dst || !fn || dst == src || !ds_chunks_init(&chunks, src, elem_size)) {
+        return 0;
+    }
+    if (ds_vector_resize(dst, src->size) != src->size) {
+        return 0;
+    }
+    chunks.src = src->data;
+    chunks.data = dst->data;
+    chunks.fn = (void *)fn;
+    chunks.arg = arg;
+    ds_vector_modified(dst, 0);
+    ds_parallel_run(chunks.count, ds_parallel_transform_chunk, &chunks);
+    return chunks.elems;
+}
+
+static void ds_parallel_reduce_chunk(UINT32 index, void *arg)
+{
+    struct DSChunks *chunks = (struct DSChunks *)arg;
+    UINT32 count, first = ds_chunk_first(chunks, index, &count);
+    chunks->partial[index] = ((DSReduceFn)chunks->fn)(chunks->data + (size_t)first * chunks->elem_size,
+                                                      count, first, chunks->arg);
+}
+
+UINT64 ds_parallel_reduce(struct DSVector *vec, UINT32 elem_size, UINT64 init,
+                          DSReduceFn map, DSCombineFn combine, void *arg)
+{
+    struct DSChunks chunks;
+    UINT64 result = init;
+    UINT32 i;
+
+    if (!map || !combine || !ds_chunks_init(&chunks, vec, elem_size) || chunks.count == 0) {
+        return init;
+    }
+    chunks.fn = (void *)map;
+    chunks.arg = arg;
+    chunks.partial = (UINT64 *)malloc(sizeof(UINT64) * chunks.count);
+    if (!chunks.partial) {
+        return init;
+    }
+    ds_parallel_run(chunks.count, ds_parallel_reduce_chunk, &chunks);
+    for (i = 0; i < chunks.count; ++i) {
+        result = combine(result, chunks.partial[i], arg);
+    }
+    free(chunks.partial);
+    return result;
+}
+
+/*
+ * Parallel concat: the output is cut into equal pieces by destination
+ * offset, so a piece may span several sources and a large source is
+ * shared by several pieces. offsets[i] is where source i starts.
+ */
+struct DSConcatJob {
+    UINT8 *dest;
+    struct DSVector **srcs;
+    DSSize *offsets;
+    UINT32 n;
+    DSSize total;
+    UINT32 pieces;
+};
+
+static void ds_parallel_concat_piece(UINT32 index, void *arg)
+{
+    struct DSConcatJob *job = (struct DSConcatJob *)arg;
+    /* total * index / pieces, without overflowing the product */
+    DSSize q = job->total / job->pieces, r = job->total % job->pieces;
+    DSSize d0 = q * index + r * index / job->pieces;
+    DSSize d1 = q * (index + 1) + r * (index + 1) / job->pieces;
+    DSSize from, len;
+    UINT32 lo = 0, hi = job->n, mid;
+
+    /* last source starting at or before d0 */
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if (job->offsets[mid] <= d0) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    for (; d0 < d1; ++lo) {
+        if (!job->srcs[lo]) {
+            continue;
+        }
+        from = d0 - job->offsets[lo];
+        len = job->srcs[lo]->size - from < d1 - d0 ? job->srcs[lo]->size - from : d1 - d0;
+        memcpy(job->dest + d0, job->srcs[lo]->data + from, len);
+        d0 += len;
+    }
+}
+
+DSSize ds_parallel_concat(struct DSVector *dest, struct DSVector **srcs, UINT32 n)
+{
+    struct DSConcatJob job;
+    UINT64 total = 0;
+    DSSize old_size;
+    UINT32 i, threads = ds_parallel_threads();
+
+    if (!dest || !srcs || n == 0) {
+        return 0;
+    }
+    for (i = 0; i < n; ++i) {
+        ds_vector_settle(srcs[i]);
+        total += srcs[i] && srcs[i] != dest ? srcs[i]->size : 0;
+    }
+    if (threads == 1 || total < DS_PARALLEL_CONCAT_MIN || total > (UINT64)(DS_SIZE_MAX - dest->size - 1)) {
+        return ds_vector_concat_many(dest, srcs, n);
+    }
+    for (i = 0; i < n; ++i) {
+        if (srcs[i] == dest) {
+            return 0;
+        }
+    }
+    job.offsets = (DSSize *)malloc(sizeof(DSSize) * n);
+    if (!job.offsets) {
+        return 0;
+    }
+    old_size = dest->size;
+    if (ds_vector_resize(dest, old_size + (DSSize)total) != old_size + total) {
+        free(job.offsets);
+        return 0;
+    }
+    for (i = 0, total = 0; i < n; ++i) {
+        job.offsets[i] = (DSSize)total;
+        total += srcs[i] ? srcs[i]->size : 0;
+    }
+    job.dest = dest->data + old_size;
+    job.srcs = srcs;
+    job.n = n;
+    job.total = (DSSize)total;
+    job.pieces = (UINT32)(total / DS_COPY_PIECE);
+    if (job.pieces < threads * 4) {
+        job.pieces = threads * 4;
+    }
+    ds_parallel_run(job.pieces, ds_parallel_concat_piece, &job);
+    free(job.offsets);
+    return job.total;
+}
+
+/*
+ * Parallel sort: parts are sorted independently, then merged pairwise
+ * in rounds between the vector and a scratch buffer. Every merge is cut
+ * into segments at equal output offsets; the matching input split is
+ * found by binary search (merge path), so segments run independently.
+ */
+struct DSSortJob {
+    UINT8 *data;
+    UINT8 *scratch;
+    UINT8 *from;
+    UINT8 *to;
+    UINT32 es;
+    UINT32 n;
+    UINT32 parts;
+    UINT32 width;
+    UINT32 segments;
+    DSCompare cmp;
+    void *arg;
+};
+
+static UINT32 ds_sort_part_begin(struct DSSortJob *job, UINT32 part)
+{
+    if (part >= job->parts) {
+        return job->n;
+    }
+    return (UINT32)((UINT64)job->n * part / job->parts);
+}
+
+static void ds_parallel_sort_part(UINT32 index, void *arg)
+{
+    struct DSSortJob *job = (struct DSSortJob *)arg;
+    UINT32 begin = ds_sort_part_begin(job, index), end = ds_sort_part_begin(job, index + 1);
+    size_t offset = (size_t)begin * job->es;
+
+    ds_sort_range(job->data + offset, end - begin, job->es, job->cmp == ds_vector_key_compare(job->es) ? NULL : job->cmp,
+                  job->arg, job->scratch + offset);
+}
+
+/* number of elements taken from a when the first d merged elements are emitted */
+static UINT32 ds_merge_path(struct DSSortJob *job, const UINT8 *a, UINT32 la, const UINT8 *b, UINT32 lb, UINT32 d)
+{
+    UINT32 lo = d > lb ? d - lb : 0, hi = d < la ? d : la, i, j;
+
+    while (lo < hi) {
+        i = lo + (hi - lo) / 2;
+        j = d - i;
+        if (j > 0 && i < la && job->cmp(b + (size_t)(j - 1) * job->es, a + (size_t)i * job->es, job->arg) >= 0) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+static void ds_parallel_merge_segment(UINT32 index, void *arg)
+{
+    struct DSSortJob *job = (struct DSSortJob *)arg;
+    UINT32 pair = index / job->segments, seg = index % job->segments;
+    UINT32 begin = ds_sort_part_begin(job, pair * 2 * job->width);
+    UINT32 mid = ds_sort_part_begin(job, pair * 2 * job->width + job->width);
+    UINT32 end = ds_sort_part_begin(job, (pair + 1) * 2 * job->width);
+    UINT32 la = mid - begin, lb = end - mid, total = end - begin;
+    UINT32 d0 = (UINT32)((UINT64)total * seg / job->segments), d1 = (UINT32)((UINT64)total * (seg + 1) / job->segments);
+    const UINT8 *a = job->from + (size_t)begin * job->es, *b = job->from + (size_t)mid * job->es;
+    UINT32 i = ds_merge_path(job, a, la, b, lb, d0), ie = ds_merge_path(job, a, la, b, lb, d1);
+    UINT32 j = d0 - i, je = d1 - ie;
+    UINT8 *out = job->to + ((size_t)begin + d0) * job->es;
+    size_t es = job->es;
+
+    while (i < ie && j < je) {
+        if (job->cmp(b + j * es, a + i * es, job->arg) < 0) {
+            memcpy(out, b + j++ * es, es);
+        } else {
+            memcpy(out, a + i++ * es, es);
+        }
+        out += es;
+    }
+    memcpy(out, a + i * es, (ie - i) * es);
+    out += (ie - i) * es;
+    memcpy(out, b + j * es, (je - j) * es);
+}
+
+static void ds_parallel_copy_back(UINT32 index, void *arg)
+{
+    struct DSSortJob *job = (struct DSSortJob *)arg;
+    UINT32 begin = ds_sort_part_begin(job, index), end = ds_sort_part_begin(job, index + 1);
+    memcpy(job->data + (size_t)begin * job->es, job->scratch + (size_t)begin * job->es, (size_t)(end - begin) * job->es);
+}
+
+UINT32 ds_parallel_sort(struct DSVector *vec, UINT32 elem_size, DSCompare cmp, void *arg)
+{
+    struct DSSortJob job;
+    UINT32 threads = ds_parallel_threads(), pairs;
+    UINT8 *tmp;
+
+    if (!vec || elem_size == 0 || vec->size % elem_size || vec->size / elem_size > 0xFFFFFFFFu ||
+        (!cmp && !ds_vector_key_compare(elem_size))) {
+        return 0;
+    }
+    memset(&job, 0, sizeof(job));
+    job.es = elem_size;
+    job.n = (UINT32)(vec->size / elem_size);
+    job.cmp = cmp ? cmp : ds_vector_key_compare(elem_size);
+    job.arg = arg;
+    job.data = vec->data;
+    job.scratch = (UINT8 *)malloc(vec->size ? vec->size : 1);
+    if (!job.scratch) {
+        return 0;
+    }
+    ds_vector_modified(vec, 0);
+
+    for (job.parts = 1; job.parts < threads && job.n / (job.parts * 2) >= DS_SORT_MIN_PART; job.parts *= 2) {
+    }
+    ds_parallel_run(job.parts, ds_parallel_sort_part, &job);
+
+    job.from = job.data;
+    job.to = job.scratch;
+    for (job.width = 1; job.width < job.parts; job.width *= 2) {
+        pairs = job.parts / (2 * job.width);
+        job.segments = (2 * threads + pairs - 1) / pairs;
+        ds_parallel_run(pairs * job.segments, ds_parallel_merge_segment, &job);
+        tmp = job.from;
+        job.from = job.to;
+        job.to = tmp;
+    }
+    if (job.from != job.data) {
+        ds_parallel_run(job.parts, ds_parallel_copy_back, &job);
+    }
+    free(job.scratch);
+    return job.n;
+}
@@ -0,0 +1,89 @@
+#ifndef __LIBDS_PARALLEL_H__
+#define __LIBDS_PARALLEL_H__
+
+#include "vector.h"
+
+/*
+ * Parallel algorithms over vector contents, run on a library-owned
+ * work-stealing thread pool. Contents are treated as an array of
+ * elements of elem_size bytes and split into chunks of about
+ * chunk_bytes; each worker drains its own queue of chunks and steals
+ * from the others when it runs dry.
+ *
+ * Without ds_parallel_init (or for inputs of a single chunk) every
+ * function runs on the calling thread. Callbacks run concurrently on
+ * different chunks and must not allocate through the vector API.
+ * Element counts are 32-bit; larger vectors are rejected.
+ */
+
+/* default bytes per chunk */
+#define DS_PARALLEL_CHUNK_BYTES (256u << 10)
+
+/* ds_parallel_concat copies on the calling thread below this many bytes */
+#define DS_PARALLEL_CONCAT_MIN (8u << 20)
+
+/* called for count elements starting at element index first */
+typedef void (*DSParallelFn)(UINT8* data, UINT32 count, UINT32 first, void* arg);
+typedef void (*DSTransformFn)(const UINT8* src, UINT8* dst, UINT32 count, UINT32 first, void* arg);
+typedef UINT64 (*DSReduceFn)(const UINT8* data, UINT32 count, UINT32 first, void* arg);
+typedef UINT64 (*DSCombineFn)(UINT64 a, UINT64 b, void* arg);
+
+/**
+ * Starts the pool with threads participants, counting the calling
+ * thread (0 = one per online CPU), and sets the chunk size (0 = default).
+ * Returns the number of participants, 0 on failure.
+ */
+UINT32 ds_parallel_init(UINT32 threads, UINT32 chunk_bytes);
+
+/**
+ * Stops and joins the pool threads. Must not race with running jobs.
+ */
+void ds_parallel_shutdown(void);
+
+/**
+ * Returns the number of participants, 1 when the pool is not running.
+ */
+UINT32 ds_parallel_threads(void);
+
+/**
+ * Runs job(index, arg) for every index in [0, count) on the pool and
+ * waits for all of them. The building block of the functions below.
+ */
+void ds_parallel_run(UINT32 count, void (*job)(UINT32 index, void* arg), void* arg);
+
+/**
+ * Calls fn on every chunk of vec in parallel. fn may modify the bytes
+ * of its own chunk. Returns the number of elements.
+ */
+UINT32 ds_parallel_for(struct DSVector *vec, UINT32 elem_size, DSParallelFn fn, void* arg);
+
+/**
+ * Resizes dst to the size of src and lets fn fill each chunk of dst
+ * from the matching chunk of src. Returns the number of elements.
+ */
+UINT32 ds_parallel_transform(struct DSVector *dst, struct DSVector *src, UINT32 elem_size, DSTransformFn fn, void* arg);
+
+/**
+ * Maps every chunk to a value with map and folds the values, in chunk
+ * order, with combine starting from init.
+ */
+UINT64 ds_parallel_reduce(struct DSVector *vec, UINT32 elem_size, UINT64 init,
+                          DSReduceFn map, DSCombineFn combine, void* arg);
+
+/**
+ * ds_vector_concat_many with the copy split across the pool by
+ * destination offset once the total reaches DS_PARALLEL_CONCAT_MIN.
+ * Returns the number of bytes appended, 0 on failure.
+ */
+DSSize ds_parallel_concat(struct DSVector *dest, struct DSVector **srcs, UINT32 n);
+
+/**
+ * Sorts vec in parallel: chunks are sorted independently (radix sort
+ * for keys when cmp is NULL, pdqsort otherwise) and then merged in
+ * rounds, each merge split across the pool by merge-path partitioning.
+ * Needs a scratch buffer the size of the vector.
+ * Returns the number of elements, 0 on bad arguments or no memory.
+ */
+UINT32 ds_parallel_sort(struct DSVector *vec, UINT32 elem_size, DSCompare cmp, void* arg);
+
+#endif
@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "records.h"
+
+static DSSize *ds_records_offsets(struct DSRecords *rec)
+{
+    return (DSSize *)rec->offsets->data;
+}
+
+struct DSRecords *ds_records_create(DSSize byte_capacity, DSSize record_capacity)
+{
+    struct DSRecords *rec = (struct DSRecords *)malloc(sizeof(struct DSRecords));
+    DSSize start = 0;
+
+    if (!rec) {
+        return NULL;
+    }
+    /* both vectors keep a spare byte past their contents */
+    if (byte_capacity == DS_SIZE_MAX) {
+        --byte_capacity;
+    }
+    if (record_capacity > DS_SIZE_MAX / sizeof(DSSize) - 2) {
+        record_capacity = DS_SIZE_MAX / sizeof(DSSize) - 2;
+    }
+    rec->bytes = ds_vector_create_capacity(byte_capacity + 1);
+    rec->offsets = ds_vector_create_capacity((record_capacity + 1) * sizeof(DSSize) + 1);
+    if (!rec->bytes || !rec->offsets || !ds_vector_append(rec->offsets, (UINT8 *)&start, sizeof(start))) {
+        ds_records_free(rec);
+        return NULL;
+    }
+    return rec;
+}
+
+void ds_records_free(struct DSRecords *rec)
+{
+    if (rec) {
+        if (rec->bytes) {
+            ds_vector_free(rec->bytes);
+        }
+        if (rec->offsets) {
+            ds_vector_free(rec->offsets);
+        }
+        free(rec);
+    }
+}
+
+DSSize ds_records_count(struct DSRecords *rec)
+{
+    return rec ? rec->offsets->size / sizeof(DSSize) - 1 : 0;
+}
+
+DSSize ds_records_append(struct DSRecords *rec, const UINT8* data, DSSize length)
+{
+    DSSize end;
+
+    if (!rec || (!data && length) || length > DS_SIZE_MAX - rec->bytes->size) {
+        return 0;
+    }
+    end = rec->bytes->size + length;
+    if (!ds_vector_append(rec->offsets, (UINT8 *)&end, sizeof(end))) {
+        return 0;
+    }
+    if (length && !ds_vector_append(rec->bytes, (UINT8 *)data, length)) {
+        ds_vector_resize(rec->offsets, rec->offsets->size - sizeof(end));
+        return 0;
+    }
+    return ds_records_count(rec);
+}
+
+DSSize ds_records_append_many(struct DSRecords *rec, const UINT8* data, const DSSize* lengths, DSSize n)
+{
+    DSSize total = 0, old_size, end, i, *offsets;
+
+    if (!rec || (!lengths && n)) {
+        return 0;
+    }
+    for (i = 0; i < n; ++i) {
+        if (lengths[i] > DS_SIZE_MAX - total) {
+            return 0;
+        }
+        total += lengths[i];
+    }
+    old_size = rec->offsets->size;
+    if ((!data && total) || total > DS_SIZE_MAX - rec->bytes->size
+        || n > (DS_SIZE_MAX - old_size) / sizeof(DSSize)) {
+        return 0;
+    }
+
+    /* one growth per vector for the whole batch */
+    if (!ds_vector_resize(rec->offsets, old_size + n * sizeof(DSSize))) {
+        return 0;
+    }
+    if (total && !ds_vector_append(rec->bytes, (UINT8 *)data, total)) {
+        ds_vector_resize(rec->offsets, old_size);
+        return 0;
+    }
+    offsets = (DSSize *)(rec->offsets->data + old_size);
+    end = rec->bytes->size - total;
+    for (i = 0; i < n; ++i) {
+        end += lengths[i];
+        offsets[i] = end;
+    }
+    return ds_records_count(rec);
+}
+
+struct DSVectorView ds_records_get(struct DSRecords *rec, DSSize index)
+{
+    struct DSVectorView view = {NULL, 0};
+    DSSize *offsets;
+
+    if (!rec || index >= ds_records_count(rec)) {
+        return view;
+    }
+    offsets = ds_records_offsets(rec);
+    view.data = rec->bytes->data + offsets[index];
+    view.size = offsets[index + 1] - offsets[index];
+    return view;
+}
+
+void ds_records_clear(struct DSRecords *rec)
+{
+    if (rec) {
+        ds_vector_clear(rec->bytes);
+        ds_vector_resize(rec->offsets, sizeof(DSSize));
+    }
+}
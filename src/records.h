@@ -0,0 +1,60 @@
+#ifndef __LIBDS_RECORDS_H__
+#define __LIBDS_RECORDS_H__
+
+#include "vector.h"
+
+/*
+ * Variable-length records packed back to back in one byte vector, with
+ * a second vector of DSSize offsets where record i spans
+ * [offsets[i], offsets[i + 1]). Finding a record is a pair of loads
+ * instead of a scan, and both vectors grow geometrically, so appends
+ * allocate once per growth rather than once per record.
+ */
+struct DSRecords {
+    struct DSVector* bytes;     /* record contents */
+    struct DSVector* offsets;   /* count + 1 DSSize offsets into bytes, starting at 0 */
+};
+
+/**
+ * Creates an empty record store with room for about byte_capacity
+ * bytes and record_capacity records. Returns NULL on no memory.
+ * ds_records_free will need to be called.
+ */
+struct DSRecords *ds_records_create(DSSize byte_capacity, DSSize record_capacity);
+
+/**
+ * Frees the store and both of its vectors.
+ */
+void ds_records_free(struct DSRecords *rec);
+
+/**
+ * Returns the number of records.
+ */
+DSSize ds_records_count(struct DSRecords *rec);
+
+/**
+ * Appends one record of length bytes, which may be 0.
+ * Returns the new number of records, 0 on failure.
+ */
+DSSize ds_records_append(struct DSRecords *rec, const UINT8* data, DSSize length);
+
+/**
+ * Appends n records whose contents lie back to back in data, record i
+ * being lengths[i] bytes long. Either all of them are appended or none.
+ * Returns the new number of records, 0 on failure.
+ */
+DSSize ds_records_append_many(struct DSRecords *rec, const UINT8* data, const DSSize* lengths, DSSize n);
+
+/**
+ * Returns a view of record index in constant time. Valid until the next
+ * append. An index past the end gives an empty view with data == NULL;
+ * an empty record gives a non-NULL data pointer.
+ */
+struct DSVectorView ds_records_get(struct DSRecords *rec, DSSize index);
+
+/**
+ * Removes every record and keeps the capacity of both vectors.
+ */
+void ds_records_clear(struct DSRecords *rec);
+
+#endif
@@ -0,0 +1,307 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "snapshot.h"
+
+#define DS_SNAPSHOT_MAGIC    "DSSNAP\r\n"
+#define DS_SNAPSHOT_MIN_PAGE 4096u
+
+struct DSSnapshotHeader {
+    char magic[8];
+    UINT32 version;
+    UINT32 count;           /* directory entries */
+    UINT64 page_size;       /* alignment of the vector offsets */
+    UINT64 length;          /* of the whole file */
+    UINT32 dir_crc;         /* CRC32C of the directory */
+    UINT32 header_crc;      /* CRC32C of the header bytes before this field */
+    UINT8 reserved[24];
+};
+
+struct DSSnapshotEntry {
+    char name[DS_SNAPSHOT_NAME_MAX + 1];    /* NUL padded */
+    UINT32 crc;             /* CRC32C of the vector bytes */
+    UINT64 offset;
+    UINT64 size;
+};
+
+/* both records are 64 bytes on disk */
+typedef char ds_snapshot_header_size[sizeof(struct DSSnapshotHeader) == 64 ? 1 : -1];
+typedef char ds_snapshot_entry_size[sizeof(struct DSSnapshotEntry) == 64 ? 1 : -1];
+
+static UINT64 ds_snapshot_round(UINT64 bytes, UINT64 page)
+{
+    return (bytes + page - 1) & ~(page - 1);
+}
+
+/* bytes a vector of size bytes takes in the file: whole pages, with room for the spare byte */
+static UINT64 ds_snapshot_span(UINT64 size, UINT64 page)
+{
+    return ds_snapshot_round(size + 1, page);
+}
+
+static MYBOOL ds_snapshot_pwrite(int fd, const void *data, UINT64 length, UINT64 offset)
+{
+    const UINT8 *p = (const UINT8 *)data;
+    ssize_t n;
+
+    while (length) {
+        n = pwrite(fd, p, length > (1u << 30) ? (1u << 30) : (size_t)length, (off_t)offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return FALSE;
+        }
+        p += n;
+        offset += n;
+        length -= n;
+    }
+    return TRUE;
+}
+
+MYBOOL ds_snapshot_write(const char* path, const char** names, struct DSVector** vecs, UINT32 n)
+{
+    struct DSSnapshotHeader header;
+    struct DSSnapshotEntry *entries;
+    UINT64 page = (UINT64)sysconf(_SC_PAGESIZE), offset;
+    MYBOOL ok = TRUE;
+    char *tmp;
+    UINT32 i, j;
+    int fd;
+
+    if (!path || (n && (!names || !vecs))) {
+        return FALSE;
+    }
+    if (page < DS_SNAPSHOT_MIN_PAGE) {
+        page = DS_SNAPSHOT_MIN_PAGE;
+    }
+    entries = (struct DSSnapshotEntry *)calloc(n ? n : 1, sizeof(struct DSSnapshotEntry));
+    tmp = (char *)malloc(strlen(path) + sizeof(".tmp"));
+    if (!entries || !tmp) {
+        free(entries);
+        free(tmp);
+        return FALSE;
+    }
+
+    offset = ds_snapshot_round(sizeof(header) + (UINT64)n * sizeof(struct DSSnapshotEntry), page);
+    for (i = 0; i < n && ok; ++i) {
+        ok = names[i] && vecs[i] && strlen(names[i]) <= DS_SNAPSHOT_NAME_MAX;
+        for (j = 0; j < i && ok; ++j) {
+            ok = strcmp(names[i], names[j]) != 0;
+        }
+        if (ok) {
+            ds_vector_settle(vecs[i]);
+            strcpy(entries[i].name, names[i]);
+            entries[i].crc = ds_crc32c_update(0, vecs[i]->data, vecs[i]->size);
+            entries[i].offset = offset;
+            entries[i].size = vecs[i]->size;
+            offset += ds_snapshot_span(vecs[i]->size, page);
+        }
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DS_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = DS_SNAPSHOT_VERSION;
+    header.count = n;
+    header.page_size = page;
+    header.length = offset;
+    header.dir_crc = ds_crc32c_update(0, (const UINT8 *)entries, (DSSize)n * sizeof(struct DSSnapshotEntry));
+    header.header_crc = ds_crc32c_update(0, (const UINT8 *)&header, offsetof(struct DSSnapshotHeader, header_crc));
+
+    /* the padding between vectors is left as a hole by ftruncate */
+    sprintf(tmp, "%s.tmp", path);
+    fd = ok ? open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+    ok = fd >= 0 && ftruncate(fd, (off_t)offset) == 0
+        && ds_snapshot_pwrite(fd, &header, sizeof(header), 0)
+        && ds_snapshot_pwrite(fd, entries, (UINT64)n * sizeof(struct DSSnapshotEntry), sizeof(header));
+    for (i = 0; i < n && ok; ++i) {
+        ok = ds_snapshot_pwrite(fd, vecs[i]->data, vecs[i]->size, entries[i].offset);
+    }
+    ok = ok && fsync(fd) == 0;
+    if (fd >= 0) {
+        ok = close(fd) == 0 && ok;
+        ok = ok && rename(tmp, path) == 0;
+        if (!ok) {
+            unlink(tmp);
+        }
+    }
+    free(entries);
+    free(tmp);
+    return ok;
+}
+
+/* checks the header and the directory; never reads vector bytes */
+static MYBOOL ds_snapshot_check(struct DSSnapshot *snap)
+{
+    const struct DSSnapshotHeader *header = (const struct DSSnapshotHeader *)snap->base;
+    const struct DSSnapshotEntry *entry;
+    UINT64 dir_end, span;
+    UINT32 i;
+
+    if (snap->length < sizeof(*header) || memcmp(header->magic, DS_SNAPSHOT_MAGIC, sizeof(header->magic)) != 0
+        || header->header_crc != ds_crc32c_update(0, snap->base, offsetof(struct DSSnapshotHeader, header_crc))
+        || header->version != DS_SNAPSHOT_VERSION || header->length != snap->length
+        || header->page_size < DS_SNAPSHOT_MIN_PAGE || (header->page_size & (header->page_size - 1))
+        || header->count > (snap->length - sizeof(*header)) / sizeof(struct DSSnapshotEntry)) {
+        return FALSE;
+    }
+    snap->count = header->count;
+    snap->page_size = header->page_size;
+    snap->entries = (const struct DSSnapshotEntry *)(snap->base + sizeof(*header));
+    dir_end = sizeof(*header) + (UINT64)snap->count * sizeof(struct DSSnapshotEntry);
+    if (header->dir_crc != ds_crc32c_update(0, (const UINT8 *)snap->entries, (DSSize)(dir_end - sizeof(*header)))) {
+        return FALSE;
+    }
+    /* every vector must fit the file, and a DSSize with its spare byte */
+    for (i = 0; i < snap->count; ++i) {
+        entry = snap->entries + i;
+        if (!memchr(entry->name, 0, sizeof(entry->name)) || entry->offset < dir_end
+            || (entry->offset & (snap->page_size - 1)) || entry->size >= DS_SIZE_MAX - snap->page_size) {
+            return FALSE;
+        }
+        span = ds_snapshot_span(entry->size, snap->page_size);
+        if (entry->offset > snap->length || span > snap->length - entry->offset) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+struct DSSnapshot *ds_snapshot_open(const char* path)
+{
+    struct DSSnapshot *snap;
+    struct stat st;
+    void *base;
+    int fd;
+
+    if (!path) {
+        return NULL;
+    }
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(struct DSSnapshotHeader)
+        || (base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    snap = (struct DSSnapshot *)malloc(sizeof(struct DSSnapshot));
+    if (snap) {
+        snap->fd = fd;
+        snap->base = (const UINT8 *)base;
+        snap->length = (UINT64)st.st_size;
+    }
+    if (!snap || !ds_snapshot_check(snap)) {
+        free(snap);
+        munmap(base, (size_t)st.st_size);
+        close(fd);
+        return NULL;
+    }
+    return snap;
+}
+
+void ds_snapshot_close(struct DSSnapshot *snap)
+{
+    if (snap) {
+        munmap((void *)snap->base, (size_t)snap->length);
+        close(snap->fd);
+        free(snap);
+    }
+}
+
+UINT32 ds_snapshot_count(struct DSSnapshot *snap)
+{
+    return snap ? snap->count : 0;
+}
+
+const char* ds_snapshot_name(struct DSSnapshot *snap, UINT32 index)
+{
+    return snap && index < snap->count ? snap->entries[index].name : NULL;
+}
+
+static const struct DSSnapshotEntry *ds_snapshot_find(struct DSSnapshot *snap, const char *name)
+{
+    UINT32 i;
+
+    if (!snap || !name) {
+        return NULL;
+    }
+    for (i = 0; i < snap->count; ++i) {
+        if (strcmp(snap->entries[i].name, name) == 0) {
+            return snap->entries + i;
+        }
+    }
+    return NULL;
+}
+
+struct DSVectorView ds_snapshot_view(struct DSSnapshot *snap, const char* name)
+{
+    const struct DSSnapshotEntry *entry = ds_snapshot_find(snap, name);
+    struct DSVectorView view = {NULL, 0};
+
+    if (entry) {
+        view.data = snap->base + entry->offset;
+        view.size = (DSSize)entry->size;
+    }
+    return view;
+}
+
+struct DSVector *ds_snapshot_vector(struct DSSnapshot *snap, const char* name)
+{
+    const struct DSSnapshotEntry *entry = ds_snapshot_find(snap, name);
+    UINT64 page = (UINT64)sysconf(_SC_PAGESIZE), span;
+    struct DSVector *vec;
+    void *data;
+
+    if (!entry) {
+        return NULL;
+    }
+    span = ds_snapshot_span(entry->size, snap->page_size);
+    if (page && snap->page_size % page == 0 && span <= (size_t)-1) {
+        data = mmap(NULL, (size_t)span, PROT_READ | PROT_WRITE, MAP_PRIVATE, snap->fd, (off_t)entry->offset);
+        if (data != MAP_FAILED) {
+            vec = ds_vector_create_mapped((UINT8 *)data, (DSSize)entry->size, (DSSize)span);
+            if (!vec) {
+                munmap(data, (size_t)span);
+            }
+            return vec;
+        }
+    }
+
+    /* offsets this system cannot map: copy instead */
+    vec = ds_vector_create_capacity((DSSize)entry->size + 1);
+    if (vec && entry->size && !ds_vector_append(vec, (UINT8 *)snap->base + entry->offset, (DSSize)entry->size)) {
+        ds_vector_free(vec);
+        vec = NULL;
+    }
+    return vec;
+}
+
+MYBOOL ds_snapshot_verify(struct DSSnapshot *snap, const char* name)
+{
+    const struct DSSnapshotEntry *entry;
+    UINT32 i;
+
+    if (!snap) {
+        return FALSE;
+    }
+    if (name) {
+        entry = ds_snapshot_find(snap, name);
+        return entry && entry->crc == ds_crc32c_update(0, snap->base + entry->offset, (DSSize)entry->size);
+    }
+    for (i = 0; i < snap->count; ++i) {
+        entry = snap->entries + i;
+        if (entry->crc != ds_crc32c_update(0, snap->base + entry->offset, (DSSize)entry->size)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
@@ -0,0 +1,88 @@
+#ifndef __LIBDS_SNAPSHOT_H__
+#define __LIBDS_SNAPSHOT_H__
+
+#include "vector.h"
+
+/*
+ * Snapshot files: a set of named vectors in one file, for warm starts
+ * without re-parsing. The layout is a 64-byte header, a directory of
+ * 64-byte entries (name, CRC32C, offset, size) and then the bytes of
+ * each vector at a page aligned offset, padded to whole pages with room
+ * for the spare byte. Integers are in native byte order.
+ *
+ * Opening maps the file read-only and checks only the header and the
+ * directory, so it costs the same for any amount of data; pages are
+ * read in as they are touched. ds_snapshot_verify checks the vector
+ * bytes against their CRCs when that is wanted.
+ */
+
+#define DS_SNAPSHOT_VERSION 1
+
+/* longest vector name, without the terminating NUL */
+#define DS_SNAPSHOT_NAME_MAX 43
+
+struct DSSnapshotEntry;
+
+struct DSSnapshot {
+    int fd;
+    const UINT8* base;          /* the whole file, mapped read-only */
+    UINT64 length;
+    UINT64 page_size;           /* alignment of the vector offsets */
+    UINT32 count;
+    const struct DSSnapshotEntry* entries;
+};
+
+/**
+ * Writes n vectors, named by names, to path. The file is written under
+ * a temporary name, synced and then renamed, so readers never see a
+ * partial snapshot. Names must be distinct and at most
+ * DS_SNAPSHOT_NAME_MAX bytes. Returns TRUE on success.
+ */
+MYBOOL ds_snapshot_write(const char* path, const char** names, struct DSVector** vecs, UINT32 n);
+
+/**
+ * Maps the snapshot at path. Returns NULL when the file cannot be read,
+ * is of another version, or its header or directory is corrupt.
+ * ds_snapshot_close will need to be called.
+ */
+struct DSSnapshot *ds_snapshot_open(const char* path);
+
+/**
+ * Unmaps the snapshot. Views into it become invalid; vectors returned
+ * by ds_snapshot_vector stay valid.
+ */
+void ds_snapshot_close(struct DSSnapshot *snap);
+
+/**
+ * Returns the number of vectors in the snapshot.
+ */
+UINT32 ds_snapshot_count(struct DSSnapshot *snap);
+
+/**
+ * Returns the name of vector index, NULL when index is out of range.
+ */
+const char* ds_snapshot_name(struct DSSnapshot *snap, UINT32 index);
+
+/**
+ * Returns a read-only view of the named vector straight from the
+ * mapping, or an empty view with data == NULL when there is none.
+ */
+struct DSVectorView ds_snapshot_view(struct DSSnapshot *snap, const char* name);
+
+/**
+ * Returns a vector with the contents of the named vector, NULL when
+ * there is none or on no memory. The vector is a private mapping of
+ * the file (see ds_vector_create_mapped), so nothing is copied until it
+ * is written or grown; it is a heap copy when the snapshot was written
+ * with a page size this system cannot map.
+ */
+struct DSVector *ds_snapshot_vector(struct DSSnapshot *snap, const char* name);
+
+/**
+ * Checks the bytes of the named vector, or of every vector when name
+ * is NULL, against their CRC32C. Reads all of them.
+ * Returns FALSE on a mismatch or an unknown name.
+ */
+MYBOOL ds_snapshot_verify(struct DSSnapshot *snap, const char* name);
+
+#endif
@@ -0,0 +1,129 @@
+/* system headers that h2unit's allocator macros would break */
+#include <immintrin.h>
+#include <malloc.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "h2unit.h"
+
+extern "C" {
+#include "vector.c"
+#include "aio.c"
+}
+
+static char path[64];
+static UINT32 calls;
+static INT64 results[16];
+
+static void record(struct DSVector *vec, INT64 result, void *arg)
+{
+    results[(size_t)arg] = result;
+    ++calls;
+}
+
+static void check_backend(UINT32 flags)
+{
+    struct DSAio *aio = ds_aio_create(8, flags);
+    struct DSVector *vecs[8], *in = ds_vector_create_capacity(16), *empty = ds_vector_create_capacity(16);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644), wronly = open(path, O_WRONLY);
+    UINT32 i, j, wrong = 0;
+
+    H2EQ_TRUE(aio != NULL && fd >= 0);
+    H2EQ_MATH(flags & DS_AIO_THREAD_POOL ? FALSE : TRUE, ds_aio_uses_uring(aio));
+    for (i = 0; i < 8; ++i) {
+        vecs[i] = ds_vector_create_capacity(100001);
+        ds_vector_resize(vecs[i], 100000);
+        memset(vecs[i]->data, 'a' + i, 100000);
+    }
+    H2EQ_TRUE(ds_aio_register(aio, vecs, 4));
+
+    calls = 0;
+    for (i = 0; i < 8; ++i) {
+        H2EQ_TRUE(ds_aio_flush(aio, fd, i * 100000ull, vecs[i], record, (void *)(size_t)i));
+    }
+    H2EQ_MATH(8, ds_aio_pending(aio));
+    H2EQ_TRUE(!ds_aio_flush(aio, fd, 0, vecs[0], record, NULL));
+    H2EQ_TRUE(ds_aio_poll(aio, 3) >= 3);
+    ds_aio_wait(aio);
+    H2EQ_MATH(8, calls);
+    H2EQ_MATH(0, ds_aio_pending(aio));
+    for (i = 0; i < 8; ++i) {
+        wrong += results[i] != 100000;
+    }
+    H2EQ_MATH(0, wrong);
+
+    /* a fill appends what is there and stops at end of file */
+    ds_vector_append(in, (UINT8 *)"head", 4);
+    H2EQ_TRUE(ds_aio_fill(aio, fd, 0, in, 800050, record, (void *)8));
+    H2EQ_TRUE(ds_aio_flush(aio, fd, 0, empty, record, (void *)9));
+    H2EQ_TRUE(ds_aio_fill(aio, wronly, 0, empty, 10, record, (void *)10));
+    ds_aio_wait(aio);
+    H2EQ_MATH(800000, results[8]);
+    H2EQ_MATH(0, results[9]);
+    H2EQ_MATH(-EBADF, results[10]);
+    H2EQ_MATH(0, empty->size);
+    H2EQ_MATH(800004, in->size);
+    H2EQ_MATH(0, memcmp(in->data, "head", 4));
+    for (i = 0; i < 8; ++i) {
+        for (j = 0; j < 100000; j += 999) {
+            wrong += in->data[4 + i * 100000 + j] != 'a' + i;
+        }
+    }
+    H2EQ_MATH(0, wrong);
+
+    ds_aio_unregister(aio);
+    ds_aio_destroy(aio);
+    for (i = 0; i < 8; ++i) {
+        ds_vector_free(vecs[i]);
+    }
+    ds_vector_free(in);
+    ds_vector_free(empty);
+    close(fd);
+    close(wronly);
+}
+
+H2UNIT(caio)
+{
+   void setup() {
+       sprintf(path, "/tmp/test_aio.%d", (int)getpid());
+   }
+
+   void teardown() {
+       unlink(path);
+   }
+};
+
+H2CASE(caio, "io_uring")
+{
+    struct DSAio *aio = ds_aio_create(4, 0);
+
+    /* kernels or sandboxes without io_uring fall back to the threads */
+    if (ds_aio_uses_uring(aio)) {
+        check_backend(0);
+    }
+    ds_aio_destroy(aio);
+}
+
+H2CASE(caio, "thread pool")
+{
+    check_backend(DS_AIO_THREAD_POOL);
+}
+
+H2CASE(caio, "bad arguments")
+{
+    struct DSVector *vec = ds_vector_create_capacity(16);
+
+    H2EQ_TRUE(ds_aio_create(0, 0) == NULL);
+    H2EQ_TRUE(ds_aio_create(DS_AIO_MAX_DEPTH + 1, 0) == NULL);
+    H2EQ_TRUE(!ds_aio_flush(NULL, 1, 0, vec, NULL, NULL));
+    H2EQ_MATH(0, ds_aio_poll(NULL, 1));
+    ds_aio_wait(NULL);
+    ds_aio_destroy(NULL);
+    ds_vector_free(vec);
+}
@@ -0,0 +1,143 @@
+/* system and standard headers that h2unit's macros would break */
+#include <immintrin.h>
+#include <malloc.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "h2unit.h"
+
+extern "C" {
+#include "vector.c"
+}
+#include "async.cpp"
+
+static struct DSVector *make_pattern(UINT32 size, UINT32 seed)
+{
+    struct DSVector *vec = ds_vector_create_capacity(size + 1);
+    UINT32 i;
+
+    ds_vector_resize(vec, size);
+    for (i = 0; i < size; ++i) {
+        vec->data[i] = (UINT8)(i * 31 + seed);
+    }
+    return vec;
+}
+
+static ds::Task<void> send_and_close(int fd, struct DSVector *vec, INT64 *result)
+{
+    *result = co_await ds::async_write(fd, vec);
+    close(fd);
+}
+
+static ds::Task<void> receive(int fd, struct DSVector *vec, DSSize n, INT64 *result)
+{
+    *result = co_await ds::async_read_into(fd, vec, n);
+}
+
+/* a chain of awaits: two reads on one stream */
+static ds::Task<void> receive_twice(int fd, struct DSVector *vec, DSSize n, INT64 *result)
+{
+    INT64 first = co_await ds::async_read_into(fd, vec, n / 2);
+    INT64 second = co_await ds::async_read_into(fd, vec, n - n / 2);
+    *result = first < 0 || second < 0 ? -1 : first + second;
+}
+
+H2UNIT(casync)
+{
+   void setup() {
+       signal(SIGPIPE, SIG_IGN);
+   }
+
+   void teardown() {
+   }
+};
+
+H2CASE(casync, "pipe larger than its buffer")
+{
+    ds::Executor executor;
+    struct DSVector *out = make_pattern(1u << 20, 7), *in = ds_vector_create_capacity(16);
+    INT64 written = 0, read = 0;
+    int fds[2];
+
+    H2EQ_TRUE(executor.valid());
+    H2EQ_MATH(0, pipe(fds));
+    ds_vector_append(in, (UINT8 *)"head", 4);
+    executor.spawn(receive(fds[0], in, 2u << 20, &read));
+    executor.spawn(send_and_close(fds[1], out, &written));
+    H2EQ_MATH(0, executor.run());
+    H2EQ_MATH(1u << 20, written);
+    H2EQ_MATH(1u << 20, read);
+    H2EQ_MATH(4 + (1u << 20), in->size);
+    H2EQ_MATH(0, memcmp(in->data + 4, out->data, out->size));
+    close(fds[0]);
+    ds_vector_free(out);
+    ds_vector_free(in);
+}
+
+H2CASE(casync, "many socketpairs on one thread")
+{
+    enum { STREAMS = 300, BYTES = 200000 };
+    ds::Executor executor;
+    static struct DSVector *outs[STREAMS], *ins[STREAMS];
+    static INT64 written[STREAMS], read[STREAMS];
+    static int fds[STREAMS][2];
+    UINT32 i, wrong = 0;
+
+    for (i = 0; i < STREAMS; ++i) {
+        H2EQ_MATH(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds[i]));
+        outs[i] = make_pattern(BYTES, i);
+        ins[i] = ds_vector_create_capacity(16);
+        executor.spawn(receive_twice(fds[i][1], ins[i], BYTES, read + i));
+        executor.spawn(send_and_close(fds[i][0], outs[i], written + i));
+    }
+    H2EQ_MATH(0, executor.run());
+    for (i = 0; i < STREAMS; ++i) {
+        wrong += written[i] != BYTES || read[i] != BYTES || ins[i]->size != BYTES
+            || memcmp(ins[i]->data, outs[i]->data, BYTES) != 0;
+        close(fds[i][1]);
+        ds_vector_free(outs[i]);
+        ds_vector_free(ins[i]);
+    }
+    H2EQ_MATH(0, wrong);
+}
+
+H2CASE(casync, "end of stream and errors")
+{
+    ds::Executor executor;
+    struct DSVector *out = make_pattern(10, 1), *in = ds_vector_create_capacity(16);
+    INT64 written = 0, read = 0, bad_read = 0, bad_write = 0;
+    int fds[2], sv[2];
+
+    H2EQ_MATH(0, pipe(fds));
+    executor.spawn(send_and_close(fds[1], out, &written));
+    executor.spawn(receive(fds[0], in, 100, &read));
+    executor.spawn(receive(-1, in, 100, &bad_read));
+    H2EQ_MATH(0, executor.run());
+    H2EQ_MATH(10, written);
+    H2EQ_MATH(10, read);
+    H2EQ_MATH(-EINVAL, bad_read);
+    H2EQ_MATH(10, in->size);
+    close(fds[0]);
+
+    /* the peer is gone: EPIPE, not a signal */
+    H2EQ_MATH(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+    close(sv[1]);
+    executor.spawn(send_and_close(sv[0], out, &bad_write));
+    H2EQ_MATH(0, executor.run());
+    H2EQ_MATH(-EPIPE, bad_write);
+    ds_vector_free(out);
+    ds_vector_free(in);
+}
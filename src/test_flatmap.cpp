@@ -0,0 +1,115 @@
+/* system headers that h2unit's allocator macros would break */
+#include <immintrin.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "h2unit.h"
+
+extern "C" {
+#include "vector.c"
+#include "flatmap.c"
+}
+
+/* reference lower bound over the distinct sorted keys */
+static UINT32 lower_bound_scan(const UINT64 *sorted, UINT32 n, UINT64 key)
+{
+    UINT32 i = 0;
+    while (i < n && sorted[i] < key) {
+        ++i;
+    }
+    return i;
+}
+
+static void check_layout(UINT32 flags)
+{
+    static UINT64 keys[3000], sorted[3000];
+    static UINT32 values[3000];
+    struct DSFlatMap *map;
+    UINT32 i, n = 0, slot, expect, wrong = 0;
+    UINT64 key;
+
+    for (i = 0; i < 3000; ++i) {
+        keys[i] = ((UINT64)(i * 2654435761u) % 2000) * 3 + 10;
+        values[i] = i;
+    }
+    map = ds_flatmap_build(keys, (const UINT8 *)values, 3000, sizeof(UINT32), flags);
+    H2EQ_TRUE(map != NULL);
+
+    /* distinct keys in order, each mapped to the index of its last occurrence */
+    for (key = 0; key < 7000; ++key) {
+        for (i = 0; i < 3000 && keys[i] != key; ++i) {
+        }
+        if (i < 3000) {
+            sorted[n++] = key;
+        }
+    }
+    H2EQ_MATH(n, ds_flatmap_count(map));
+    for (i = 0; i < 3000; ++i) {
+        wrong += *(const UINT32 *)ds_flatmap_find(map, keys[i]) < i;
+    }
+    H2EQ_MATH(0, wrong);
+
+    for (key = 0; key < 6100; ++key) {
+        slot = ds_flatmap_lower_bound(map, key);
+        expect = lower_bound_scan(sorted, n, key);
+        if (expect == n) {
+            wrong += slot != DS_FLATMAP_NONE;
+        } else {
+            wrong += slot == DS_FLATMAP_NONE || ds_flatmap_key(map, slot) != sorted[expect];
+        }
+        wrong += (ds_flatmap_find(map, key) != NULL) != (expect < n && sorted[expect] == key);
+    }
+    H2EQ_MATH(0, wrong);
+    H2EQ_TRUE(ds_flatmap_find(map, 0xFFFFFFFFFFFFFFFFull) == NULL);
+    slot = ds_flatmap_lower_bound(map, 10);
+    H2EQ_TRUE(ds_flatmap_value(map, slot) == ds_flatmap_find(map, 10));
+    ds_flatmap_free(map);
+}
+
+H2UNIT(cflatmap)
+{
+   void setup() {
+   }
+
+   void teardown() {
+   }
+};
+
+H2CASE(cflatmap, "sorted layout")
+{
+    check_layout(0);
+}
+
+H2CASE(cflatmap, "eytzinger layout")
+{
+    check_layout(DS_FLATMAP_EYTZINGER);
+}
+
+H2CASE(cflatmap, "small and empty maps")
+{
+    UINT64 keys[] = {5, 1, 5, 0xFFFFFFFFFFFFFFFFull};
+    struct DSFlatMap *map;
+    UINT32 flags;
+
+    for (flags = 0; flags <= DS_FLATMAP_EYTZINGER; ++flags) {
+        map = ds_flatmap_build(NULL, NULL, 0, 8, flags);
+        H2EQ_TRUE(map != NULL);
+        H2EQ_MATH(0, ds_flatmap_count(map));
+        H2EQ_MATH(DS_FLATMAP_NONE, ds_flatmap_lower_bound(map, 0));
+        H2EQ_TRUE(ds_flatmap_find(map, 0) == NULL);
+        ds_flatmap_free(map);
+
+        /* a set: no values */
+        map = ds_flatmap_build(keys, NULL, 4, 0, flags);
+        H2EQ_MATH(3, ds_flatmap_count(map));
+        H2EQ_TRUE(ds_flatmap_find(map, 5) != NULL);
+        H2EQ_TRUE(ds_flatmap_find(map, 0xFFFFFFFFFFFFFFFFull) != NULL);
+        H2EQ_TRUE(ds_flatmap_find(map, 2) == NULL);
+        H2EQ_MATH(5, ds_flatmap_key(map, ds_flatmap_lower_bound(map, 2)));
+        ds_flatmap_free(map);
+    }
+    H2EQ_TRUE(ds_flatmap_build(NULL, NULL, 3, 0, 0) == NULL);
+    H2EQ_TRUE(ds_flatmap_build(keys, NULL, 3, 4, 0) == NULL);
+    ds_flatmap_free(NULL);
+}
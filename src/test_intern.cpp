@@ -0,0 +1,78 @@
+/* system headers that h2unit's allocator macros would break */
+#include <immintrin.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "h2unit.h"
+
+extern "C" {
+#include "vector.c"
+#include "records.c"
+#include "intern.c"
+}
+
+static UINT32 ret = 0;
+
+H2UNIT(cintern)
+{
+   void setup() {
+   }
+
+   void teardown() {
+   }
+};
+
+H2CASE(cintern, "ids are stable and dense")
+{
+    struct DSInterner *table = ds_interner_create(0);
+    struct DSVectorView view;
+
+    H2EQ_TRUE(table != NULL);
+    H2EQ_MATH(0, ds_intern(table, (const UINT8 *)"host-a", 6));
+    H2EQ_MATH(1, ds_intern(table, (const UINT8 *)"host-b", 6));
+    H2EQ_MATH(0, ds_intern(table, (const UINT8 *)"host-a", 6));
+    H2EQ_MATH(2, ds_intern(table, (const UINT8 *)"host", 4));
+    H2EQ_MATH(3, ds_intern(table, NULL, 0));
+    H2EQ_MATH(3, ds_intern(table, (const UINT8 *)"", 0));
+    H2EQ_MATH(DS_INTERN_NONE, ds_intern(table, NULL, 2));
+    H2EQ_MATH(4, ds_interner_count(table));
+
+    H2EQ_MATH(1, ds_intern_find(table, (const UINT8 *)"host-b", 6));
+    H2EQ_MATH(DS_INTERN_NONE, ds_intern_find(table, (const UINT8 *)"host-c", 6));
+    H2EQ_MATH(4, ds_interner_count(table));
+
+    view = ds_intern_string(table, 2);
+    H2EQ_MATH(4, view.size);
+    H2EQ_MATH(0, memcmp(view.data, "host", 4));
+    H2EQ_MATH(0, ds_intern_string(table, 3).size);
+    H2EQ_TRUE(ds_intern_string(table, 4).data == NULL);
+    ds_interner_free(table);
+    ds_interner_free(NULL);
+}
+
+H2CASE(cintern, "many repeated strings")
+{
+    struct DSInterner *table = ds_interner_create(4);
+    char name[32];
+    UINT32 i, length, wrong = 0, unique_bytes = 0;
+    struct DSVectorView view;
+
+    /* 2000 distinct names, each interned five times across the index growths */
+    for (i = 0; i < 10000; ++i) {
+        length = sprintf(name, "metric.%u.count", (i * 7) % 2000);
+        ret = ds_intern(table, (const UINT8 *)name, length);
+        wrong += ret != i % 2000 || ds_intern_find(table, (const UINT8 *)name, length) != ret;
+    }
+    H2EQ_MATH(0, wrong);
+    H2EQ_MATH(2000, ds_interner_count(table));
+    for (i = 0; i < 2000; ++i) {
+        length = sprintf(name, "metric.%u.count", (i * 7) % 2000);
+        view = ds_intern_string(table, i);
+        wrong += view.size != length || memcmp(view.data, name, length) != 0;
+        unique_bytes += length;
+    }
+    H2EQ_MATH(0, wrong);
+    H2EQ_TRUE(table->strings->bytes->size == unique_bytes);
+    ds_interner_free(table);
+}
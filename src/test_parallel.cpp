@@ -0,0 +1,205 @@
+/* system headers that h2unit's allocator macros would break */
+#include <immintrin.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "h2unit.h"
+
+extern "C" {
+#include "vector.c"
+#include "parallel.c"
+}
+
+static void square_chunk(UINT8 *data, UINT32 count, UINT32 first, void *arg)
+{
+    UINT32 *values = (UINT32 *)data, i;
+    for (i = 0; i < count; ++i) {
+        values[i] = (first + i) * (first + i);
+    }
+}
+
+static void negate_chunk(const UINT8 *src, UINT8 *dst, UINT32 count, UINT32 first, void *arg)
+{
+    UINT32 i;
+    for (i = 0; i < count; ++i) {
+        ((UINT32 *)dst)[i] = ~((const UINT32 *)src)[i];
+    }
+}
+
+static UINT64 sum_chunk(const UINT8 *data, UINT32 count, UINT32 first, void *arg)
+{
+    UINT64 sum = 0;
+    UINT32 i;
+    for (i = 0; i < count; ++i) {
+        sum += ((const UINT32 *)data)[i];
+    }
+    return sum;
+}
+
+static UINT64 add_values(UINT64 a, UINT64 b, void *arg)
+{
+    return a + b;
+}
+
+static INT32 compare_pair_desc(const void *a, const void *b, void *arg)
+{
+    UINT32 x = *(const UINT32 *)a, y = *(const UINT32 *)b;
+    return x > y ? -1 : x < y;
+}
+
+static void count_index(UINT32 index, void *arg)
+{
+    __atomic_add_fetch((UINT32 *)arg + index, 1, __ATOMIC_RELAXED);
+}
+
+static UINT32 ret = 0;
+
+static struct DSVector *make_values(UINT32 count)
+{
+    struct DSVector *vec = ds_vector_create_capacity(16);
+    UINT32 i, value = 12345;
+
+    for (i = 0; i < count; ++i) {
+        value = value * 1103515245u + 12345u;
+        ds_vector_append(vec, (UINT8 *)&value, sizeof(value));
+    }
+    return vec;
+}
+
+H2UNIT(cparallel)
+{
+   void setup() {
+   }
+
+   void teardown() {
+       ds_parallel_shutdown();
+   }
+};
+
+H2CASE(cparallel, "init and shutdown")
+{
+    H2EQ_MATH(1, ds_parallel_threads());
+    H2EQ_MATH(4, ds_parallel_init(4, 0));
+    H2EQ_MATH(4, ds_parallel_threads());
+    ds_parallel_shutdown();
+    H2EQ_MATH(1, ds_parallel_threads());
+    H2EQ_TRUE(ds_parallel_init(0, 0) >= 1);
+    ds_parallel_shutdown();
+}
+
+H2CASE(cparallel, "run every index once")
+{
+    static UINT32 hits[5000];
+    UINT32 i, wrong = 0;
+
+    ds_parallel_init(4, 0);
+    memset(hits, 0, sizeof(hits));
+    ds_parallel_run(5000, count_index, hits);
+    ds_parallel_run(0, count_index, hits);
+    for (i = 0; i < 5000; ++i) {
+        wrong += hits[i] != 1;
+    }
+    H2EQ_MATH(0, wrong);
+}
+
+H2CASE(cparallel, "for, transform and reduce")
+{
+    struct DSVector *vec = make_values(100000), *neg = ds_vector_create_capacity(10);
+    UINT64 expect = 0;
+    UINT32 i, wrong = 0;
+
+    ds_parallel_init(3, 4096);
+    H2EQ_MATH(100000, ds_parallel_for(vec, 4, square_chunk, NULL));
+    for (i = 0; i < 100000; ++i) {
+        wrong += ((UINT32 *)vec->data)[i] != i * i;
+        expect += i * i;
+    }
+    H2EQ_MATH(0, wrong);
+
+    H2EQ_MATH(100000, ds_parallel_transform(neg, vec, 4, negate_chunk, NULL));
+    H2EQ_MATH(vec->size, neg->size);
+    for (i = 0, wrong = 0; i < 100000; ++i) {
+        wrong += ((UINT32 *)neg->data)[i] != ~(i * i);
+    }
+    H2EQ_MATH(0, wrong);
+
+    H2EQ_TRUE(expect + 7 == ds_parallel_reduce(vec, 4, 7, sum_chunk, add_values, NULL));
+    H2EQ_MATH(0, ds_parallel_for(vec, 3, square_chunk, NULL));
+    H2EQ_MATH(0, ds_parallel_transform(vec, vec, 4, negate_chunk, NULL));
+    ds_vector_free(vec);
+    ds_vector_free(neg);
+}
+
+H2CASE(cparallel, "serial fallback")
+{
+    struct DSVector *vec = make_values(5000);
+    UINT64 expect = 0;
+    UINT32 i;
+
+    for (i = 0; i < 5000; ++i) {
+        expect += ((UINT32 *)vec->data)[i];
+    }
+    H2EQ_TRUE(expect == ds_parallel_reduce(vec, 4, 0, sum_chunk, add_values, NULL));
+    H2EQ_MATH(5000, ds_parallel_sort(vec, 4, NULL, NULL));
+    for (i = 1; i < 5000; ++i) {
+        if (((UINT32 *)vec->data)[i - 1] > ((UINT32 *)vec->data)[i]) {
+            break;
+        }
+    }
+    H2EQ_MATH(5000, i);
+    ds_vector_free(vec);
+}
+
+H2CASE(cparallel, "sort matches serial sort")
+{
+    struct DSVector *vec = make_values(300000), *copy = ds_vector_create_capacity(10);
+
+    ds_parallel_init(4, 0);
+    ds_vector_append(copy, vec->data, vec->size);
+    H2EQ_MATH(300000, ds_parallel_sort(vec, 4, NULL, NULL));
+    ds_vector_sort_keys(copy, 4);
+    H2EQ_MATH(0, memcmp(vec->data, copy->data, vec->size));
+
+    /* pairs of (key, tag) sorted by key only, with many ties */
+    for (UINT32 i = 0; i < vec->size / 4; ++i) {
+        ((UINT32 *)vec->data)[i] = ((UINT32 *)vec->data)[i] % 1000;
+    }
+    memcpy(copy->data, vec->data, vec->size);
+    H2EQ_MATH(150000, ds_parallel_sort(vec, 8, compare_pair_desc, NULL));
+    ds_vector_sort(copy, 8, compare_pair_desc, NULL);
+    UINT32 wrong = 0;
+    for (UINT32 i = 0; i < 150000; ++i) {
+        wrong += ((UINT32 *)vec->data)[2 * i] != ((UINT32 *)copy->data)[2 * i];
+    }
+    H2EQ_MATH(0, wrong);
+    ds_vector_free(vec);
+    ds_vector_free(copy);
+}
+
+H2CASE(cparallel, "concat across the pool")
+{
+    struct DSVector *srcs[40], *dest = ds_vector_create_capacity(10), *serial = ds_vector_create_capacity(10);
+    UINT32 i, size;
+
+    for (i = 0; i < 40; ++i) {
+        /* mixes empty, small and multi-piece sources */
+        size = i % 5 == 0 ? 0 : (i * 104729u) % (1u << 20) + 1000;
+        srcs[i] = make_values(size / 4);
+    }
+    ds_vector_free(srcs[7]);
+    srcs[7] = NULL;
+    ds_parallel_init(4, 0);
+    ds_vector_append(dest, (UINT8 *)"head", 4);
+    ds_vector_append(serial, (UINT8 *)"head", 4);
+    ret = ds_parallel_concat(dest, srcs, 40);
+    H2EQ_TRUE(ret >= DS_PARALLEL_CONCAT_MIN);
+    H2EQ_MATH(ret, ds_vector_concat_many(serial, srcs, 40));
+    H2EQ_MATH(serial->size, dest->size);
+    H2EQ_MATH(0, memcmp(serial->data, dest->data, dest->size));
+    for (i = 0; i < 40; ++i) {
+        ds_vector_free(srcs[i]);
+    }
+    ds_vector_free(dest);
+    ds_vector_free(serial);
+}
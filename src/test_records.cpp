@@ -0,0 +1,100 @@
+/* system headers that h2unit's allocator macros would break */
+#include <immintrin.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "h2unit.h"
+
+extern "C" {
+#include "vector.c"
+#include "records.c"
+}
+
+static DSSize ret = 0;
+
+H2UNIT(crecords)
+{
+   void setup() {
+   }
+
+   void teardown() {
+   }
+};
+
+H2CASE(crecords, "append and get")
+{
+    struct DSRecords *rec = ds_records_create(0, 0);
+    struct DSVectorView view;
+
+    H2EQ_TRUE(rec != NULL);
+    H2EQ_MATH(0, ds_records_count(rec));
+    H2EQ_TRUE(ds_records_get(rec, 0).data == NULL);
+
+    H2EQ_MATH(1, ds_records_append(rec, (const UINT8 *)"alpha", 5));
+    H2EQ_MATH(2, ds_records_append(rec, NULL, 0));
+    H2EQ_MATH(3, ds_records_append(rec, (const UINT8 *)"beta", 4));
+    H2EQ_MATH(0, ds_records_append(rec, NULL, 3));
+    H2EQ_MATH(3, ds_records_count(rec));
+
+    view = ds_records_get(rec, 0);
+    H2EQ_MATH(5, view.size);
+    H2EQ_MATH(0, memcmp(view.data, "alpha", 5));
+    view = ds_records_get(rec, 1);
+    H2EQ_TRUE(view.data != NULL);
+    H2EQ_MATH(0, view.size);
+    view = ds_records_get(rec, 2);
+    H2EQ_MATH(4, view.size);
+    H2EQ_MATH(0, memcmp(view.data, "beta", 4));
+    H2EQ_TRUE(ds_records_get(rec, 3).data == NULL);
+    H2EQ_MATH(9, rec->bytes->size);
+
+    ds_records_clear(rec);
+    H2EQ_MATH(0, ds_records_count(rec));
+    H2EQ_MATH(1, ds_records_append(rec, (const UINT8 *)"gamma", 5));
+    H2EQ_MATH(0, memcmp(ds_records_get(rec, 0).data, "gamma", 5));
+    ds_records_free(rec);
+    ds_records_free(NULL);
+}
+
+H2CASE(crecords, "batch append")
+{
+    struct DSRecords *rec = ds_records_create(16, 2), *serial = ds_records_create(16, 2);
+    static UINT8 data[200000];
+    static DSSize lengths[10000];
+    DSSize i, total = 0, wrong = 0;
+    struct DSVectorView a, b;
+
+    for (i = 0; i < 10000; ++i) {
+        lengths[i] = (i * 7919) % 37;
+        total += lengths[i];
+    }
+    for (i = 0; i < total; ++i) {
+        data[i] = (UINT8)(i * 31);
+    }
+    ds_records_append(rec, (const UINT8 *)"head", 4);
+    ds_records_append(serial, (const UINT8 *)"head", 4);
+    ret = ds_records_append_many(rec, data, lengths, 10000);
+    H2EQ_MATH(10001, ret);
+    for (i = 0, total = 0; i < 10000; ++i) {
+        ds_records_append(serial, data + total, lengths[i]);
+        total += lengths[i];
+    }
+    H2EQ_MATH(ds_records_count(serial), ds_records_count(rec));
+    for (i = 0; i < 10001; ++i) {
+        a = ds_records_get(rec, i);
+        b = ds_records_get(serial, i);
+        wrong += a.size != b.size || memcmp(a.data, b.data, a.size) != 0;
+    }
+    H2EQ_MATH(0, wrong);
+
+    /* nothing is appended when the batch is rejected */
+    lengths[0] = DS_SIZE_MAX;
+    H2EQ_MATH(0, ds_records_append_many(rec, data, lengths, 2));
+    H2EQ_MATH(0, ds_records_append_many(rec, NULL, lengths + 1, 3));
+    H2EQ_MATH(10001, ds_records_append_many(rec, data, lengths, 0));
+    H2EQ_MATH(10001, ds_records_count(rec));
+    H2EQ_MATH(serial->bytes->size, rec->bytes->size);
+    ds_records_free(rec);
+    ds_records_free(serial);
+}
@@ -0,0 +1,176 @@
+/* system headers that h2unit's allocator macros would break */
+#include <immintrin.h>
+#include <malloc.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "h2unit.h"
+
+extern "C" {
+#include "vector.c"
+#include "snapshot.c"
+}
+
+static char path[64];
+
+/* overwrites one byte of the file at offset */
+static void poke(UINT64 offset, UINT8 value)
+{
+    int fd = open(path, O_WRONLY);
+    pwrite(fd, &value, 1, (off_t)offset);
+    close(fd);
+}
+
+static MYBOOL write_sample(void)
+{
+    struct DSVector *vecs[3];
+    const char *names[3] = {"lines", "empty", "numbers"};
+    UINT32 i;
+    MYBOOL ok;
+
+    vecs[0] = ds_vector_create_capacity(16);
+    vecs[1] = ds_vector_create_capacity(16);
+    vecs[2] = ds_vector_create_capacity(16);
+    ds_vector_append(vecs[0], (UINT8 *)"first line\nsecond line\n", 23);
+    for (i = 0; i < 5000; ++i) {
+        ds_vector_append(vecs[2], (UINT8 *)&i, sizeof(i));
+    }
+    ok = ds_snapshot_write(path, names, vecs, 3);
+    for (i = 0; i < 3; ++i) {
+        ds_vector_free(vecs[i]);
+    }
+    return ok;
+}
+
+H2UNIT(csnapshot)
+{
+   void setup() {
+       sprintf(path, "/tmp/test_snapshot.%d", (int)getpid());
+   }
+
+   void teardown() {
+       unlink(path);
+   }
+};
+
+H2CASE(csnapshot, "write and open")
+{
+    struct DSSnapshot *snap;
+    struct DSVectorView view;
+    UINT32 i, wrong = 0;
+
+    H2EQ_TRUE(write_sample());
+    snap = ds_snapshot_open(path);
+    H2EQ_TRUE(snap != NULL);
+    H2EQ_MATH(3, ds_snapshot_count(snap));
+    H2EQ_STRCMP("empty", ds_snapshot_name(snap, 1));
+    H2EQ_TRUE(ds_snapshot_name(snap, 3) == NULL);
+
+    view = ds_snapshot_view(snap, "lines");
+    H2EQ_MATH(23, view.size);
+    H2EQ_MATH(0, memcmp(view.data, "first line\nsecond line\n", 23));
+    view = ds_snapshot_view(snap, "empty");
+    H2EQ_TRUE(view.data != NULL);
+    H2EQ_MATH(0, view.size);
+    view = ds_snapshot_view(snap, "numbers");
+    H2EQ_MATH(20000, view.size);
+    H2EQ_MATH(0, (size_t)view.data % 4096);
+    for (i = 0; i < 5000; ++i) {
+        wrong += ((const UINT32 *)view.data)[i] != i;
+    }
+    H2EQ_MATH(0, wrong);
+    H2EQ_TRUE(ds_snapshot_view(snap, "missing").data == NULL);
+    H2EQ_TRUE(ds_snapshot_verify(snap, NULL));
+    H2EQ_TRUE(ds_snapshot_verify(snap, "lines"));
+    H2EQ_TRUE(!ds_snapshot_verify(snap, "missing"));
+    ds_snapshot_close(snap);
+}
+
+H2CASE(csnapshot, "copy-on-write vectors")
+{
+    struct DSSnapshot *snap;
+    struct DSVector *vec, *empty;
+    UINT32 i, wrong = 0;
+
+    H2EQ_TRUE(write_sample());
+    snap = ds_snapshot_open(path);
+    vec = ds_snapshot_vector(snap, "lines");
+    empty = ds_snapshot_vector(snap, "empty");
+    H2EQ_TRUE(vec != NULL && empty != NULL);
+    H2EQ_TRUE((vec->flags & DS_VECTOR_MAPPED) != 0);
+    H2EQ_MATH(23, vec->size);
+    H2EQ_TRUE(vec->capacity > vec->size);
+    H2EQ_MATH(0, empty->size);
+    H2EQ_TRUE(ds_snapshot_vector(snap, "missing") == NULL);
+
+    /* writes stay private, also after the snapshot is closed */
+    vec->data[0] = 'F';
+    H2EQ_MATH('f', ds_snapshot_view(snap, "lines").data[0]);
+    ds_snapshot_close(snap);
+    ds_vector_append(vec, (UINT8 *)"third", 5);
+    H2EQ_TRUE((vec->flags & DS_VECTOR_MAPPED) != 0);
+    H2EQ_MATH(0, memcmp(vec->data, "First line\nsecond line\nthird", 28));
+
+    /* growing past the mapping moves the contents to the heap */
+    for (i = 0; i < 2000; ++i) {
+        ds_vector_append(empty, (UINT8 *)&i, sizeof(i));
+    }
+    H2EQ_TRUE((empty->flags & DS_VECTOR_MAPPED) == 0);
+    for (i = 0; i < 2000; ++i) {
+        wrong += ((UINT32 *)empty->data)[i] != i;
+    }
+    H2EQ_MATH(0, wrong);
+    H2EQ_TRUE(ds_vector_shrink_to_fit(vec));
+    H2EQ_TRUE((vec->flags & DS_VECTOR_MAPPED) == 0);
+    H2EQ_MATH(0, memcmp(vec->data, "First line\nsecond line\nthird", 28));
+    ds_vector_free(vec);
+    ds_vector_free(empty);
+
+    snap = ds_snapshot_open(path);
+    H2EQ_TRUE(ds_snapshot_verify(snap, NULL));
+    H2EQ_MATH('f', ds_snapshot_view(snap, "lines").data[0]);
+    ds_snapshot_close(snap);
+}
+
+H2CASE(csnapshot, "rejects bad files and arguments")
+{
+    struct DSVector *vec = ds_vector_create_capacity(16);
+    const char *names[2] = {"a", "a"};
+    const char *long_name[1] = {"a-name-that-is-much-longer-than-forty-three-bytes"};
+    struct DSVector *vecs[2] = {vec, vec};
+    struct DSSnapshot *snap;
+
+    H2EQ_TRUE(ds_snapshot_open(path) == NULL);
+    H2EQ_TRUE(!ds_snapshot_write(path, names, vecs, 2));
+    H2EQ_TRUE(!ds_snapshot_write(path, long_name, vecs, 1));
+    H2EQ_TRUE(ds_snapshot_open(path) == NULL);
+    H2EQ_TRUE(ds_snapshot_write(path, names, vecs, 0));
+    snap = ds_snapshot_open(path);
+    H2EQ_MATH(0, ds_snapshot_count(snap));
+    ds_snapshot_close(snap);
+    ds_vector_free(vec);
+
+    /* header, version and directory damage is caught at open, data damage by verify */
+    H2EQ_TRUE(write_sample());
+    poke(0, 'X');
+    H2EQ_TRUE(ds_snapshot_open(path) == NULL);
+    H2EQ_TRUE(write_sample());
+    poke(offsetof(struct DSSnapshotHeader, version), DS_SNAPSHOT_VERSION + 1);
+    H2EQ_TRUE(ds_snapshot_open(path) == NULL);
+    H2EQ_TRUE(write_sample());
+    poke(sizeof(struct DSSnapshotHeader) + 1, 'X');
+    H2EQ_TRUE(ds_snapshot_open(path) == NULL);
+    H2EQ_TRUE(write_sample());
+    snap = ds_snapshot_open(path);
+    poke(snap->entries[2].offset + 100, 0xFF);
+    H2EQ_TRUE(ds_snapshot_verify(snap, "lines"));
+    H2EQ_TRUE(!ds_snapshot_verify(snap, "numbers"));
+    H2EQ_TRUE(!ds_snapshot_verify(snap, NULL));
+    ds_snapshot_close(snap);
+    ds_snapshot_close(NULL);
+}
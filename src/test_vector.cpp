@@ -1,3 +1,12 @@
+/* system headers that h2unit's allocator macros would break */
+#include <immintrin.h>
+#include <malloc.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
 #include "h2unit.h"
 
 extern "C" {
@@ -98,6 +107,324 @@ H2CASE(cvector, "insert test") {
     ds_vector_free(vec);
 }
 
+H2CASE(cvector, "resize") {
+    struct DSVector *vec = ds_vector_create_capacity(4);
+    UINT8 input[] = {1, 2, 3, 4};
+
+    ds_vector_append(vec, input, 3);
+    H2EQ_MATH(100, ds_vector_resize(vec, 100));
+    H2EQ_MATH(100, vec->size);
+    H2EQ_TRUE(vec->capacity > 100);
+    H2EQ_MEMCMP(input, vec->data, 3);
+    H2EQ_MATH(2, ds_vector_resize(vec, 2));
+    H2EQ_MATH(2, vec->size);
+    H2EQ_MATH(0, ds_vector_resize(NULL, 2));
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "reserve, clear and shrink") {
+    struct DSVector *vec = ds_vector_create_capacity(10);
+    UINT8 input[100] = {7};
+    UINT8 *data;
+    UINT32 i;
+
+    H2EQ_MATH(1001, ds_vector_reserve(vec, 1000));
+    H2EQ_MATH(1001, ds_vector_reserve(vec, 500));
+    data = vec->data;
+    for (i = 0; i < 10; ++i) {
+        ds_vector_append(vec, input, sizeof(input));
+    }
+    H2EQ_TRUE(data == vec->data && 1001 == vec->capacity);
+
+    ds_vector_clear(vec);
+    H2EQ_MATH(0, vec->size);
+    H2EQ_MATH(1001, vec->capacity);
+    ds_vector_append(vec, input, 5);
+    H2EQ_TRUE(ds_vector_shrink_to_fit(vec));
+    H2EQ_MATH(6, vec->capacity);
+    H2EQ_MEMCMP(input, vec->data, 5);
+    H2EQ_MATH(0, ds_vector_reserve(NULL, 10));
+    H2EQ_TRUE(!ds_vector_shrink_to_fit(NULL));
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "auto shrink and idle release") {
+    struct DSVector *vec = ds_vector_create_flags(10, 1.5, DS_VECTOR_AUTO_SHRINK);
+    struct DSVector *plain = ds_vector_create_capacity(1u << 20);
+
+    ds_vector_resize(vec, 1u << 20);
+    H2EQ_TRUE(vec->capacity > 1u << 20);
+    /* above a quarter of the capacity nothing is given back */
+    ds_vector_resize(vec, 300000);
+    H2EQ_TRUE(vec->capacity > 1u << 20);
+    ds_vector_resize(vec, 100000);
+    H2EQ_MATH(200001, vec->capacity);
+    ds_vector_erase(vec, 0, 99000);
+    H2EQ_MATH(DS_SHRINK_MIN_CAPACITY / 4, vec->capacity);
+    H2EQ_MATH(1000, vec->size);
+
+    ds_vector_resize(plain, 1u << 20);
+    ds_vector_resize(plain, 10);
+    H2EQ_TRUE(plain->capacity > 1u << 20);
+#if defined(__linux__)
+    memset(plain->data, 'x', 10);
+    H2EQ_TRUE(ds_vector_release_idle(plain) >= (1u << 20) - 8192);
+    H2EQ_TRUE(plain->capacity > 1u << 20);
+    H2EQ_MATH(10, plain->size);
+    H2EQ_MATH('x', plain->data[9]);
+    ds_vector_resize(plain, 1u << 20);
+    H2EQ_MATH(0, plain->data[(1u << 20) - 1]);
+#endif
+    H2EQ_MATH(0, ds_vector_release_idle(NULL));
+    ds_vector_free(vec);
+    ds_vector_free(plain);
+}
+
+#if defined(__linux__)
+/* counts the pages of [data, data + length) that are not resident */
+static UINT32 missing_pages(const UINT8 *data, DSSize length)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t first = (size_t)data & ~(page - 1), pages = ((size_t)data + length - first + page - 1) / page, i;
+    unsigned char *resident = (unsigned char *)calloc(pages, 1);
+    UINT32 missing = 0;
+
+    mincore((void *)first, pages * page, resident);
+    for (i = 0; i < pages; ++i) {
+        missing += !(resident[i] & 1);
+    }
+    free(resident);
+    return missing;
+}
+#endif
+
+H2CASE(cvector, "prefaulted and locked storage") {
+    struct DSVector *vec = ds_vector_create_flags(10, 1.5, DS_VECTOR_PREFAULT);
+    struct DSVector *locked = ds_vector_create_flags(10, 1.5, DS_VECTOR_LOCKED);
+    UINT8 input[100] = {3};
+
+    ds_vector_append(vec, input, sizeof(input));
+    H2EQ_TRUE(ds_vector_reserve(vec, 8u << 20) > 8u << 20);
+    H2EQ_MEMCMP(input, vec->data, sizeof(input));
+    ds_vector_append(locked, input, sizeof(input));
+    ds_vector_reserve(locked, 1u << 20);
+    H2EQ_MEMCMP(input, locked->data, sizeof(input));
+    /* an mlock refused by RLIMIT_MEMLOCK falls back to prefaulting */
+    H2EQ_TRUE((locked->flags & DS_VECTOR_LOCKED) || (locked->flags & DS_VECTOR_PREFAULT));
+#if defined(__linux__)
+    H2EQ_MATH(0, missing_pages(vec->data, vec->capacity));
+    H2EQ_MATH(0, missing_pages(locked->data, locked->capacity));
+#endif
+    ds_vector_free(vec);
+    ds_vector_free(locked);
+}
+
+H2CASE(cvector, "background pre-growth") {
+    struct DSVector *vec = ds_vector_create_flags(1u << 20, 1.5, DS_VECTOR_PREGROW);
+    struct DSVector *plain = ds_vector_create_capacity(1u << 20);
+    UINT8 chunk[16384];
+    UINT32 i, pregrown = 0;
+
+    for (i = 0; i < 400; ++i) {
+        memset(chunk, (int)i, sizeof(chunk));
+        ds_vector_append(vec, chunk, sizeof(chunk));
+        ds_vector_append(plain, chunk, sizeof(chunk));
+        /* rewrites below the copied range while a copy may be running */
+        if (i % 50 == 49) {
+            ds_vector_insert(vec, i * 7, chunk, 100);
+            ds_vector_insert(plain, i * 7, chunk, 100);
+            ds_vector_modified(vec, i * 3);
+            vec->data[i * 3] = 'm';
+            plain->data[i * 3] = 'm';
+        }
+        pregrown += vec->pregrow->active;
+    }
+    H2EQ_TRUE(pregrown > 0);
+    H2EQ_MATH(plain->size, vec->size);
+    H2EQ_MATH(0, memcmp(plain->data, vec->data, plain->size));
+    ds_vector_free(vec);
+    ds_vector_free(plain);
+}
+
+H2CASE(cvector, "reserve up to the capacity") {
+    struct DSVector *vec = ds_vector_create_flags(1u << 20, 1.5, DS_VECTOR_PREGROW);
+    UINT8 chunk[16384], *data;
+    DSSize next;
+    UINT32 i;
+
+    /* room for capacity - 1 bytes is already there, reserving it again moves nothing */
+    data = vec->data;
+    H2EQ_MATH(vec->capacity, ds_vector_reserve(vec, vec->capacity - 1));
+    H2EQ_MATH(vec->capacity, ds_vector_reserve(vec, vec->capacity - 1));
+    H2EQ_TRUE(data == vec->data);
+
+    memset(chunk, 'r', sizeof(chunk));
+    for (i = 0; !vec->pregrow->active && i < 100; ++i) {
+        ds_vector_append(vec, chunk, sizeof(chunk));
+    }
+    H2EQ_TRUE(vec->pregrow->active);
+    /* a reserve the next block covers takes that block */
+    next = vec->pregrow->capacity;
+    H2EQ_MATH(next, ds_vector_reserve(vec, vec->capacity));
+    H2EQ_MATH(next, vec->capacity);
+    H2EQ_TRUE(!vec->pregrow->active);
+    H2EQ_MATH(i * sizeof(chunk), vec->size);
+    H2EQ_TRUE(vec->data[0] == 'r' && vec->data[vec->size - 1] == 'r');
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "pre-growth of vectors freed right after growing") {
+    struct DSVector *a, *b;
+    UINT8 chunk[65536];
+    UINT32 round, i;
+
+    memset(chunk, 'p', sizeof(chunk));
+    for (round = 0; round < 8; ++round) {
+        a = ds_vector_create_flags(1u << 16, 1.5, DS_VECTOR_PREGROW);
+        b = ds_vector_create_flags(1u << 16, 1.5, DS_VECTOR_PREGROW);
+        for (i = 0; i < 40; ++i) {
+            ds_vector_append(a, chunk, sizeof(chunk));
+            ds_vector_append(b, chunk, sizeof(chunk));
+        }
+        H2EQ_MATH(40 * sizeof(chunk), a->size);
+        H2EQ_MATH(40 * sizeof(chunk), b->size);
+        ds_vector_free(a);
+        ds_vector_free(b);
+    }
+}
+
+H2CASE(cvector, "incremental growth") {
+    struct DSVector *vec = ds_vector_create_flags(1u << 20, 1.5, DS_VECTOR_INCREMENTAL);
+    struct DSVector *plain = ds_vector_create_capacity(1u << 20);
+    UINT8 chunk[16384];
+    DSSize capacity, pos;
+    UINT32 i, pending = 0, wrong = 0;
+
+    for (i = 0; i < 400; ++i) {
+        memset(chunk, (int)i, sizeof(chunk));
+        capacity = vec->capacity;
+        ds_vector_append(vec, chunk, sizeof(chunk));
+        ds_vector_append(plain, chunk, sizeof(chunk));
+        if (vec->capacity != capacity) {
+            /* the growing append moved only a piece of the old contents */
+            H2EQ_TRUE(vec->migration->old != NULL);
+            H2EQ_TRUE(vec->migration->moved < vec->migration->limit);
+        }
+        if (vec->migration->old) {
+            ++pending;
+            for (pos = 0; pos < plain->size; pos += 4099) {
+                wrong += *ds_vector_at(vec, pos) != plain->data[pos];
+            }
+        }
+    }
+    H2EQ_TRUE(pending > 0);
+    H2EQ_MATH(0, wrong);
+    H2EQ_TRUE(ds_vector_at(vec, vec->size) == NULL);
+    ds_vector_settle(vec);
+    H2EQ_TRUE(vec->migration->old == NULL);
+    H2EQ_MATH(plain->size, vec->size);
+    H2EQ_MATH(0, memcmp(plain->data, vec->data, plain->size));
+
+    /* rewriting below the moved range settles first */
+    ds_vector_append(vec, chunk, sizeof(chunk));
+    ds_vector_insert(vec, 5, chunk, 10);
+    ds_vector_append(plain, chunk, sizeof(chunk));
+    ds_vector_insert(plain, 5, chunk, 10);
+    H2EQ_MATH(0, memcmp(plain->data, vec->data, plain->size));
+    ds_vector_free(vec);
+    ds_vector_free(plain);
+}
+
+static MYBOOL erase_not_third(const UINT8 *elem, void *arg)
+{
+    ++*(UINT32 *)arg;
+    return *(const UINT32 *)elem % 3 != 2;
+}
+
+H2CASE(cvector, "erase and replace") {
+    struct DSVector *vec = ds_vector_create_capacity(8);
+    UINT8 input[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    UINT8 erased[] = {0, 1, 5, 6, 7, 8, 9};
+    UINT8 grown[] = {0, 9, 9, 9, 9, 6, 7, 8, 9};
+    UINT8 shrunk[] = {0, 7, 8, 9};
+
+    ds_vector_append(vec, input, sizeof(input));
+    H2EQ_MATH(3, ds_vector_erase(vec, 2, 3));
+    H2EQ_MATH(7, vec->size);
+    H2EQ_MEMCMP(erased, vec->data, sizeof(erased));
+
+    H2EQ_TRUE(ds_vector_replace(vec, 1, 2, input + 9, 1) == TRUE);
+    H2EQ_TRUE(ds_vector_replace(vec, 1, 1, grown + 1, 4) == TRUE);
+    H2EQ_MATH(sizeof(grown), vec->size);
+    H2EQ_MEMCMP(grown, vec->data, sizeof(grown));
+    H2EQ_TRUE(ds_vector_replace(vec, 1, 5, NULL, 0) == TRUE);
+    H2EQ_MEMCMP(shrunk, vec->data, sizeof(shrunk));
+    H2EQ_TRUE(ds_vector_replace(vec, 2, 3, input, 1) == FALSE);
+
+    /* erase clips at the end */
+    H2EQ_MATH(3, ds_vector_erase(vec, 1, 100));
+    H2EQ_MATH(1, vec->size);
+    H2EQ_MATH(0, ds_vector_erase(vec, 2, 1));
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "erase if") {
+    struct DSVector *vec = ds_vector_create_capacity(8);
+    UINT32 i, value, calls = 0;
+
+    for (i = 0; i < 1000; ++i) {
+        value = i;
+        ds_vector_append(vec, (UINT8 *)&value, sizeof(value));
+    }
+    H2EQ_MATH(667, ds_vector_erase_if(vec, 4, erase_not_third, &calls));
+    H2EQ_MATH(1000, calls);
+    H2EQ_MATH(333 * 4, vec->size);
+    for (i = 0; i < 333; ++i) {
+        if (((UINT32 *)vec->data)[i] != i * 3 + 2) {
+            break;
+        }
+    }
+    H2EQ_MATH(333, i);
+    H2EQ_MATH(0, ds_vector_erase_if(vec, 3, erase_not_third, &calls));
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "aligned storage") {
+    struct DSVector *vec = ds_vector_create_flags(3, 1.5, DS_VECTOR_ALIGN_64);
+    struct DSVector *huge = ds_vector_create_flags(4u << 20, 1.5, DS_VECTOR_HUGE_PAGES | DS_VECTOR_ALIGN_32);
+    UINT8 input[100];
+    UINT32 i;
+
+    /* h2unit's posix_memalign ignores the alignment, so only contents are checked here */
+    for (i = 0; i < sizeof(input); ++i) {
+        input[i] = (UINT8)i;
+    }
+    for (i = 0; i < 50; ++i) {
+        ds_vector_append(vec, input, sizeof(input));
+    }
+    H2EQ_MATH(5000, vec->size);
+    H2EQ_MEMCMP(input, vec->data, sizeof(input));
+    H2EQ_MEMCMP(input, vec->data + 4900, sizeof(input));
+    H2EQ_TRUE(vec->flags == DS_VECTOR_ALIGN_64);
+    ds_vector_append(huge, input, sizeof(input));
+    H2EQ_MEMCMP(input, huge->data, sizeof(input));
+    ds_vector_free(vec);
+    ds_vector_free(huge);
+}
+
+H2CASE(cvector, "memory usage") {
+    struct DSVector *vec = ds_vector_create_capacity(10);
+    UINT8 input[64] = {0};
+
+    H2EQ_TRUE(ds_vector_memory_usage(vec) >= sizeof(*vec) + 10);
+    ds_vector_append(vec, input, sizeof(input));
+    H2EQ_MATH(79, vec->capacity);
+    H2EQ_TRUE(ds_vector_memory_usage(vec) >= sizeof(*vec) + 79);
+    H2EQ_TRUE(ds_vector_memory_usage(vec) < sizeof(*vec) + 79 + 64);
+    H2EQ_MATH(0, ds_vector_memory_usage(NULL));
+    ds_vector_free(vec);
+}
+
 H2CASE(cvector, "concat test") {
     struct DSVector *dest = ds_vector_create_capacity(5);
     struct DSVector *src = ds_vector_create_capacity(5);
@@ -118,6 +445,34 @@ H2CASE(cvector, "concat test") {
     ds_vector_free(src);
 }
 
+H2CASE(cvector, "concat many") {
+    struct DSVector *dest = ds_vector_create_capacity(4);
+    struct DSVector *srcs[4];
+    UINT8 input[] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    UINT8 expect[] = {9, 1, 2, 3, 4, 5, 6, 7, 8, 9, 1, 2};
+
+    srcs[0] = ds_vector_create_capacity(10);
+    srcs[1] = NULL;
+    srcs[2] = ds_vector_create_capacity(10);
+    srcs[3] = ds_vector_create_capacity(10);
+    ds_vector_append(dest, input + 8, 1);
+    ds_vector_append(srcs[0], input, 4);
+    ds_vector_append(srcs[2], input + 4, 5);
+    ds_vector_append(srcs[3], input, 2);
+    ret = ds_vector_concat_many(dest, srcs, 4);
+    H2EQ_MATH(11, ret);
+    H2EQ_MATH(12, dest->size);
+    H2EQ_MEMCMP(expect, dest->data, sizeof(expect));
+
+    srcs[1] = dest;
+    H2EQ_MATH(0, ds_vector_concat_many(dest, srcs, 4));
+    H2EQ_MATH(12, dest->size);
+    ds_vector_free(srcs[0]);
+    ds_vector_free(srcs[2]);
+    ds_vector_free(srcs[3]);
+    ds_vector_free(dest);
+}
+
 H2CASE(cvector, "sprintf") {
     struct DSVector *dest = ds_vector_create_capacity(20);
     UINT8 input[] = {1, 2, 3, 4};
@@ -144,4 +499,620 @@ H2CASE(cvector, "sprintf") {
     H2EQ_MEMCMP(expresult, dest->data, sizeof(expresult));
 
     ds_vector_free(dest);
-}
\ No newline at end of file
+}
+
+#ifdef DS_VECTOR_STATS
+H2CASE(cvector, "stats") {
+    struct DSVector *vec = ds_vector_create_capacity(10);
+    struct DSVectorStats stats;
+    UINT8 input[] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+    ds_vector_append(vec, input, 8);
+    ds_vector_sprintf(vec, "%d", 1);
+    ds_vector_insert(vec, 2, input, 8);
+    ds_vector_sprintf(vec, "%s", "0123456789012345678901234567890123456789");
+    ds_vector_erase(vec, 0, 50);
+    H2EQ_TRUE(ds_vector_stats(vec, &stats) == TRUE);
+    H2EQ_MATH(2, stats.grows);
+    H2EQ_MATH(1, stats.sprintf_remeasures);
+    H2EQ_MATH(57, stats.peak_size);
+    H2EQ_MATH(vec->capacity, stats.peak_capacity);
+    H2EQ_TRUE(stats.bytes_moved >= 7 + 7);
+    H2EQ_MATH(0, stats.shrinks);
+    ds_vector_shrink_to_fit(vec);
+    ds_vector_stats(vec, &stats);
+    H2EQ_MATH(1, stats.shrinks);
+    H2EQ_TRUE(stats.peak_capacity > vec->capacity);
+    H2EQ_TRUE(ds_vector_stats(vec, NULL) == FALSE);
+    ds_vector_free(vec);
+}
+#endif
+
+#ifdef DS_VECTOR_TELEMETRY
+/* reads a dump file back for inspection */
+static UINT32 read_dump(const char *path, char *text, UINT32 size)
+{
+    int fd = open(path, O_RDONLY);
+    ssize_t n = fd < 0 ? -1 : read(fd, text, size - 1);
+    if (fd >= 0) {
+        close(fd);
+    }
+    text[n > 0 ? n : 0] = 0;
+    return n > 0 ? (UINT32)n : 0;
+}
+
+H2CASE(cvector, "telemetry registry") {
+    struct DSVector *vecs[3];
+    const char *path = "telemetry_dump.txt";
+    char text[8192], site[64], *line;
+    UINT32 i, live = 0, bytes = 0, slack = 0, grows = 0, created = 0;
+
+    for (i = 0; i < 3; ++i) {
+        vecs[i] = ds_vector_create_capacity(16);
+    }
+    snprintf(site, sizeof(site), "test_vector.cpp:%d ", __LINE__ - 2);
+    ds_vector_append(vecs[0], (UINT8 *)"0123456789abcdefghij", 20);
+    ds_vector_append(vecs[1], (UINT8 *)"0123", 4);
+    ds_vector_free(vecs[2]);
+
+    H2EQ_TRUE(ds_vector_telemetry_dump(path, FALSE) > 0);
+    read_dump(path, text, sizeof(text));
+    line = strstr(text, site);
+    H2EQ_TRUE(line != NULL);
+    sscanf(line + strlen(site), "%u %u %u %u %u", &live, &bytes, &slack, &grows, &created);
+    H2EQ_MATH(2, live);
+    H2EQ_MATH(vecs[0]->capacity + 16, bytes);
+    H2EQ_MATH(bytes - 24, slack);
+    H2EQ_MATH(1, grows);
+    H2EQ_MATH(3, created);
+
+    H2EQ_TRUE(ds_vector_telemetry_dump(path, TRUE) > 0);
+    read_dump(path, text, sizeof(text));
+    H2EQ_TRUE(strncmp(text, "{\"sites\":[{\"file\":\"", 19) == 0);
+    H2EQ_TRUE(strstr(text, "\"live_vectors\":2,") != NULL);
+
+    unlink(path);
+    H2EQ_TRUE(ds_vector_telemetry_on_signal(SIGUSR1, path, FALSE) == TRUE);
+    raise(SIGUSR1);
+    H2EQ_TRUE(read_dump(path, text, sizeof(text)) > 0);
+    H2EQ_TRUE(strstr(text, site) != NULL);
+    signal(SIGUSR1, SIG_DFL);
+    unlink(path);
+    ds_vector_free(vecs[0]);
+    ds_vector_free(vecs[1]);
+}
+#endif
+
+H2CASE(cvector, "find byte and rfind") {
+    struct DSVector *vec = ds_vector_create_capacity(300);
+    UINT8 input[200];
+    INT32 isa;
+    UINT32 i;
+
+    for (i = 0; i < sizeof(input); ++i) {
+        input[i] = (UINT8)('a' + i % 20);
+    }
+    input[70] = '\n';
+    input[150] = '\n';
+    ds_vector_append(vec, input, sizeof(input));
+
+    for (isa = DS_ISA_SCALAR; isa <= DS_ISA_AVX2 && isa <= ds_vector_isa(); ++isa) {
+        ds_isa_level = isa;
+        H2EQ_MATH(70, ds_vector_find_byte(vec, 0, '\n'));
+        H2EQ_MATH(70, ds_vector_find_byte(vec, 70, '\n'));
+        H2EQ_MATH(150, ds_vector_find_byte(vec, 71, '\n'));
+        H2EQ_MATH(DS_VECTOR_NPOS, ds_vector_find_byte(vec, 151, '\n'));
+        H2EQ_MATH(DS_VECTOR_NPOS, ds_vector_find_byte(vec, 500, '\n'));
+        H2EQ_MATH(150, ds_vector_rfind(vec, DS_VECTOR_NPOS, '\n'));
+        H2EQ_MATH(70, ds_vector_rfind(vec, 150, '\n'));
+        H2EQ_MATH(DS_VECTOR_NPOS, ds_vector_rfind(vec, 70, '\n'));
+        H2EQ_MATH(199, ds_vector_rfind(vec, DS_VECTOR_NPOS, 'a' + 199 % 20));
+    }
+    ds_isa_level = -1;
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "find any") {
+    struct DSVector *vec = ds_vector_create_capacity(300);
+    UINT8 set[] = {'=', ' ', '\n'};
+    UINT8 wide[] = {0x01, 0x12, 0x23, 0x34, 0x45, 0x56, 0x67, 0x7A, 0x89, 0xF0};
+    UINT8 input[200];
+    INT32 isa;
+
+    memset(input, 'x', sizeof(input));
+    input[40] = '=';
+    input[99] = '\n';
+    input[180] = 0xF0;
+    ds_vector_append(vec, input, sizeof(input));
+
+    for (isa = DS_ISA_SCALAR; isa <= DS_ISA_AVX2 && isa <= ds_vector_isa(); ++isa) {
+        ds_isa_level = isa;
+        H2EQ_MATH(40, ds_vector_find_any(vec, 0, set, sizeof(set)));
+        H2EQ_MATH(99, ds_vector_find_any(vec, 41, set, sizeof(set)));
+        H2EQ_MATH(DS_VECTOR_NPOS, ds_vector_find_any(vec, 100, set, sizeof(set)));
+        H2EQ_MATH(180, ds_vector_find_any(vec, 0, wide, sizeof(wide)));
+        H2EQ_MATH(DS_VECTOR_NPOS, ds_vector_find_any(vec, 0, wide, 9));
+    }
+    ds_isa_level = -1;
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "find bytes") {
+    struct DSVector *vec = ds_vector_create_capacity(300);
+    const char *line = "2026-10-19T08:00:01Z INFO worker-3 request path=/api/items status=200 latency_ms=12\n"
+                       "2026-10-19T08:00:02Z WARN worker-7 request path=/api/users status=503 latency_ms=950\n";
+    INT32 isa;
+
+    ds_vector_append(vec, (UINT8 *)line, strlen(line));
+    for (isa = DS_ISA_SCALAR; isa <= DS_ISA_AVX2 && isa <= ds_vector_isa(); ++isa) {
+        ds_isa_level = isa;
+        H2EQ_MATH(59, ds_vector_find_bytes(vec, 0, (const UINT8 *)"status=", 7));
+        H2EQ_MATH(143, ds_vector_find_bytes(vec, 60, (const UINT8 *)"status=", 7));
+        H2EQ_MATH(150, ds_vector_find_bytes(vec, 0, (const UINT8 *)"503", 3));
+        H2EQ_MATH(DS_VECTOR_NPOS, ds_vector_find_bytes(vec, 0, (const UINT8 *)"status=404", 10));
+        H2EQ_MATH(5, ds_vector_find_bytes(vec, 5, (const UINT8 *)"", 0));
+    }
+    ds_isa_level = -1;
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "crc32c") {
+    struct DSVector *vec = ds_vector_create_capacity(300);
+    UINT8 input[200];
+    UINT32 i, crc;
+    INT32 isa;
+
+    ds_vector_append(vec, (UINT8 *)"123456789", 9);
+    for (isa = DS_ISA_SCALAR; isa <= ds_vector_isa(); ++isa) {
+        ds_isa_level = isa;
+        H2EQ_MATH(0xE3069283, ds_vector_crc32c(vec));
+        H2EQ_MATH(0xE3069283, ds_view_crc32c(ds_vector_view(vec, 0, 9)));
+        H2EQ_MATH(0xE3069283, ds_crc32c_update(ds_crc32c_update(0, vec->data, 4), vec->data + 4, 5));
+    }
+    ds_isa_level = -1;
+
+    for (i = 0; i < sizeof(input); ++i) {
+        input[i] = (UINT8)(i * 7);
+    }
+    ds_vector_append(vec, input, sizeof(input));
+    crc = ds_vector_crc32c(vec);
+    ds_isa_level = DS_ISA_SCALAR;
+    H2EQ_MATH(crc, ds_vector_crc32c(vec));
+    ds_isa_level = -1;
+    H2EQ_MATH(0, ds_crc32c_update(0, NULL, 0));
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "hash64") {
+    struct DSVector *vec = ds_vector_create_capacity(300);
+    UINT8 input[100];
+    UINT32 i;
+
+    H2EQ_TRUE(0xEF46DB3751D8E999ULL == ds_vector_hash64(vec, 0));
+    ds_vector_append(vec, (UINT8 *)"abc", 3);
+    H2EQ_TRUE(0x44BC2CF5AD770999ULL == ds_vector_hash64(vec, 0));
+    H2EQ_TRUE(0x44BC2CF5AD770999ULL == ds_view_hash64(ds_vector_view(vec, 0, 3), 0));
+
+    for (i = 0; i < sizeof(input); ++i) {
+        input[i] = (UINT8)i;
+    }
+    vec->size = 0;
+    ds_vector_append(vec, input, sizeof(input));
+    H2EQ_TRUE(0x6AC1E58032166597ULL == ds_vector_hash64(vec, 0));
+    H2EQ_TRUE(0x80653E7E9B887CDDULL == ds_vector_hash64(vec, 7));
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "running crc32c") {
+    struct DSVector *vec = ds_vector_create_capacity(10);
+    UINT8 input[] = {1, 2, 3, 4};
+
+    ds_vector_track_crc32c(vec, TRUE);
+    ds_vector_append(vec, (UINT8 *)"12345", 5);
+    ret = ds_vector_sprintf(vec, "%d", 6789);
+    H2EQ_MATH(4, ret);
+    H2EQ_MATH(9, vec->crc_size);
+    H2EQ_MATH(0xE3069283, vec->crc);
+    H2EQ_MATH(0xE3069283, ds_vector_running_crc32c(vec));
+
+    ds_vector_insert(vec, 9, input, sizeof(input));
+    H2EQ_MATH(9, vec->crc_size);
+    H2EQ_MATH(ds_vector_crc32c(vec), ds_vector_running_crc32c(vec));
+    H2EQ_MATH(13, vec->crc_size);
+
+    ds_vector_insert(vec, 2, input, sizeof(input));
+    H2EQ_MATH(0, vec->crc_size);
+    ds_vector_append(vec, input, sizeof(input));
+    H2EQ_MATH(0, vec->crc_size);
+    H2EQ_MATH(ds_vector_crc32c(vec), ds_vector_running_crc32c(vec));
+    H2EQ_MATH(21, vec->crc_size);
+
+    ds_vector_track_crc32c(vec, FALSE);
+    ds_vector_append(vec, input, sizeof(input));
+    H2EQ_MATH(0, vec->crc_size);
+    H2EQ_MATH(ds_vector_crc32c(vec), ds_vector_running_crc32c(vec));
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "utf-8 validation") {
+    /* each case padded so it lands across 16 and 32 byte block edges */
+    static const struct { const char *text; MYBOOL valid; } cases[] = {
+        {"plain ascii", TRUE},
+        {"caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80 \xF4\x8F\xBF\xBF \xEF\xBF\xBD", TRUE},
+        {"\xC2\x80\xDF\xBF\xE0\xA0\x80\xED\x9F\xBF\xEE\x80\x80\xF0\x90\x80\x80", TRUE},
+        {"\x80", FALSE},                /* stray continuation */
+        {"\xC3", FALSE},                /* cut off */
+        {"\xC3 ", FALSE},               /* too short */
+        {"\xC0\xAF", FALSE},            /* overlong */
+        {"\xC1\xBF", FALSE},
+        {"\xE0\x9F\xBF", FALSE},
+        {"\xF0\x8F\xBF\xBF", FALSE},
+        {"\xED\xA0\x80", FALSE},        /* surrogate */
+        {"\xF4\x90\x80\x80", FALSE},    /* past U+10FFFF */
+        {"\xF5\x80\x80\x80", FALSE},
+        {"\xFF", FALSE},
+        {"\xE2\x82\xAC\xAC", FALSE},    /* too long */
+        {"\xF0\x9F\x98", FALSE},
+    };
+    UINT8 buf[128];
+    UINT32 c, pad, len, wrong = 0;
+    INT32 isa, top = ds_vector_isa();
+
+    for (isa = DS_ISA_SCALAR; isa <= DS_ISA_AVX2 && isa <= top; ++isa) {
+        ds_isa_level = isa;
+        for (c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+            len = (UINT32)strlen(cases[c].text);
+            for (pad = 0; pad < 40; ++pad) {
+                memset(buf, 'x', sizeof(buf));
+                memcpy(buf + pad, cases[c].text, len);
+                wrong += ds_view_validate_utf8({buf, pad + len}) != cases[c].valid;
+                wrong += ds_view_validate_utf8({buf, pad + len + 7}) != cases[c].valid;
+                wrong += ds_view_is_ascii({buf, pad + len}) != (c == 0);
+            }
+        }
+        H2EQ_MATH(TRUE, ds_view_validate_utf8({NULL, 0}));
+        H2EQ_MATH(TRUE, ds_view_is_ascii({NULL, 0}));
+    }
+    ds_isa_level = -1;
+    H2EQ_MATH(0, wrong);
+}
+
+H2CASE(cvector, "utf-8 kernels agree") {
+    static const char *chars[] = {"a", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xED\x9F\xBF"};
+    const char *ch;
+    UINT8 buf[300];
+    UINT32 seed = 12345, round, len, wrong = 0, invalid = 0;
+    MYBOOL expect;
+    INT32 isa, top = ds_vector_isa();
+
+    for (round = 0; round < 3000; ++round) {
+        len = 0;
+        while (len < 280) {
+            seed = seed * 1103515245 + 12345;
+            ch = chars[(seed >> 16) % 5];
+            memcpy(buf + len, ch, strlen(ch));
+            len += (UINT32)strlen(ch);
+        }
+        /* break about two rounds in three with one random byte */
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) % 3) {
+            buf[(seed >> 8) % len] = (UINT8)(seed >> 20);
+        }
+        ds_isa_level = DS_ISA_SCALAR;
+        expect = ds_view_validate_utf8({buf, len});
+        invalid += !expect;
+        for (isa = DS_ISA_SSE2; isa <= DS_ISA_AVX2 && isa <= top; ++isa) {
+            ds_isa_level = isa;
+            wrong += ds_view_validate_utf8({buf, len}) != expect;
+        }
+    }
+    ds_isa_level = -1;
+    H2EQ_MATH(0, wrong);
+    H2EQ_TRUE(invalid > 1000);
+}
+
+H2CASE(cvector, "incremental utf-8 validation") {
+    struct DSVector *vec = ds_vector_create_capacity(10);
+
+    H2EQ_MATH(TRUE, ds_vector_is_ascii(vec));
+    H2EQ_MATH(TRUE, ds_vector_validate_utf8(vec));
+    H2EQ_MATH(FALSE, ds_vector_validate_utf8(NULL));
+
+    ds_vector_append(vec, (UINT8 *)"{\"name\":\"", 9);
+    H2EQ_MATH(TRUE, ds_vector_validate_utf8(vec));
+    H2EQ_MATH(9, vec->ascii_size);
+    H2EQ_MATH(9, vec->utf8_size);
+
+    /* a character split across appends is not valid until it is whole */
+    ds_vector_append(vec, (UINT8 *)"Jos\xC3", 4);
+    H2EQ_MATH(FALSE, ds_vector_validate_utf8(vec));
+    H2EQ_MATH(FALSE, ds_vector_is_ascii(vec));
+    H2EQ_MATH(12, vec->ascii_size);
+    H2EQ_MATH(12, vec->utf8_size);
+    ds_vector_append(vec, (UINT8 *)"\xA9\"}", 3);
+    H2EQ_MATH(TRUE, ds_vector_validate_utf8(vec));
+    H2EQ_MATH(16, vec->utf8_size);
+
+    /* rewriting bytes falls back to the ASCII prefix */
+    ds_vector_replace(vec, 14, 1, (UINT8 *)"\xFF", 1);
+    H2EQ_MATH(12, vec->utf8_size);
+    H2EQ_MATH(FALSE, ds_vector_validate_utf8(vec));
+    ds_vector_replace(vec, 14, 1, (UINT8 *)"\"", 1);
+    H2EQ_MATH(TRUE, ds_vector_validate_utf8(vec));
+
+    ds_vector_modified(vec, 3);
+    H2EQ_MATH(3, vec->ascii_size);
+    H2EQ_MATH(3, vec->utf8_size);
+    vec->data[3] = 0xE2;
+    H2EQ_MATH(FALSE, ds_vector_validate_utf8(vec));
+    ds_vector_modified(vec, 3);
+    vec->data[3] = 'n';
+    H2EQ_MATH(TRUE, ds_vector_validate_utf8(vec));
+
+    ds_vector_resize(vec, 13);
+    H2EQ_MATH(FALSE, ds_vector_validate_utf8(vec));
+    ds_vector_clear(vec);
+    H2EQ_MATH(TRUE, ds_vector_validate_utf8(vec));
+    H2EQ_MATH(TRUE, ds_vector_is_ascii(vec));
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "compress and decompress") {
+    struct DSVector *src = ds_vector_create_capacity(10);
+    struct DSVector *packed = ds_vector_create_capacity(10);
+    struct DSVector *out = ds_vector_create_capacity(10);
+    INT32 level, i;
+
+    for (i = 0; i < 200; ++i) {
+        ds_vector_sprintf(src, "2026-10-19T08:00:%02dZ INFO worker-%d request path=/api/items status=200\n", i % 60, i % 4);
+    }
+    for (level = 1; level <= 9; level += 4) {
+        packed->size = 0;
+        out->size = 0;
+        ret = ds_vector_compress(packed, src, level);
+        H2EQ_MATH(packed->size, ret);
+        H2EQ_TRUE(ret < src->size / 4);
+        ret = ds_vector_decompress(out, packed);
+        H2EQ_MATH(src->size, ret);
+        H2EQ_MATH(src->size, out->size);
+        H2EQ_MEMCMP(src->data, out->data, src->size);
+    }
+
+    /* out-of-range levels are clamped to 1..9 */
+    out->size = 0;
+    ret = ds_vector_compress(out, src, 9);
+    for (level = 10; level <= 1000; level *= 10) {
+        packed->size = 0;
+        H2EQ_MATH(ret, ds_vector_compress(packed, src, level));
+        H2EQ_MEMCMP(out->data, packed->data, ret);
+    }
+    out->size = 0;
+    ret = ds_vector_compress(out, src, 1);
+    packed->size = 0;
+    H2EQ_MATH(ret, ds_vector_compress(packed, src, -3));
+    H2EQ_MEMCMP(out->data, packed->data, ret);
+    out->size = 0;
+    H2EQ_MATH(src->size, ds_vector_decompress(out, packed));
+
+    out->size = 0;
+    packed->data[packed->size / 2] ^= 0x55;
+    H2EQ_MATH(0, ds_vector_decompress(out, packed));
+    H2EQ_MATH(0, out->size);
+    packed->size = 5;
+    H2EQ_MATH(0, ds_vector_decompress(out, packed));
+
+    ds_vector_free(src);
+    ds_vector_free(packed);
+    ds_vector_free(out);
+}
+
+H2CASE(cvector, "compress stream") {
+    struct DSVector *packed = ds_vector_create_capacity(10);
+    struct DSVector *out = ds_vector_create_capacity(10);
+    struct DSCompressStream stream;
+    const char *line = "GET /api/v1/items?page=2 HTTP/1.1 200 1532\n";
+    INT32 i;
+
+    H2EQ_MATH(8, ds_vector_compress_begin(&stream, out, 64));
+    H2EQ_MATH(9, stream.level);
+    out->size = 0;
+    ds_vector_append(out, (UINT8 *)"prefix", 6);
+    H2EQ_MATH(8, ds_vector_compress_begin(&stream, packed, 3));
+    for (i = 0; i < 50; ++i) {
+        H2EQ_TRUE(ds_vector_compress_write(&stream, packed, (const UINT8 *)line, strlen(line)) > 0);
+    }
+    H2EQ_MATH(8, ds_vector_compress_end(&stream, packed));
+
+    ret = ds_vector_decompress(out, packed);
+    H2EQ_MATH(50 * strlen(line), ret);
+    H2EQ_MATH(6 + ret, out->size);
+    H2EQ_MEMCMP("prefix", out->data, 6);
+    for (i = 0; i < 50; ++i) {
+        H2EQ_MEMCMP(line, out->data + 6 + i * strlen(line), strlen(line));
+    }
+    ds_vector_free(packed);
+    ds_vector_free(out);
+}
+
+H2CASE(cvector, "hex encode and decode") {
+    struct DSVector *vec = ds_vector_create_capacity(10);
+    struct DSVector *text = ds_vector_create_capacity(10);
+    UINT8 input[] = {0x00, 0x7F, 0x80, 0xAB, 0xFF};
+    UINT8 bytes[100];
+    UINT32 i;
+    INT32 isa;
+
+    ret = ds_vector_append_hex(vec, input, sizeof(input));
+    H2EQ_MATH(10, ret);
+    H2EQ_MEMCMP("007f80abff", vec->data, 10);
+    vec->size = 0;
+    H2EQ_MATH(5, ds_vector_decode_hex(vec, (const UINT8 *)"007F80abFF", 10));
+    H2EQ_MEMCMP(input, vec->data, sizeof(input));
+    H2EQ_MATH(0, ds_vector_decode_hex(vec, (const UINT8 *)"0g", 2));
+    H2EQ_MATH(0, ds_vector_decode_hex(vec, (const UINT8 *)"abc", 3));
+    H2EQ_MATH(5, vec->size);
+
+    for (i = 0; i < sizeof(bytes); ++i) {
+        bytes[i] = (UINT8)(i * 37);
+    }
+    for (isa = DS_ISA_SCALAR; isa <= ds_vector_isa(); ++isa) {
+        ds_isa_level = isa;
+        text->size = 0;
+        vec->size = 0;
+        ds_vector_append_hex(text, bytes, sizeof(bytes));
+        H2EQ_MATH(sizeof(bytes), ds_vector_decode_hex(vec, text->data, text->size));
+        H2EQ_MEMCMP(bytes, vec->data, sizeof(bytes));
+        text->data[150] = 'x';
+        H2EQ_MATH(0, ds_vector_decode_hex(vec, text->data, text->size));
+    }
+    ds_isa_level = -1;
+    ds_vector_free(vec);
+    ds_vector_free(text);
+}
+
+H2CASE(cvector, "base64 encode and decode") {
+    struct DSVector *vec = ds_vector_create_capacity(10);
+    struct DSVector *text = ds_vector_create_capacity(10);
+    const char *plain[] = {"f", "fo", "foo", "foob", "fooba", "foobar"};
+    const char *coded[] = {"Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy"};
+    UINT8 bytes[100];
+    UINT32 i, coded_len;
+    INT32 isa;
+
+    for (i = 0; i < 6; ++i) {
+        vec->size = 0;
+        H2EQ_MATH(strlen(coded[i]), ds_vector_append_base64(vec, (const UINT8 *)plain[i], strlen(plain[i])));
+        H2EQ_MEMCMP(coded[i], vec->data, strlen(coded[i]));
+        vec->size = 0;
+        H2EQ_MATH(strlen(plain[i]), ds_vector_decode_base64(vec, (const UINT8 *)coded[i], strlen(coded[i])));
+        H2EQ_MEMCMP(plain[i], vec->data, strlen(plain[i]));
+    }
+    H2EQ_MATH(0, ds_vector_decode_base64(vec, (const UINT8 *)"Zm9", 3));
+    H2EQ_MATH(0, ds_vector_decode_base64(vec, (const UINT8 *)"Zm=v", 4));
+    H2EQ_MATH(0, ds_vector_decode_base64(vec, (const UINT8 *)"Z===", 4));
+
+    for (i = 0; i < sizeof(bytes); ++i) {
+        bytes[i] = (UINT8)(i * 53 + 11);
+    }
+    for (isa = DS_ISA_SCALAR; isa <= ds_vector_isa(); ++isa) {
+        ds_isa_level = isa;
+        text->size = 0;
+        vec->size = 0;
+        coded_len = ds_vector_append_base64(text, bytes, sizeof(bytes));
+        H2EQ_MATH(136, coded_len);
+        H2EQ_MATH(sizeof(bytes), ds_vector_decode_base64(vec, text->data, coded_len));
+        H2EQ_MEMCMP(bytes, vec->data, sizeof(bytes));
+        text->data[40] = '-';
+        H2EQ_MATH(0, ds_vector_decode_base64(vec, text->data, coded_len));
+    }
+    ds_isa_level = -1;
+    ds_vector_free(vec);
+    ds_vector_free(text);
+}
+
+static INT32 compare_desc32(const void *a, const void *b, void *arg)
+{
+    UINT32 x = *(const UINT32 *)a, y = *(const UINT32 *)b;
+    ++*(UINT32 *)arg;
+    return x > y ? -1 : x < y;
+}
+
+H2CASE(cvector, "sort keys") {
+    struct DSVector *vec = ds_vector_create_capacity(10);
+    UINT8 small[] = {9, 3, 200, 3, 0, 255};
+    UINT8 sorted_small[] = {0, 3, 3, 9, 200, 255};
+    UINT64 key;
+    UINT32 i, key32, unordered;
+
+    ds_vector_append(vec, small, sizeof(small));
+    H2EQ_MATH(6, ds_vector_sort_keys(vec, 1));
+    H2EQ_MEMCMP(sorted_small, vec->data, sizeof(small));
+    H2EQ_MATH(3, ds_vector_sort_keys(vec, 2));
+    H2EQ_MATH(0, ds_vector_sort_keys(vec, 4));
+    H2EQ_MATH(0, ds_vector_sort_keys(vec, 3));
+
+    vec->size = 0;
+    for (i = 0; i < 1000; ++i) {
+        key32 = (i * 2654435761u) ^ (i << 7);
+        ds_vector_append(vec, (UINT8 *)&key32, sizeof(key32));
+    }
+    H2EQ_MATH(1000, ds_vector_sort_keys(vec, 4));
+    for (i = 1, unordered = 0; i < 1000; ++i) {
+        unordered += ((UINT32 *)vec->data)[i - 1] > ((UINT32 *)vec->data)[i];
+    }
+    H2EQ_MATH(0, unordered);
+
+    vec->size = 0;
+    for (i = 0; i < 600; ++i) {
+        key = (UINT64)(600 - i) << 40 | (i % 3);
+        ds_vector_append(vec, (UINT8 *)&key, sizeof(key));
+    }
+    H2EQ_MATH(600, ds_vector_sort_keys(vec, 8));
+    H2EQ_TRUE(((UINT64)1 << 40 | 2) == ((UINT64 *)vec->data)[0]);
+    H2EQ_TRUE(((UINT64)600 << 40) == ((UINT64 *)vec->data)[599]);
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "sort with comparator") {
+    struct DSVector *vec = ds_vector_create_capacity(10);
+    UINT32 i, value, calls = 0, unordered;
+
+    for (i = 0; i < 5000; ++i) {
+        value = i % 97 * 1000 + i % 13;
+        ds_vector_append(vec, (UINT8 *)&value, sizeof(value));
+    }
+    H2EQ_MATH(5000, ds_vector_sort(vec, 4, compare_desc32, &calls));
+    for (i = 1, unordered = 0; i < 5000; ++i) {
+        unordered += ((UINT32 *)vec->data)[i - 1] < ((UINT32 *)vec->data)[i];
+    }
+    H2EQ_MATH(0, unordered);
+
+    /* already sorted input is detected and finishes in linear time */
+    calls = 0;
+    ds_vector_sort(vec, 4, compare_desc32, &calls);
+    H2EQ_TRUE(calls < 3 * 5000);
+    H2EQ_MATH(0, ds_vector_sort(vec, 3, compare_desc32, &calls));
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "growth near the size limit") {
+    struct DSVector *vec = ds_vector_create_capacity(10);
+    DSSize capacity;
+
+    ds_vector_append(vec, (UINT8 *)"abc", 3);
+    capacity = vec->capacity;
+    /* requests that would overflow DSSize fail without touching the vector */
+    H2EQ_MATH(0, ds_vector_append(vec, (UINT8 *)"abc", DS_SIZE_MAX - 2));
+    H2EQ_MATH(0, ds_vector_insert(vec, 1, (UINT8 *)"abc", DS_SIZE_MAX - 3));
+    H2EQ_MATH(0, ds_vector_resize(vec, DS_SIZE_MAX));
+    H2EQ_TRUE(3 == vec->size && capacity == vec->capacity);
+    H2EQ_MATH(0, memcmp(vec->data, "abc", 3));
+    ds_vector_free(vec);
+}
+
+H2CASE(cvector, "mapped storage")
+{
+    UINT8 *pages = (UINT8 *)mmap(NULL, 8192, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    struct DSVector *vec;
+    UINT32 i;
+
+    memcpy(pages, "mapped", 6);
+    H2EQ_TRUE(ds_vector_create_mapped(pages, 8192, 8192) == NULL);
+    vec = ds_vector_create_mapped(pages, 6, 8192);
+    H2EQ_TRUE(vec != NULL);
+    H2EQ_TRUE(vec->data == pages && (vec->flags & DS_VECTOR_MAPPED));
+    H2EQ_TRUE(ds_vector_memory_usage(vec) >= 8192);
+    ds_vector_append(vec, (UINT8 *)" bytes", 6);
+    H2EQ_TRUE(vec->data == pages);
+
+    /* the first reallocation leaves the mapping for the heap */
+    for (i = 0; i < 1000; ++i) {
+        ds_vector_append(vec, (UINT8 *)"0123456789", 10);
+    }
+    H2EQ_TRUE(vec->data != pages && !(vec->flags & DS_VECTOR_MAPPED));
+    H2EQ_MATH(0, memcmp(vec->data, "mapped bytes0123456789", 22));
+    ds_vector_free(vec);
+
+    pages = (UINT8 *)mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ds_vector_free(ds_vector_create_mapped(pages, 0, 4096));
+}
@@ -1,121 +1,3848 @@
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#ifdef DS_VECTOR_TELEMETRY
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
 
 #include "vector.h"
 
-static INT32 DS_VECTOR_BASE_CAPACITY = 10;
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DS_VECTOR_X86 1
+#define DS_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+static DSSize DS_VECTOR_BASE_CAPACITY = 10;
 static float DS_VECTOR_EXPAND_RATIO = 1.5;
 
-/* private function to check and possibly expand a vector's capacity */
-static MYBOOL ds_vector_maybe_expand(struct DSVector *vec, UINT32 length)
+#ifdef DS_VECTOR_STATS
+#define DS_STAT_ADD(vec, field, n) ((vec)->stats.field += (n))
+#define DS_STAT_PEAK(vec, field, value) \
+    do { if ((value) > (vec)->stats.field) (vec)->stats.field = (value); } while (0)
+#else
+#define DS_STAT_ADD(vec, field, n) ((void)0)
+#define DS_STAT_PEAK(vec, field, value) ((void)0)
+#endif
+
+#define DS_HUGE_PAGE_SIZE (2u << 20)
+
+/* DS_VECTOR_AUTO_SHRINK leaves capacities below this alone and never shrinks under a quarter of it */
+#define DS_SHRINK_MIN_CAPACITY (64u << 10)
+
+/* DS_VECTOR_PREGROW starts once the capacity reaches this, and copies this many bytes per step */
+#define DS_PREGROW_MIN_CAPACITY (1u << 20)
+#define DS_PREGROW_PIECE (1u << 20)
+
+/* DS_VECTOR_INCREMENTAL migrates once the capacity reaches this, at least this many bytes per call */
+#define DS_MIGRATE_MIN_CAPACITY (1u << 20)
+#define DS_MIGRATE_STEP (64u << 10)
+
+/* private function returning the alignment the storage flags ask for, 0 for plain malloc */
+static size_t ds_vector_alignment(UINT32 flags, size_t bytes)
+{
+    if ((flags & DS_VECTOR_HUGE_PAGES) && bytes >= DS_HUGE_PAGE_SIZE) {
+        return DS_HUGE_PAGE_SIZE;
+    }
+#if defined(__linux__)
+    /* locked storage owns whole pages, so unlocking it cannot unpin a neighbour */
+    if (flags & DS_VECTOR_LOCKED) {
+        return (size_t)sysconf(_SC_PAGESIZE);
+    }
+#endif
+    if (flags & DS_VECTOR_ALIGN_64) {
+        return 64;
+    }
+    if (flags & DS_VECTOR_ALIGN_32) {
+        return 32;
+    }
+    return 0;
+}
+
+/*
+ * private function to move data to a new block of bytes, keeping the first
+ * keep bytes. Aligned storage cannot use realloc, so it is copied.
+ */
+static UINT8 *ds_vector_realloc_data(UINT8 *data, DSSize keep, size_t bytes, UINT32 flags)
+{
+    size_t align = ds_vector_alignment(flags, bytes);
+    void *mem = NULL;
+
+    if (align == 0) {
+        return (UINT8 *)realloc(data, bytes);
+    }
+    /* page aligned storage is also rounded to whole pages */
+    if (align > 64) {
+        bytes = (bytes + align - 1) & ~(size_t)(align - 1);
+    }
+    if (posix_memalign(&mem, align, bytes ? bytes : align) != 0) {
+        return NULL;
+    }
+#if defined(MADV_HUGEPAGE)
+    if (align == DS_HUGE_PAGE_SIZE) {
+        madvise(mem, bytes, MADV_HUGEPAGE);
+    }
+#endif
+    if (data) {
+        memcpy(mem, data, keep);
+        free(data);
+    }
+    return (UINT8 *)mem;
+}
+
+/* private function to free a data block of capacity bytes, unmapping mapped storage */
+static void ds_vector_free_data(UINT8 *data, DSSize capacity, UINT32 flags)
+{
+#if defined(__linux__)
+    if (flags & DS_VECTOR_MAPPED) {
+        munmap(data, capacity);
+        return;
+    }
+#else
+    (void)capacity;
+    (void)flags;
+#endif
+    free(data);
+}
+
+#ifdef DS_VECTOR_TELEMETRY
+/*
+ * Telemetry registry: one slot per creation call site in a fixed open
+ * addressed table, each holding a list of its live vectors. Nothing is
+ * allocated, so the dump can run from a signal handler; it only writes
+ * with write(2) and backs off when the registry lock is held.
+ */
+#define DS_TELEMETRY_SITES 1024
+
+struct DSVectorSite {
+    const char *file;
+    INT32 line;
+    UINT64 created;
+    UINT64 grows;
+    struct DSVector *live;
+};
+
+static struct DSVectorSite ds_sites[DS_TELEMETRY_SITES];
+static char ds_sites_lock;
+
+static MYBOOL ds_telemetry_lock(UINT32 tries)
+{
+    while (__atomic_test_and_set(&ds_sites_lock, __ATOMIC_ACQUIRE)) {
+        if (tries && --tries == 0) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static void ds_telemetry_unlock(void)
+{
+    __atomic_clear(&ds_sites_lock, __ATOMIC_RELEASE);
+}
+
+/* slot of a call site, the last slot collects sites that do not fit */
+static struct DSVectorSite *ds_telemetry_site(const char *file, INT32 line)
+{
+    UINT32 i, slot = (UINT32)(((size_t)file >> 3) * 2654435761u + (UINT32)line * 40503u);
+
+    for (i = 0; i < DS_TELEMETRY_SITES - 1; ++i) {
+        struct DSVectorSite *site = &ds_sites[(slot + i) % (DS_TELEMETRY_SITES - 1)];
+        if (!site->file) {
+            site->file = file;
+            site->line = line;
+            return site;
+        }
+        if (site->file == file && site->line == line) {
+            return site;
+        }
+    }
+    ds_sites[DS_TELEMETRY_SITES - 1].file = "(other)";
+    return &ds_sites[DS_TELEMETRY_SITES - 1];
+}
+
+static void ds_telemetry_link(struct DSVector *vec, const char *file, INT32 line)
+{
+    ds_telemetry_lock(0);
+    vec->site = ds_telemetry_site(file ? file : "(unknown)", line);
+    vec->site_prev = NULL;
+    vec->site_next = vec->site->live;
+    if (vec->site_next) {
+        vec->site_next->site_prev = vec;
+    }
+    vec->site->live = vec;
+    ++vec->site->created;
+    ds_telemetry_unlock();
+}
+
+static void ds_telemetry_unlink(struct DSVector *vec)
+{
+    ds_telemetry_lock(0);
+    if (vec->site_prev) {
+        vec->site_prev->site_next = vec->site_next;
+    } else {
+        vec->site->live = vec->site_next;
+    }
+    if (vec->site_next) {
+        vec->site_next->site_prev = vec->site_prev;
+    }
+    ds_telemetry_unlock();
+}
+
+/* small write buffer, formatting by hand keeps the dump async-signal-safe */
+struct DSDumpBuffer {
+    int fd;
+    UINT32 used;
+    MYBOOL failed;
+    char data[4096];
+};
+
+static void ds_dump_flush(struct DSDumpBuffer *out)
+{
+    UINT32 done = 0;
+    ssize_t n;
+
+    while (done < out->used && !out->failed) {
+        n = write(out->fd, out->data + done, out->used - done);
+        if (n > 0) {
+            done += (UINT32)n;
+        } else if (n < 0 && errno != EINTR) {
+            out->failed = TRUE;
+        }
+    }
+    out->used = 0;
+}
+
+static void ds_dump_str(struct DSDumpBuffer *out, const char *str, MYBOOL json)
+{
+    for (; *str; ++str) {
+        if (out->used + 2 > sizeof(out->data)) {
+            ds_dump_flush(out);
+        }
+        if (json && (*str == '"' || *str == '\\')) {
+            out->data[out->used++] = '\\';
+        }
+        out->data[out->used++] = *str;
+    }
+}
+
+static void ds_dump_u64(struct DSDumpBuffer *out, UINT64 value)
+{
+    char digits[24];
+    UINT32 n = 0;
+
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    if (out->used + n > sizeof(out->data)) {
+        ds_dump_flush(out);
+    }
+    while (n) {
+        out->data[out->used++] = digits[--n];
+    }
+}
+
+static INT32 ds_telemetry_write(int fd, MYBOOL json, UINT32 tries)
+{
+    struct DSDumpBuffer out;
+    struct DSVectorSite *site;
+    struct DSVector *vec;
+    UINT64 live, bytes, slack;
+    INT32 sites = 0;
+    UINT32 i;
+
+    out.fd = fd;
+    out.used = 0;
+    out.failed = FALSE;
+    if (!ds_telemetry_lock(tries)) {
+        return -1;
+    }
+    ds_dump_str(&out, json ? "{\"sites\":[" : "# site live_vectors live_bytes slack_bytes grows created\n", FALSE);
+    for (i = 0; i < DS_TELEMETRY_SITES; ++i) {
+        site = &ds_sites[i];
+        if (!site->file) {
+            continue;
+        }
+        for (live = bytes = slack = 0, vec = site->live; vec; vec = vec->site_next) {
+            ++live;
+            bytes += vec->capacity;
+            slack += vec->capacity - vec->size;
+        }
+        ds_dump_str(&out, json ? (sites ? ",{\"file\":\"" : "{\"file\":\"") : "", FALSE);
+        ds_dump_str(&out, site->file, json);
+        ds_dump_str(&out, json ? "\",\"line\":" : ":", FALSE);
+        ds_dump_u64(&out, (UINT64)site->line);
+        ds_dump_str(&out, json ? ",\"live_vectors\":" : " ", FALSE);
+        ds_dump_u64(&out, live);
+        ds_dump_str(&out, json ? ",\"live_bytes\":" : " ", FALSE);
+        ds_dump_u64(&out, bytes);
+        ds_dump_str(&out, json ? ",\"slack_bytes\":" : " ", FALSE);
+        ds_dump_u64(&out, slack);
+        ds_dump_str(&out, json ? ",\"grows\":" : " ", FALSE);
+        ds_dump_u64(&out, __atomic_load_n(&site->grows, __ATOMIC_RELAXED));
+        ds_dump_str(&out, json ? ",\"created\":" : " ", FALSE);
+        ds_dump_u64(&out, site->created);
+        ds_dump_str(&out, json ? "}" : "\n", FALSE);
+        ++sites;
+    }
+    ds_telemetry_unlock();
+    ds_dump_str(&out, json ? "]}\n" : "", FALSE);
+    ds_dump_flush(&out);
+    return out.failed ? -1 : sites;
+}
+
+static const char *ds_telemetry_signal_path;
+static MYBOOL ds_telemetry_signal_json;
+
+static void ds_telemetry_signal(int signo)
+{
+    int saved = errno;
+    int fd = open(ds_telemetry_signal_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    (void)signo;
+    if (fd >= 0) {
+        /* the interrupted thread may hold the lock, so only try for a while */
+        ds_telemetry_write(fd, ds_telemetry_signal_json, 1u << 20);
+        close(fd);
+    }
+    errno = saved;
+}
+#endif
+
+INT32 ds_vector_telemetry_dump_fd(int fd, MYBOOL json)
+{
+#ifdef DS_VECTOR_TELEMETRY
+    return fd < 0 ? -1 : ds_telemetry_write(fd, json, 0);
+#else
+    (void)fd;
+    (void)json;
+    return -1;
+#endif
+}
+
+INT32 ds_vector_telemetry_dump(const char* path, MYBOOL json)
+{
+#ifdef DS_VECTOR_TELEMETRY
+    INT32 sites;
+    int fd;
+
+    if (!path || (fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+        return -1;
+    }
+    sites = ds_telemetry_write(fd, json, 0);
+    close(fd);
+    return sites;
+#else
+    (void)path;
+    (void)json;
+    return -1;
+#endif
+}
+
+MYBOOL ds_vector_telemetry_on_signal(INT32 signo, const char* path, MYBOOL json)
+{
+#ifdef DS_VECTOR_TELEMETRY
+    struct sigaction action;
+
+    if (!path) {
+        return FALSE;
+    }
+    ds_telemetry_signal_path = path;
+    ds_telemetry_signal_json = json;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = ds_telemetry_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    return sigaction(signo, &action, NULL) == 0;
+#else
+    (void)signo;
+    (void)path;
+    (void)json;
+    return FALSE;
+#endif
+}
+
+/*
+ * private function to fault in the storage from byte from on, so the
+ * page faults are taken here rather than by the appends that reach it.
+ * DS_VECTOR_LOCKED pins the whole block with mlock, which faults it in
+ * as well; when the lock is refused the vector falls back to prefaulting.
+ */
+static void ds_vector_prepare_pages(struct DSVector *vec, DSSize from)
+{
+#if defined(__linux__)
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    UINT8 *p, *end;
+
+    if (vec->flags & DS_VECTOR_LOCKED) {
+        if (mlock(vec->data, vec->capacity) == 0) {
+            return;
+        }
+        vec->flags = (vec->flags & ~DS_VECTOR_LOCKED) | DS_VECTOR_PREFAULT;
+    }
+    if (!(vec->flags & DS_VECTOR_PREFAULT)) {
+        return;
+    }
+    /* one write per page, only to bytes past the data */
+    end = vec->data + vec->capacity;
+    for (p = vec->data + from; p < end; p = (UINT8 *)(((size_t)p | (page - 1)) + 1)) {
+        *(volatile UINT8 *)p = 0;
+    }
+#else
+    (void)vec;
+    (void)from;
+#endif
+}
+
+/* private function to undo the mlock of DS_VECTOR_LOCKED before the block is released */
+static void ds_vector_unlock_pages(struct DSVector *vec)
+{
+#if defined(__linux__)
+    if ((vec->flags & DS_VECTOR_LOCKED) && vec->data) {
+        munlock(vec->data, vec->capacity);
+    }
+#else
+    (void)vec;
+#endif
+}
+
+/* private function to count a growth of the storage */
+static void ds_vector_grown(struct DSVector *vec)
+{
+    DS_STAT_ADD(vec, grows, 1);
+#ifdef DS_VECTOR_TELEMETRY
+    if (vec->site) {
+        __atomic_add_fetch(&vec->site->grows, 1, __ATOMIC_RELAXED);
+    }
+#else
+    (void)vec;
+#endif
+}
+
+/* private function returning the capacity to grow to for length more bytes, size + length < DS_SIZE_MAX */
+static DSSize ds_vector_next_capacity(struct DSVector *vec, DSSize length)
+{
+    DSSize capacity;
+    double grown;
+
+    /* grow in floating point and clamp, so large ratios or sizes cannot wrap */
+    grown = (double)vec->capacity * DS_VECTOR_EXPAND_RATIO + (double)length;
+    capacity = grown >= (double)DS_SIZE_MAX ? DS_SIZE_MAX : (DSSize)grown;
+    /* keep a spare byte past the data, ds_vector_sprintf writes its terminator there */
+    if (capacity <= vec->size + length) {
+        capacity = vec->size + length + 1;
+    }
+    return capacity;
+}
+
+/* private function telling whether a block of capacity bytes can be allocated at all */
+static MYBOOL ds_vector_addressable(DSSize capacity)
+{
+#if defined(DS_VECTOR_WIDE) && SIZE_MAX < UINT64_MAX
+    return (UINT64)capacity <= (UINT64)SIZE_MAX;
+#else
+    (void)capacity;
+    return TRUE;
+#endif
+}
+
+/*
+ * Background pre-growth (DS_VECTOR_PREGROW). Once a vector passes 3/4 of
+ * its capacity the next block is allocated on the calling thread and a
+ * shared helper thread copies the data into it, one piece at a time. The
+ * copy stops below the lowest position rewritten since it started
+ * (reported through ds_vector_changed, before the write, which waits for
+ * an overlapping piece in flight), so the helper never reads bytes the
+ * caller is writing. Appends only write past the copied range. When the
+ * vector has to grow, the caller stops the helper, copies whatever is
+ * still missing and swaps the blocks. The helper never allocates.
+ */
+struct DSPregrow {
+    struct DSPregrow *next;     /* helper queue */
+    const UINT8 *src;           /* block being copied, the vector's data when the copy started */
+    UINT8 *data;                /* the next block */
+    DSSize capacity;
+    DSSize limit;               /* size when the copy started */
+    DSSize pos;                 /* bytes copied so far */
+    DSSize copying;             /* end of the piece in flight after pos, 0 when idle */
+    DSSize dirty;               /* lowest position rewritten since the copy started */
+    MYBOOL stop;
+    MYBOOL queued;              /* owned by the helper until it clears this */
+    MYBOOL active;              /* a next block exists, caller side only */
+};
+
+#if defined(__linux__)
+static pthread_mutex_t ds_pregrow_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ds_pregrow_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t ds_pregrow_idle = PTHREAD_COND_INITIALIZER;
+static struct DSPregrow *ds_pregrow_head;
+static MYBOOL ds_pregrow_running;
+
+static void *ds_pregrow_main(void *arg)
+{
+    struct DSPregrow *job;
+    DSSize end, piece;
+
+    (void)arg;
+    pthread_mutex_lock(&ds_pregrow_lock);
+    for (;;) {
+        while (!ds_pregrow_head) {
+            pthread_cond_wait(&ds_pregrow_wake, &ds_pregrow_lock);
+        }
+        job = ds_pregrow_head;
+        end = job->limit < job->dirty ? job->limit : job->dirty;
+        if (job->stop || job->pos >= end) {
+            ds_pregrow_head = job->next;
+            job->queued = FALSE;
+            pthread_cond_broadcast(&ds_pregrow_idle);
+            continue;
+        }
+        piece = end - job->pos < DS_PREGROW_PIECE ? end - job->pos : DS_PREGROW_PIECE;
+        job->copying = job->pos + piece;
+        pthread_mutex_unlock(&ds_pregrow_lock);
+        memcpy(job->data + job->pos, job->src + job->pos, piece);
+        pthread_mutex_lock(&ds_pregrow_lock);
+        job->pos += piece;
+        job->copying = 0;
+        pthread_cond_broadcast(&ds_pregrow_idle);
+    }
+    return NULL;
+}
+
+/* private function to wait until the helper has let go of a stopped job */
+static void ds_pregrow_release(struct DSPregrow *job)
+{
+    pthread_mutex_lock(&ds_pregrow_lock);
+    job->stop = TRUE;
+    while (job->queued) {
+        pthread_cond_wait(&ds_pregrow_idle, &ds_pregrow_lock);
+    }
+    pthread_mutex_unlock(&ds_pregrow_lock);
+}
+
+/* private function to start copying into the next block once the size passes the watermark */
+static void ds_pregrow_start(struct DSVector *vec)
+{
+    struct DSPregrow *job = vec->pregrow, **tail;
+    DSSize capacity = ds_vector_next_capacity(vec, 0);
+    pthread_t thread;
+
+    if (!ds_vector_addressable(capacity)) {
+        return;
+    }
+    ds_pregrow_release(job);
+    job->data = ds_vector_realloc_data(NULL, 0, capacity * sizeof(UINT8), vec->flags);
+    if (!job->data) {
+        return;
+    }
+    job->capacity = capacity;
+    job->src = vec->data;
+    job->limit = vec->size;
+    job->pos = 0;
+    job->copying = 0;
+    job->dirty = DS_SIZE_MAX;
+    job->active = TRUE;
+
+    pthread_mutex_lock(&ds_pregrow_lock);
+    if (!ds_pregrow_running) {
+        if (pthread_create(&thread, NULL, ds_pregrow_main, NULL) != 0) {
+            /* no helper: the caller copies everything at the swap */
+            pthread_mutex_unlock(&ds_pregrow_lock);
+            return;
+        }
+        pthread_detach(thread);
+        ds_pregrow_running = TRUE;
+    }
+    job->stop = FALSE;
+    job->queued = TRUE;
+    job->next = NULL;
+    for (tail = &ds_pregrow_head; *tail; tail = &(*tail)->next) {
+    }
+    *tail = job;
+    pthread_cond_signal(&ds_pregrow_wake);
+    pthread_mutex_unlock(&ds_pregrow_lock);
+}
+
+/* private function to note that bytes from pos on are about to be rewritten */
+static void ds_pregrow_dirty(struct DSVector *vec, DSSize pos)
+{
+    struct DSPregrow *job = vec->pregrow;
+
+    if (!job || !job->active || pos >= job->limit) {
+        return;
+    }
+    /* later pieces stop below pos, one in flight over pos is waited for */
+    pthread_mutex_lock(&ds_pregrow_lock);
+    if (pos < job->dirty) {
+        job->dirty = pos;
+    }
+    while (job->copying > pos) {
+        pthread_cond_wait(&ds_pregrow_idle, &ds_pregrow_lock);
+    }
+    pthread_mutex_unlock(&ds_pregrow_lock);
+}
+
+/* private function to swap in the next block, copying what the helper has not */
+static void ds_pregrow_finish(struct DSVector *vec)
+{
+    struct DSPregrow *job = vec->pregrow, **link;
+    DSSize done;
+
+    pthread_mutex_lock(&ds_pregrow_lock);
+    job->stop = TRUE;
+    while (job->copying) {
+        pthread_cond_wait(&ds_pregrow_idle, &ds_pregrow_lock);
+    }
+    done = job->pos < job->dirty ? job->pos : job->dirty;
+    /* take the job off the queue so a later free cannot race the helper */
+    if (job->queued) {
+        for (link = &ds_pregrow_head; *link != job; link = &(*link)->next) {
+        }
+        *link = job->next;
+        job->queued = FALSE;
+    }
+    pthread_mutex_unlock(&ds_pregrow_lock);
+
+    if (done > vec->size) {
+        done = vec->size;
+    }
+    memcpy(job->data + done, vec->data + done, vec->size - done);
+    DS_STAT_ADD(vec, bytes_moved, vec->size);
+    ds_vector_unlock_pages(vec);
+    free(vec->data);
+    vec->data = job->data;
+    vec->capacity = job->capacity;
+    job->data = NULL;
+    job->active = FALSE;
+    DS_STAT_PEAK(vec, peak_capacity, vec->capacity);
+    ds_vector_prepare_pages(vec, vec->size);
+    ds_vector_grown(vec);
+}
+
+/* private function to drop the next block, before any other change of the storage */
+static void ds_pregrow_cancel(struct DSVector *vec)
+{
+    struct DSPregrow *job = vec->pregrow;
+
+    if (!job) {
+        return;
+    }
+    /* the helper may still hold a job whose block was already swapped in */
+    ds_pregrow_release(job);
+    if (!job->active) {
+        return;
+    }
+    free(job->data);
+    job->data = NULL;
+    job->active = FALSE;
+}
+#else
+#define ds_pregrow_start(vec) ((void)0)
+#define ds_pregrow_dirty(vec, pos) ((void)0)
+#define ds_pregrow_finish(vec) ((void)0)
+#define ds_pregrow_cancel(vec) ((void)0)
+#endif
+
+/*
+ * Incremental growth (DS_VECTOR_INCREMENTAL). Growth allocates the new
+ * block and makes it vec->data at once, but the old contents move over
+ * in steps: every later call that makes room also copies a bounded
+ * piece, sized so the move completes before the new block fills up.
+ * Until then bytes [moved, limit) still live in the old block, which
+ * ds_vector_at accounts for; everything else that reads or rewrites the
+ * data settles the move first. Settling never changes vec->data.
+ */
+struct DSMigration {
+    UINT8 *old;                 /* previous block, NULL when no move is pending */
+    DSSize old_capacity;
+    DSSize limit;               /* size when the move started */
+    DSSize moved;               /* bytes moved so far */
+};
+
+/* private function to release the old block once everything in it is moved or discarded */
+static void ds_migrate_release(struct DSVector *vec)
+{
+    struct DSMigration *m = vec->migration;
+
+#if defined(__linux__)
+    if (vec->flags & DS_VECTOR_LOCKED) {
+        munlock(m->old, m->old_capacity);
+    }
+#endif
+    free(m->old);
+    m->old = NULL;
+}
+
+/* private function to move the pending bytes below keep and drop the rest */
+static void ds_migrate_settle(struct DSVector *vec, DSSize keep)
+{
+    struct DSMigration *m = vec->migration;
+
+    if (!m || !m->old) {
+        return;
+    }
+    if (keep > m->limit) {
+        keep = m->limit;
+    }
+    if (keep > m->moved) {
+        memcpy(vec->data + m->moved, m->old + m->moved, keep - m->moved);
+        DS_STAT_ADD(vec, bytes_moved, keep - m->moved);
+    }
+    ds_migrate_release(vec);
+}
+
+/* private function to move the next piece, for a call making room for length bytes */
+static void ds_migrate_step(struct DSVector *vec, DSSize length)
+{
+    struct DSMigration *m = vec->migration;
+    double share;
+    DSSize piece;
+
+    /* length bytes use up this share of the room left when the move started */
+    share = (double)length * (double)m->limit / (double)(vec->capacity - m->limit);
+    piece = m->limit - m->moved;
+    if ((double)piece > DS_MIGRATE_STEP + share) {
+        piece = DS_MIGRATE_STEP + (DSSize)share;
+    }
+    memcpy(vec->data + m->moved, m->old + m->moved, piece);
+    DS_STAT_ADD(vec, bytes_moved, piece);
+    m->moved += piece;
+    if (m->moved == m->limit) {
+        ds_migrate_release(vec);
+        return;
+    }
+#if defined(__linux__) && defined(MADV_DONTNEED)
+    /* hand back the moved pages as we go, so freeing the old block stays cheap */
+    if (!(vec->flags & DS_VECTOR_LOCKED)) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        UINT8 *begin = (UINT8 *)(((size_t)(m->old + m->moved - piece) + page - 1) & ~(page - 1));
+        UINT8 *end = (UINT8 *)((size_t)(m->old + m->moved) & ~(page - 1));
+        if (begin < end) {
+            madvise(begin, (size_t)(end - begin), MADV_DONTNEED);
+        }
+    }
+#endif
+}
+
+/* private function to switch to a new block for length more bytes and start moving into it */
+static MYBOOL ds_migrate_start(struct DSVector *vec, DSSize length)
+{
+    struct DSMigration *m = vec->migration;
+    DSSize capacity;
+    UINT8 *data;
+
+    ds_migrate_settle(vec, vec->size);
+    capacity = ds_vector_next_capacity(vec, length);
+    if (!ds_vector_addressable(capacity)) {
+        return FALSE;
+    }
+    data = ds_vector_realloc_data(NULL, 0, capacity * sizeof(UINT8), vec->flags);
+    if (!data) {
+        return FALSE;
+    }
+    m->old = vec->data;
+    m->old_capacity = vec->capacity;
+    m->limit = vec->size;
+    m->moved = 0;
+    vec->data = data;
+    vec->capacity = capacity;
+    DS_STAT_PEAK(vec, peak_capacity, capacity);
+    ds_vector_prepare_pages(vec, 0);
+    ds_vector_grown(vec);
+    ds_migrate_step(vec, length);
+    return TRUE;
+}
+
+void ds_vector_settle(struct DSVector *vec)
+{
+    if (vec) {
+        ds_migrate_settle(vec, vec->size);
+    }
+}
+
+UINT8 *ds_vector_at(struct DSVector *vec, DSSize pos)
+{
+    if (!vec || pos >= vec->size) {
+        return NULL;
+    }
+    if (vec->migration && vec->migration->old && pos >= vec->migration->moved && pos < vec->migration->limit) {
+        return vec->migration->old + pos;
+    }
+    return vec->data + pos;
+}
+
+/* private function to move the data to a block of exactly capacity bytes, capacity > size */
+static MYBOOL ds_vector_set_capacity(struct DSVector *vec, DSSize capacity)
+{
+    UINT8 *new_data;
+
+    if (!ds_vector_addressable(capacity)) {
+        return FALSE;
+    }
+    ds_pregrow_cancel(vec);
+    ds_migrate_settle(vec, vec->size);
+    ds_vector_unlock_pages(vec);
+    if (vec->flags & DS_VECTOR_MAPPED) {
+        /* mapped storage cannot be resized in place; it moves to the heap for good */
+        new_data = ds_vector_realloc_data(NULL, 0, capacity * sizeof(UINT8), vec->flags & ~DS_VECTOR_MAPPED);
+        if (!new_data) {
+            return FALSE;
+        }
+        memcpy(new_data, vec->data, vec->size);
+        ds_vector_free_data(vec->data, vec->capacity, vec->flags);
+        vec->data = NULL;
+        vec->flags &= ~DS_VECTOR_MAPPED;
+    } else {
+        new_data = ds_vector_realloc_data(vec->data, vec->size, capacity * sizeof(UINT8), vec->flags);
+    }
+    if (!new_data) {
+        ds_vector_prepare_pages(vec, vec->capacity);
+        return FALSE;
+    }
+    if (new_data != vec->data) {
+        DS_STAT_ADD(vec, bytes_moved, vec->size);
+    }
+    vec->data = new_data;
+    vec->capacity = capacity;
+    DS_STAT_PEAK(vec, peak_capacity, capacity);
+    ds_vector_prepare_pages(vec, vec->size);
+    return TRUE;
+}
+
+/* private function to check and possibly expand a vector's capacity */
+static MYBOOL ds_vector_maybe_expand(struct DSVector *vec, DSSize length)
+{
+    /* size + length + 1 must stay representable */
+    if (length > DS_SIZE_MAX - vec->size - 1) {
+        return FALSE;
+    }
+    if (vec->size  + length < vec->capacity) {
+        if (vec->migration && vec->migration->old) {
+            ds_migrate_step(vec, length);
+        }
+        if (vec->pregrow && !vec->pregrow->active && vec->capacity >= DS_PREGROW_MIN_CAPACITY &&
+            vec->size + length >= vec->capacity / 4 * 3) {
+            ds_pregrow_start(vec);
+        }
+        return TRUE;
+    }
+    if (vec->pregrow && vec->pregrow->active) {
+        ds_pregrow_finish(vec);
+        if (vec->size + length < vec->capacity) {
+            return TRUE;
+        }
+    }
+    if (vec->migration && vec->capacity >= DS_MIGRATE_MIN_CAPACITY && ds_migrate_start(vec, length)) {
+        return TRUE;
+    }
+    if (!ds_vector_set_capacity(vec, ds_vector_next_capacity(vec, length))) {
+        return FALSE;
+    }
+    ds_vector_grown(vec);
+    return TRUE;
+}
+
+/*
+ * private function applying DS_VECTOR_AUTO_SHRINK after the size dropped.
+ * Growth happens when the storage is full and shrinking only below a
+ * quarter, down to twice the size, so a vector hovering around one size
+ * does not bounce between reallocations.
+ */
+static void ds_vector_maybe_shrink(struct DSVector *vec)
+{
+    DSSize capacity;
+
+    if (!(vec->flags & DS_VECTOR_AUTO_SHRINK) || vec->capacity < DS_SHRINK_MIN_CAPACITY ||
+        vec->size >= vec->capacity / 4) {
+        return;
+    }
+    capacity = vec->size * 2 + 1;
+    if (capacity < DS_SHRINK_MIN_CAPACITY / 4) {
+        capacity = DS_SHRINK_MIN_CAPACITY / 4;
+    }
+    /* a failed shrink leaves the larger block in place */
+    if (ds_vector_set_capacity(vec, capacity)) {
+        DS_STAT_ADD(vec, shrinks, 1);
+    }
+}
+
+/* private function to keep the running checksum in step with new bytes at the tail */
+static void ds_vector_appended(struct DSVector *vec, DSSize old_size)
+{
+    DS_STAT_PEAK(vec, peak_size, vec->size);
+    if ((vec->flags & DS_VECTOR_RUNNING_CRC) && vec->crc_size == old_size) {
+        vec->crc = ds_crc32c_update(vec->crc, vec->data + old_size, vec->size - old_size);
+        vec->crc_size = vec->size;
+    }
+}
+
+/* private function to drop checksum and validation state covering bytes at or after pos */
+static void ds_vector_changed(struct DSVector *vec, DSSize pos)
+{
+    ds_pregrow_dirty(vec, pos);
+    /* bytes from the size at growth on are in the new block already */
+    if (vec->migration && vec->migration->old && pos < vec->migration->limit) {
+        ds_migrate_settle(vec, vec->size);
+    }
+    if (vec->crc_size > pos) {
+        vec->crc = 0;
+        vec->crc_size = 0;
+    }
+    if (vec->ascii_size > pos) {
+        vec->ascii_size = pos;
+    }
+    /* fall back to the ASCII prefix, which ends on a character boundary */
+    if (vec->utf8_size > pos) {
+        vec->utf8_size = vec->ascii_size;
+    }
+}
+
+void ds_vector_modified(struct DSVector *vec, DSSize pos)
+{
+    if (vec) {
+        ds_vector_changed(vec, pos);
+    }
+}
+
+struct DSVector *ds_vector_create_at(DSSize capacity, float expand_ratio, UINT32 flags, const char* file, INT32 line)
+{
+    struct DSVector *vec = NULL;
+    vec = (struct DSVector *)malloc(sizeof(*vec));
+    if (!vec) {
+        return NULL;
+    }
+    vec->size = 0;
+    vec->capacity = capacity;
+    vec->flags = flags & DS_VECTOR_STORAGE_FLAGS;
+#ifdef DS_VECTOR_STATS
+    memset(&vec->stats, 0, sizeof(vec->stats));
+    vec->stats.peak_capacity = capacity;
+#endif
+    vec->crc = 0;
+    vec->crc_size = 0;
+    vec->ascii_size = 0;
+    vec->utf8_size = 0;
+    vec->pregrow = NULL;
+    vec->migration = NULL;
+    /* background growth wins over incremental growth */
+    if ((flags & DS_VECTOR_INCREMENTAL) && !(flags & DS_VECTOR_PREGROW)) {
+        vec->migration = (struct DSMigration *)malloc(sizeof(*vec->migration));
+        if (!vec->migration) {
+            free(vec);
+            return NULL;
+        }
+        memset(vec->migration, 0, sizeof(*vec->migration));
+    }
+#if defined(__linux__)
+    if (flags & DS_VECTOR_PREGROW) {
+        vec->pregrow = (struct DSPregrow *)malloc(sizeof(*vec->pregrow));
+        if (!vec->pregrow) {
+            free(vec->migration);
+            free(vec);
+            return NULL;
+        }
+        memset(vec->pregrow, 0, sizeof(*vec->pregrow));
+    }
+#endif
+    DS_VECTOR_BASE_CAPACITY = capacity;
+    if (expand_ratio >= 0) {
+        DS_VECTOR_EXPAND_RATIO = expand_ratio;
+    }
+    vec->data = ds_vector_realloc_data(NULL, 0, vec->capacity * sizeof(UINT8), vec->flags);
+    if (!vec->data) {
+        free(vec->pregrow);
+        free(vec->migration);
+        free(vec);
+        return NULL;
+    }
+    ds_vector_prepare_pages(vec, 0);
+#ifdef DS_VECTOR_TELEMETRY
+    ds_telemetry_link(vec, file, line);
+#else
+    (void)file;
+    (void)line;
+#endif
+
+    return vec;
+}
+
+struct DSVector *ds_vector_create_mapped(UINT8* data, DSSize size, DSSize capacity)
+{
+    struct DSVector *vec;
+
+    if (!data || size >= capacity) {
+        return NULL;
+    }
+    /* a minimal heap block is allocated and swapped for the mapping */
+    vec = ds_vector_create_at(1, -1, 0, NULL, 0);
+    if (!vec) {
+        return NULL;
+    }
+    free(vec->data);
+    vec->data = data;
+    vec->size = size;
+    vec->capacity = capacity;
+    vec->flags = DS_VECTOR_MAPPED;
+    DS_STAT_PEAK(vec, peak_size, size);
+    DS_STAT_PEAK(vec, peak_capacity, capacity);
+    return vec;
+}
+
+/* the names are parenthesized so the call-site macros of DS_VECTOR_TELEMETRY do not apply */
+struct DSVector *(ds_vector_create)(DSSize capacity, float expand_ratio)
+{
+    return ds_vector_create_at(capacity, expand_ratio, 0, NULL, 0);
+}
+
+struct DSVector *(ds_vector_create_flags)(DSSize capacity, float expand_ratio, UINT32 flags)
+{
+    return ds_vector_create_at(capacity, expand_ratio, flags, NULL, 0);
+}
+
+struct DSVector *(ds_vector_create_capacity)(DSSize capacity)
+{
+    return ds_vector_create_at(capacity, -1, 0, NULL, 0);
+}
+
+void ds_vector_free(struct DSVector *vec)
+{
+    if (!vec) {
+        return;
+    }
+
+#ifdef DS_VECTOR_TELEMETRY
+    ds_telemetry_unlink(vec);
+#endif
+    ds_pregrow_cancel(vec);
+    free(vec->pregrow);
+    ds_migrate_settle(vec, 0);
+    free(vec->migration);
+    ds_vector_unlock_pages(vec);
+    ds_vector_free_data(vec->data, vec->capacity, vec->flags);
+    free(vec);
+}
+
+DSSize ds_vector_append(struct DSVector *vec, UINT8* data, DSSize length)
+{
+    if (!vec || !data || length <= 0) {
+        return 0;
+    }
+
+    if (!ds_vector_maybe_expand(vec, length)) {
+        return 0;
+    }
+    memcpy(vec->data + vec->size, data, length);
+    vec->size += length;
+    ds_vector_appended(vec, vec->size - length);
+    return length;
+}
+
+DSSize ds_vector_resize(struct DSVector *vec, DSSize size)
+{
+    DSSize old_size;
+
+    if (!vec || size == DS_SIZE_MAX) {
+        return 0;
+    }
+    old_size = vec->size;
+    if (size > old_size && !ds_vector_maybe_expand(vec, size - old_size)) {
+        return 0;
+    }
+    if (size < old_size) {
+        ds_migrate_settle(vec, size);
+    }
+    vec->size = size;
+    DS_STAT_PEAK(vec, peak_size, size);
+    if (size > old_size) {
+        ds_vector_changed(vec, old_size);
+    } else {
+        ds_vector_changed(vec, size);
+        ds_vector_maybe_shrink(vec);
+    }
+    return size;
+}
+
+DSSize ds_vector_reserve(struct DSVector *vec, DSSize capacity)
+{
+    if (!vec || capacity == DS_SIZE_MAX) {
+        return 0;
+    }
+    /* the spare byte past the data needs capacity + 1 */
+    if (capacity + 1 <= vec->capacity) {
+        return vec->capacity;
+    }
+    /* a pre-grown block that is large enough is swapped in, not thrown away */
+    if (vec->pregrow && vec->pregrow->active && capacity + 1 <= vec->pregrow->capacity) {
+        ds_pregrow_finish(vec);
+        return vec->capacity;
+    }
+    if (!ds_vector_set_capacity(vec, capacity + 1)) {
+        return 0;
+    }
+    ds_vector_grown(vec);
+    return vec->capacity;
+}
+
+void ds_vector_clear(struct DSVector *vec)
+{
+    if (vec) {
+        ds_migrate_settle(vec, 0);
+        ds_vector_changed(vec, 0);
+        vec->size = 0;
+    }
+}
+
+MYBOOL ds_vector_shrink_to_fit(struct DSVector *vec)
+{
+    if (!vec) {
+        return FALSE;
+    }
+    if (vec->capacity == vec->size + 1) {
+        return TRUE;
+    }
+    if (!ds_vector_set_capacity(vec, vec->size + 1)) {
+        return FALSE;
+    }
+    DS_STAT_ADD(vec, shrinks, 1);
+    return TRUE;
+}
+
+DSSize ds_vector_insert(struct DSVector *vec, DSSize index, UINT8* data, DSSize length)
+{
+    if (!vec || !data|| index > vec->size) {
+        return 0;
+    }
+
+    if (!ds_vector_maybe_expand(vec, length)) {
+        return 0;
+    }
+    ds_vector_changed(vec, index);
+    DS_STAT_ADD(vec, bytes_moved, vec->size - index);
+
+    memmove(vec->data + index + length, vec->data + index, vec->size - index);
+    memcpy(vec->data + index, data, length);
+    vec->size += length;
+    DS_STAT_PEAK(vec, peak_size, vec->size);
+
+    return length;
+}
+
+DSSize ds_vector_erase(struct DSVector *vec, DSSize pos, DSSize length)
+{
+    if (!vec || pos > vec->size) {
+        return 0;
+    }
+    if (length > vec->size - pos) {
+        length = vec->size - pos;
+    }
+    if (length == 0) {
+        return 0;
+    }
+    ds_vector_changed(vec, pos);
+    DS_STAT_ADD(vec, bytes_moved, vec->size - pos - length);
+    memmove(vec->data + pos, vec->data + pos + length, vec->size - pos - length);
+    vec->size -= length;
+    ds_vector_maybe_shrink(vec);
+    return length;
+}
+
+MYBOOL ds_vector_replace(struct DSVector *vec, DSSize pos, DSSize length, UINT8* data, DSSize new_length)
+{
+    DSSize tail;
+
+    if (!vec || pos > vec->size || length > vec->size - pos || (!data && new_length)) {
+        return FALSE;
+    }
+    if (new_length > length && !ds_vector_maybe_expand(vec, new_length - length)) {
+        return FALSE;
+    }
+    ds_vector_changed(vec, pos);
+    tail = vec->size - pos - length;
+    if (new_length != length) {
+        DS_STAT_ADD(vec, bytes_moved, tail);
+        memmove(vec->data + pos + new_length, vec->data + pos + length, tail);
+    }
+    if (new_length) {
+        memcpy(vec->data + pos, data, new_length);
+    }
+    vec->size = pos + new_length + tail;
+    DS_STAT_PEAK(vec, peak_size, vec->size);
+    if (new_length < length) {
+        ds_vector_maybe_shrink(vec);
+    }
+    return TRUE;
+}
+
+DSSize ds_vector_erase_if(struct DSVector *vec, UINT32 elem_size, DSPredicate pred, void* arg)
+{
+    DSSize count, read, write, run;
+
+    if (!vec || !pred || elem_size == 0 || vec->size % elem_size) {
+        return 0;
+    }
+    ds_migrate_settle(vec, vec->size);
+    count = vec->size / elem_size;
+
+    /* nothing moves until the first erased element */
+    for (read = 0; read < count && !pred(vec->data + (size_t)read * elem_size, arg); ++read) {
+    }
+    write = read;
+    if (read < count) {
+        ds_vector_changed(vec, read * elem_size);
+    }
+    while (read < count) {
+        /* skip erased elements, then move the next run of kept ones in one go */
+        for (++read; read < count && pred(vec->data + (size_t)read * elem_size, arg); ++read) {
+        }
+        if (read == count) {
+            break;
+        }
+        for (run = read + 1; run < count && !pred(vec->data + (size_t)run * elem_size, arg); ++run) {
+        }
+        DS_STAT_ADD(vec, bytes_moved, (UINT64)(run - read) * elem_size);
+        memmove(vec->data + (size_t)write * elem_size, vec->data + (size_t)read * elem_size,
+                (size_t)(run - read) * elem_size);
+        write += run - read;
+        read = run;
+    }
+    if (write == count) {
+        return 0;
+    }
+    vec->size = write * elem_size;
+    ds_vector_maybe_shrink(vec);
+    return count - write;
+}
+
+DSSize ds_vector_concat(struct DSVector *dest, struct DSVector *src) {
+    if (!dest || !src) {
+        return 0;
+    }
+    ds_vector_settle(src);
+
+    return ds_vector_append(dest, src->data, src->size);
+}
+
+DSSize ds_vector_concat_many(struct DSVector *dest, struct DSVector **srcs, UINT32 n)
+{
+    UINT64 total = 0;
+    DSSize old_size;
+    UINT32 i;
+
+    if (!dest || (!srcs && n)) {
+        return 0;
+    }
+    for (i = 0; i < n; ++i) {
+        if (srcs[i] == dest) {
+            return 0;
+        }
+        ds_vector_settle(srcs[i]);
+        total += srcs[i] ? srcs[i]->size : 0;
+    }
+    if (total == 0 || total > DS_SIZE_MAX - dest->size - 1) {
+        return 0;
+    }
+    if (!ds_vector_maybe_expand(dest, (DSSize)total)) {
+        return 0;
+    }
+    old_size = dest->size;
+    for (i = 0; i < n; ++i) {
+        if (srcs[i] && srcs[i]->size) {
+            memcpy(dest->data + dest->size, srcs[i]->data, srcs[i]->size);
+            dest->size += srcs[i]->size;
+        }
+    }
+    ds_vector_appended(dest, old_size);
+    return (DSSize)total;
+}
+
+UINT32 ds_vector_sprintf(struct DSVector *dest, const char* format, ...) {
+    DSSize room, old_size;
+    INT32 size;
+    va_list arg, again;
+
+    if (!dest || !format) {
+        return 0;
+    }
+    room = dest->capacity > dest->size ? dest->capacity - dest->size : 0;
+
+    /* format straight into the spare capacity and only remeasure when it does not fit */
+    va_start(arg, format);
+    va_copy(again, arg);
+    size = vsnprintf(room ? (char *)&dest->data[dest->size] : NULL, room, format, arg);
+    va_end(arg);
+    if (size >= 0 && (UINT32)size >= room) {
+        DS_STAT_ADD(dest, sprintf_remeasures, 1);
+        if (!ds_vector_maybe_expand(dest, (DSSize)size)) {
+            size = -1;
+        } else {
+            vsnprintf((char *)&dest->data[dest->size], (size_t)size + 1, format, again);
+        }
+    }
+    va_end(again);
+    if (size < 0) {
+        return 0;
+    }
+    old_size = dest->size;
+    dest->size += (DSSize)size;
+    ds_vector_appended(dest, old_size);
+    return (UINT32)size;
+}
+
+/* private function returning the heap bytes behind a block of requested bytes */
+static UINT64 ds_heap_block_size(void *block, UINT64 requested)
+{
+#if defined(__GLIBC__) && !defined(DS_VECTOR_NO_USABLE_SIZE)
+    (void)requested;
+    return block ? malloc_usable_size(block) : 0;
+#else
+    return block ? requested : 0;
+#endif
+}
+
+UINT64 ds_vector_memory_usage(struct DSVector *vec)
+{
+    UINT64 data_bytes;
+    size_t align;
+
+    if (!vec) {
+        return 0;
+    }
+    data_bytes = vec->capacity;
+    align = ds_vector_alignment(vec->flags, data_bytes);
+    if (align > 64) {
+        data_bytes = (data_bytes + align - 1) & ~(UINT64)(align - 1);
+    }
+    if (vec->flags & DS_VECTOR_MAPPED) {
+        data_bytes += ds_heap_block_size(vec, sizeof(*vec));
+    } else {
+        data_bytes = ds_heap_block_size(vec, sizeof(*vec)) + ds_heap_block_size(vec->data, data_bytes);
+    }
+    if (vec->pregrow) {
+        data_bytes += ds_heap_block_size(vec->pregrow, sizeof(*vec->pregrow));
+        if (vec->pregrow->active) {
+            data_bytes += ds_heap_block_size(vec->pregrow->data, vec->pregrow->capacity);
+        }
+    }
+    if (vec->migration) {
+        data_bytes += ds_heap_block_size(vec->migration, sizeof(*vec->migration));
+        data_bytes += ds_heap_block_size(vec->migration->old, vec->migration->old_capacity);
+    }
+    return data_bytes;
+}
+
+DSSize ds_vector_release_idle(struct DSVector *vec)
+{
+#if defined(__linux__) && defined(MADV_DONTNEED)
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    UINT8 *begin, *end;
+
+    if (!vec || !vec->data || page == 0) {
+        return 0;
+    }
+    /* whole pages strictly inside the unused capacity, past the spare byte */
+    begin = (UINT8 *)(((size_t)(vec->data + vec->size + 1) + page - 1) & ~(page - 1));
+    end = (UINT8 *)((size_t)(vec->data + vec->capacity) & ~(page - 1));
+    if (begin >= end || madvise(begin, (size_t)(end - begin), MADV_DONTNEED) != 0) {
+        return 0;
+    }
+    return (DSSize)(end - begin);
+#else
+    (void)vec;
+    return 0;
+#endif
+}
+
+MYBOOL ds_vector_stats(struct DSVector *vec, struct DSVectorStats *out)
+{
+    if (!out) {
+        return FALSE;
+    }
+    memset(out, 0, sizeof(*out));
+#ifdef DS_VECTOR_STATS
+    if (vec) {
+        *out = vec->stats;
+        return TRUE;
+    }
+#else
+    (void)vec;
+#endif
+    return FALSE;
+}
+
+struct DSVectorView ds_vector_view(struct DSVector *vec, DSSize pos, DSSize length)
+{
+    struct DSVectorView view = {NULL, 0};
+    if (!vec || pos > vec->size) {
+        return view;
+    }
+    ds_vector_settle(vec);
+    if (length > vec->size - pos) {
+        length = vec->size - pos;
+    }
+    view.data = vec->data + pos;
+    view.size = length;
+    return view;
+}
+
+/*
+ * Search kernels. Every kernel works on a plain (data, size) range and
+ * returns the offset of the match inside that range or DS_VECTOR_NPOS.
+ * The public functions below pick the widest kernel the CPU supports
+ * the first time they are called.
+ */
+typedef DSSize (*ds_find_byte_fn)(const UINT8 *data, DSSize size, UINT8 byte);
+typedef DSSize (*ds_find_set_fn)(const UINT8 *data, DSSize size, const UINT8 *lo, const UINT8 *hi);
+
+/* nibble tables used by the SIMD kernels, plus a 256-entry fallback table */
+struct DSByteSet {
+    UINT8 lo[16];
+    UINT8 hi[16];
+    MYBOOL nibble_ok;
+    UINT8 member[256];
+};
+
+static void ds_byte_set_init(struct DSByteSet *set, const UINT8 *bytes, UINT32 count, MYBOOL need_member)
+{
+    UINT8 bucket[16];
+    UINT32 i, buckets = 0;
+
+    memset(set->lo, 0, sizeof(set->lo));
+    memset(set->hi, 0, sizeof(set->hi));
+    memset(bucket, 0xFF, sizeof(bucket));
+    set->nibble_ok = TRUE;
+    for (i = 0; i < count; ++i) {
+        UINT8 h = bytes[i] >> 4, l = bytes[i] & 0x0F;
+        if (bucket[h] == 0xFF) {
+            if (buckets == 8) {
+                set->nibble_ok = FALSE;
+                break;
+            }
+            bucket[h] = (UINT8)buckets++;
+            set->hi[h] = (UINT8)(1u << bucket[h]);
+        }
+        set->lo[l] |= (UINT8)(1u << bucket[h]);
+    }
+    if (need_member || !set->nibble_ok) {
+        memset(set->member, 0, sizeof(set->member));
+        for (i = 0; i < count; ++i) {
+            set->member[bytes[i]] = 1;
+        }
+    }
+}
+
+static DSSize ds_find_byte_scalar(const UINT8 *data, DSSize size, UINT8 byte)
+{
+    DSSize i;
+    for (i = 0; i < size; ++i) {
+        if (data[i] == byte) {
+            return i;
+        }
+    }
+    return DS_VECTOR_NPOS;
+}
+
+static DSSize ds_rfind_byte_scalar(const UINT8 *data, DSSize size, UINT8 byte)
+{
+    while (size > 0) {
+        if (data[--size] == byte) {
+            return size;
+        }
+    }
+    return DS_VECTOR_NPOS;
+}
+
+static DSSize ds_find_set_scalar(const UINT8 *data, DSSize size, const UINT8 *member)
+{
+    DSSize i;
+    for (i = 0; i < size; ++i) {
+        if (member[data[i]]) {
+            return i;
+        }
+    }
+    return DS_VECTOR_NPOS;
+}
+
+#ifdef DS_VECTOR_X86
+DS_TARGET("sse2")
+static DSSize ds_find_byte_sse2(const UINT8 *data, DSSize size, UINT8 byte)
+{
+    __m128i needle = _mm_set1_epi8((char)byte);
+    DSSize i = 0;
+    DSSize rest;
+    UINT32 mask;
+
+    for (; i + 16 <= size; i += 16) {
+        mask = (UINT32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i)), needle));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    rest = ds_find_byte_scalar(data + i, size - i, byte);
+    return rest == DS_VECTOR_NPOS ? DS_VECTOR_NPOS : i + rest;
+}
+
+DS_TARGET("avx2")
+static DSSize ds_find_byte_avx2(const UINT8 *data, DSSize size, UINT8 byte)
+{
+    __m256i needle = _mm256_set1_epi8((char)byte);
+    DSSize i = 0;
+    DSSize rest;
+    UINT32 mask;
+
+    for (; i + 64 <= size; i += 64) {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i)), needle);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i + 32)), needle);
+        if (_mm256_movemask_epi8(_mm256_or_si256(a, b))) {
+            mask = (UINT32)_mm256_movemask_epi8(a);
+            if (mask) {
+                return i + __builtin_ctz(mask);
+            }
+            return i + 32 + __builtin_ctz((UINT32)_mm256_movemask_epi8(b));
+        }
+    }
+    for (; i + 32 <= size; i += 32) {
+        mask = (UINT32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i)), needle));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    rest = ds_find_byte_sse2(data + i, size - i, byte);
+    return rest == DS_VECTOR_NPOS ? DS_VECTOR_NPOS : i + rest;
+}
+
+DS_TARGET("sse2")
+static DSSize ds_rfind_byte_sse2(const UINT8 *data, DSSize size, UINT8 byte)
+{
+    __m128i needle = _mm_set1_epi8((char)byte);
+    int mask;
+
+    while (size >= 16) {
+        size -= 16;
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + size)), needle));
+        if (mask) {
+            return size + 31 - __builtin_clz((UINT32)mask);
+        }
+    }
+    return ds_rfind_byte_scalar(data, size, byte);
+}
+
+DS_TARGET("avx2")
+static DSSize ds_rfind_byte_avx2(const UINT8 *data, DSSize size, UINT8 byte)
+{
+    __m256i needle = _mm256_set1_epi8((char)byte);
+    UINT32 mask;
+
+    while (size >= 32) {
+        size -= 32;
+        mask = (UINT32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + size)), needle));
+        if (mask) {
+            return size + 31 - __builtin_clz(mask);
+        }
+    }
+    return ds_rfind_byte_sse2(data, size, byte);
+}
+
+/*
+ * Nibble-table ("shufti") set matching: a byte is in the set when the
+ * bucket bits selected by its low nibble and its high nibble intersect.
+ * Exact for sets spanning at most 8 distinct high nibbles.
+ */
+DS_TARGET("ssse3")
+static DSSize ds_find_set_ssse3(const UINT8 *data, DSSize size, const UINT8 *lo, const UINT8 *hi)
+{
+    __m128i lo_tbl = _mm_loadu_si128((const __m128i *)lo);
+    __m128i hi_tbl = _mm_loadu_si128((const __m128i *)hi);
+    __m128i low4 = _mm_set1_epi8(0x0F);
+    __m128i zero = _mm_setzero_si128();
+    DSSize i = 0;
+    int mask;
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i l = _mm_shuffle_epi8(lo_tbl, _mm_and_si128(v, low4));
+        __m128i h = _mm_shuffle_epi8(hi_tbl, _mm_and_si128(_mm_srli_epi16(v, 4), low4));
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(l, h), zero)) ^ 0xFFFF;
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    for (; i < size; ++i) {
+        if (lo[data[i] & 0x0F] & hi[data[i] >> 4]) {
+            return i;
+        }
+    }
+    return DS_VECTOR_NPOS;
+}
+
+DS_TARGET("avx2")
+static DSSize ds_find_set_avx2(const UINT8 *data, DSSize size, const UINT8 *lo, const UINT8 *hi)
+{
+    __m256i lo_tbl = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)lo));
+    __m256i hi_tbl = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)hi));
+    __m256i low4 = _mm256_set1_epi8(0x0F);
+    __m256i zero = _mm256_setzero_si256();
+    DSSize i = 0;
+    DSSize rest;
+    UINT32 mask;
+
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i l = _mm256_shuffle_epi8(lo_tbl, _mm256_and_si256(v, low4));
+        __m256i h = _mm256_shuffle_epi8(hi_tbl, _mm256_and_si256(_mm256_srli_epi16(v, 4), low4));
+        mask = ~(UINT32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(l, h), zero));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    rest = ds_find_set_ssse3(data + i, size - i, lo, hi);
+    return rest == DS_VECTOR_NPOS ? DS_VECTOR_NPOS : i + rest;
+}
+
+/*
+ * Substring search: compare the first and the last needle byte at every
+ * candidate position in one pass and only memcmp where both match.
+ */
+DS_TARGET("avx2")
+static DSSize ds_find_bytes_avx2(const UINT8 *data, DSSize size, const UINT8 *needle, UINT32 needle_len)
+{
+    __m256i first = _mm256_set1_epi8((char)needle[0]);
+    __m256i last = _mm256_set1_epi8((char)needle[needle_len - 1]);
+    DSSize i = 0;
+    UINT32 mask, bit;
+
+    for (; i + needle_len + 31 <= size; i += 32) {
+        __m256i a = _mm256_cmpeq_epi8(first, _mm256_loadu_si256((const __m256i *)(data + i)));
+        __m256i b = _mm256_cmpeq_epi8(last, _mm256_loadu_si256((const __m256i *)(data + i + needle_len - 1)));
+        mask = (UINT32)_mm256_movemask_epi8(_mm256_and_si256(a, b));
+        while (mask) {
+            bit = __builtin_ctz(mask);
+            if (needle_len <= 2 || memcmp(data + i + bit + 1, needle + 1, needle_len - 2) == 0) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    for (; i + needle_len <= size; ++i) {
+        if (data[i] == needle[0] && memcmp(data + i, needle, needle_len) == 0) {
+            return i;
+        }
+    }
+    return DS_VECTOR_NPOS;
+}
+
+DS_TARGET("sse2")
+static DSSize ds_find_bytes_sse2(const UINT8 *data, DSSize size, const UINT8 *needle, UINT32 needle_len)
+{
+    __m128i first = _mm_set1_epi8((char)needle[0]);
+    __m128i last = _mm_set1_epi8((char)needle[needle_len - 1]);
+    DSSize i = 0;
+    UINT32 mask, bit;
+
+    for (; i + needle_len + 15 <= size; i += 16) {
+        __m128i a = _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i *)(data + i)));
+        __m128i b = _mm_cmpeq_epi8(last, _mm_loadu_si128((const __m128i *)(data + i + needle_len - 1)));
+        mask = (UINT32)_mm_movemask_epi8(_mm_and_si128(a, b));
+        while (mask) {
+            bit = __builtin_ctz(mask);
+            if (needle_len <= 2 || memcmp(data + i + bit + 1, needle + 1, needle_len - 2) == 0) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    for (; i + needle_len <= size; ++i) {
+        if (data[i] == needle[0] && memcmp(data + i, needle, needle_len) == 0) {
+            return i;
+        }
+    }
+    return DS_VECTOR_NPOS;
+}
+#endif
+
+static DSSize ds_find_bytes_scalar(const UINT8 *data, DSSize size, const UINT8 *needle, UINT32 needle_len)
+{
+    DSSize i, pos;
+    for (i = 0; i + needle_len <= size; i = pos + 1) {
+        pos = ds_find_byte_scalar(data + i, size - i - needle_len + 1, needle[0]);
+        if (pos == DS_VECTOR_NPOS) {
+            break;
+        }
+        pos += i;
+        if (memcmp(data + pos, needle, needle_len) == 0) {
+            return pos;
+        }
+    }
+    return DS_VECTOR_NPOS;
+}
+
+/* cpu feature levels, resolved once */
+#define DS_ISA_SCALAR 0
+#define DS_ISA_SSE2   1
+#define DS_ISA_SSSE3  2
+#define DS_ISA_SSE42  3
+#define DS_ISA_AVX2   4
+
+/* threads racing to resolve it store the same value; atomics keep that well defined */
+static INT32 ds_isa_level = -1;
+
+static INT32 ds_vector_isa(void)
+{
+    INT32 level = __atomic_load_n(&ds_isa_level, __ATOMIC_RELAXED);
+    if (level >= 0) {
+        return level;
+    }
+    level = DS_ISA_SCALAR;
+#ifdef DS_VECTOR_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        level = DS_ISA_SSE2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        level = DS_ISA_SSSE3;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        level = DS_ISA_SSE42;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        level = DS_ISA_AVX2;
+    }
+#endif
+    __atomic_store_n(&ds_isa_level, level, __ATOMIC_RELAXED);
+    return level;
+}
+
+/* clamps [from, end) to the vector, returns FALSE when the range is empty */
+static MYBOOL ds_vector_search_range(struct DSVector *vec, DSSize from, DSSize *end)
+{
+    if (!vec || !vec->data || from >= vec->size) {
+        return FALSE;
+    }
+    ds_vector_settle(vec);
+    if (*end > vec->size) {
+        *end = vec->size;
+    }
+    return from < *end;
+}
+
+static DSSize ds_find_byte_range(const UINT8 *data, DSSize size, UINT8 byte)
+{
+    switch (ds_vector_isa()) {
+#ifdef DS_VECTOR_X86
+    case DS_ISA_AVX2:
+        return ds_find_byte_avx2(data, size, byte);
+    case DS_ISA_SSE42:
+    case DS_ISA_SSSE3:
+    case DS_ISA_SSE2:
+        return ds_find_byte_sse2(data, size, byte);
+#endif
+    default:
+        return ds_find_byte_scalar(data, size, byte);
+    }
+}
+
+DSSize ds_vector_find_byte(struct DSVector *vec, DSSize from, UINT8 byte)
+{
+    DSSize end = DS_VECTOR_NPOS, pos;
+    if (!ds_vector_search_range(vec, from, &end)) {
+        return DS_VECTOR_NPOS;
+    }
+    pos = ds_find_byte_range(vec->data + from, end - from, byte);
+    return pos == DS_VECTOR_NPOS ? DS_VECTOR_NPOS : from + pos;
+}
+
+DSSize ds_vector_rfind(struct DSVector *vec, DSSize end, UINT8 byte)
+{
+    if (!ds_vector_search_range(vec, 0, &end)) {
+        return DS_VECTOR_NPOS;
+    }
+    switch (ds_vector_isa()) {
+#ifdef DS_VECTOR_X86
+    case DS_ISA_AVX2:
+        return ds_rfind_byte_avx2(vec->data, end, byte);
+    case DS_ISA_SSE42:
+    case DS_ISA_SSSE3:
+    case DS_ISA_SSE2:
+        return ds_rfind_byte_sse2(vec->data, end, byte);
+#endif
+    default:
+        return ds_rfind_byte_scalar(vec->data, end, byte);
+    }
+}
+
+DSSize ds_vector_find_any(struct DSVector *vec, DSSize from, const UINT8 *set, UINT32 set_len)
+{
+    struct DSByteSet bytes;
+    DSSize end = DS_VECTOR_NPOS, pos;
+    INT32 isa;
+
+    if (!set || set_len == 0 || !ds_vector_search_range(vec, from, &end)) {
+        return DS_VECTOR_NPOS;
+    }
+    if (set_len == 1) {
+        return ds_vector_find_byte(vec, from, set[0]);
+    }
+    isa = ds_vector_isa();
+    ds_byte_set_init(&bytes, set, set_len, isa < DS_ISA_SSSE3);
+#ifdef DS_VECTOR_X86
+    if (bytes.nibble_ok && isa == DS_ISA_AVX2) {
+        pos = ds_find_set_avx2(vec->data + from, end - from, bytes.lo, bytes.hi);
+    } else if (bytes.nibble_ok && isa >= DS_ISA_SSSE3) {
+        pos = ds_find_set_ssse3(vec->data + from, end - from, bytes.lo, bytes.hi);
+    } else
+#endif
+    {
+        (void)isa;
+        pos = ds_find_set_scalar(vec->data + from, end - from, bytes.member);
+    }
+    return pos == DS_VECTOR_NPOS ? DS_VECTOR_NPOS : from + pos;
+}
+
+DSSize ds_vector_find_bytes(struct DSVector *vec, DSSize from, const UINT8 *needle, UINT32 needle_len)
+{
+    DSSize end = DS_VECTOR_NPOS, pos;
+
+    if (!needle || !ds_vector_search_range(vec, from, &end)) {
+        return DS_VECTOR_NPOS;
+    }
+    if (needle_len == 0) {
+        return from;
+    }
+    if (needle_len == 1) {
+        return ds_vector_find_byte(vec, from, needle[0]);
+    }
+    if (needle_len > end - from) {
+        return DS_VECTOR_NPOS;
+    }
+    switch (ds_vector_isa()) {
+#ifdef DS_VECTOR_X86
+    case DS_ISA_AVX2:
+        pos = ds_find_bytes_avx2(vec->data + from, end - from, needle, needle_len);
+        break;
+    case DS_ISA_SSE42:
+    case DS_ISA_SSSE3:
+    case DS_ISA_SSE2:
+        pos = ds_find_bytes_sse2(vec->data + from, end - from, needle, needle_len);
+        break;
+#endif
+    default:
+        pos = ds_find_bytes_scalar(vec->data + from, end - from, needle, needle_len);
+        break;
+    }
+    return pos == DS_VECTOR_NPOS ? DS_VECTOR_NPOS : from + pos;
+}
+
+/*
+ * CRC32C (Castagnoli). The SSE4.2 crc32 instruction handles 8 bytes per
+ * step; other CPUs use slicing-by-8 tables built on first use.
+ */
+#define DS_CRC32C_POLY 0x82F63B78u
+
+static UINT32 ds_crc32c_table[8][256];
+static pthread_once_t ds_crc32c_table_once = PTHREAD_ONCE_INIT;
+
+static void ds_crc32c_build_table(void)
+{
+    UINT32 i, j, crc;
+
+    for (i = 0; i < 256; ++i) {
+        crc = i;
+        for (j = 0; j < 8; ++j) {
+            crc = (crc >> 1) ^ (DS_CRC32C_POLY & (0u - (crc & 1)));
+        }
+        ds_crc32c_table[0][i] = crc;
+    }
+    for (i = 0; i < 256; ++i) {
+        for (j = 1; j < 8; ++j) {
+            ds_crc32c_table[j][i] = (ds_crc32c_table[j - 1][i] >> 8) ^ ds_crc32c_table[0][ds_crc32c_table[j - 1][i] & 0xFF];
+        }
+    }
+}
+
+/* builds the slicing tables once; every other caller waits for them */
+static void ds_crc32c_init_table(void)
+{
+    pthread_once(&ds_crc32c_table_once, ds_crc32c_build_table);
+}
+
+static UINT32 ds_crc32c_sw(UINT32 crc, const UINT8 *data, DSSize length)
+{
+    UINT32 lo, hi;
+
+    ds_crc32c_init_table();
+    while (length >= 8) {
+        memcpy(&lo, data, 4);
+        memcpy(&hi, data + 4, 4);
+        lo ^= crc;
+        crc = ds_crc32c_table[7][lo & 0xFF] ^ ds_crc32c_table[6][(lo >> 8) & 0xFF] ^
+              ds_crc32c_table[5][(lo >> 16) & 0xFF] ^ ds_crc32c_table[4][lo >> 24] ^
+              ds_crc32c_table[3][hi & 0xFF] ^ ds_crc32c_table[2][(hi >> 8) & 0xFF] ^
+              ds_crc32c_table[1][(hi >> 16) & 0xFF] ^ ds_crc32c_table[0][hi >> 24];
+        data += 8;
+        length -= 8;
+    }
+    while (length--) {
+        crc = (crc >> 8) ^ ds_crc32c_table[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+#if defined(DS_VECTOR_X86) && defined(__x86_64__)
+DS_TARGET("sse4.2")
+static UINT32 ds_crc32c_hw(UINT32 crc, const UINT8 *data, DSSize length)
+{
+    UINT64 crc64 = crc, word;
+
+    while (length >= 8) {
+        memcpy(&word, data, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        length -= 8;
+    }
+    crc = (UINT32)crc64;
+    while (length--) {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+    return crc;
+}
+#endif
+
+UINT32 ds_crc32c_update(UINT32 crc, const UINT8 *data, DSSize length)
+{
+    if (!data || length == 0) {
+        return crc;
+    }
+    crc = ~crc;
+#if defined(DS_VECTOR_X86) && defined(__x86_64__)
+    if (ds_vector_isa() >= DS_ISA_SSE42) {
+        return ~ds_crc32c_hw(crc, data, length);
+    }
+#endif
+    return ~ds_crc32c_sw(crc, data, length);
+}
+
+UINT32 ds_view_crc32c(struct DSVectorView view)
+{
+    return ds_crc32c_update(0, view.data, view.size);
+}
+
+UINT32 ds_vector_crc32c(struct DSVector *vec)
+{
+    if (!vec) {
+        return 0;
+    }
+    ds_vector_settle(vec);
+    return ds_crc32c_update(0, vec->data, vec->size);
+}
+
+void ds_vector_track_crc32c(struct DSVector *vec, MYBOOL enable)
+{
+    if (!vec) {
+        return;
+    }
+    if (enable) {
+        vec->flags |= DS_VECTOR_RUNNING_CRC;
+    } else {
+        vec->flags &= ~DS_VECTOR_RUNNING_CRC;
+    }
+    vec->crc = 0;
+    vec->crc_size = 0;
+}
+
+UINT32 ds_vector_running_crc32c(struct DSVector *vec)
+{
+    if (!vec) {
+        return 0;
+    }
+    if (!(vec->flags & DS_VECTOR_RUNNING_CRC)) {
+        return ds_vector_crc32c(vec);
+    }
+    if (vec->crc_size > vec->size) {
+        vec->crc = 0;
+        vec->crc_size = 0;
+    }
+    if (vec->crc_size < vec->size) {
+        ds_vector_settle(vec);
+        vec->crc = ds_crc32c_update(vec->crc, vec->data + vec->crc_size, vec->size - vec->crc_size);
+        vec->crc_size = vec->size;
+    }
+    return vec->crc;
+}
+
+/*
+ * UTF-8 validation. The vector kernels use the lookup algorithm of
+ * simdjson (Keiser and Lemire): three nibble tables classify each pair
+ * of adjacent bytes, and a saturating subtract marks the bytes that must
+ * be the third or fourth of a sequence. Errors are OR-ed together and
+ * tested once at the end. A block of plain ASCII only has to check that
+ * the block before it did not stop inside a sequence.
+ */
+#define DS_UTF8_TOO_SHORT      0x01  /* lead not followed by a continuation */
+#define DS_UTF8_TOO_LONG       0x02  /* continuation after ASCII */
+#define DS_UTF8_OVERLONG_3     0x04  /* E0 80..9F */
+#define DS_UTF8_TOO_LARGE      0x08  /* F4 90..BF, F5..FF */
+#define DS_UTF8_SURROGATE      0x10  /* ED A0..BF */
+#define DS_UTF8_OVERLONG_2     0x20  /* C0, C1 */
+#define DS_UTF8_TOO_LARGE_1000 0x40  /* F5..FF 80..8F */
+#define DS_UTF8_OVERLONG_4     0x40  /* F0 80..8F */
+#define DS_UTF8_TWO_CONTS      0x80  /* continuation after continuation, unless must23 says so */
+#define DS_UTF8_CARRY (DS_UTF8_TOO_SHORT | DS_UTF8_TOO_LONG | DS_UTF8_TWO_CONTS)
+
+/* indexed by the high nibble of the first byte of a pair */
+static const UINT8 ds_utf8_byte1_high[16] = {
+    DS_UTF8_TOO_LONG, DS_UTF8_TOO_LONG, DS_UTF8_TOO_LONG, DS_UTF8_TOO_LONG,
+    DS_UTF8_TOO_LONG, DS_UTF8_TOO_LONG, DS_UTF8_TOO_LONG, DS_UTF8_TOO_LONG,
+    DS_UTF8_TWO_CONTS, DS_UTF8_TWO_CONTS, DS_UTF8_TWO_CONTS, DS_UTF8_TWO_CONTS,
+    DS_UTF8_TOO_SHORT | DS_UTF8_OVERLONG_2,
+    DS_UTF8_TOO_SHORT,
+    DS_UTF8_TOO_SHORT | DS_UTF8_OVERLONG_3 | DS_UTF8_SURROGATE,
+    DS_UTF8_TOO_SHORT | DS_UTF8_TOO_LARGE | DS_UTF8_TOO_LARGE_1000 | DS_UTF8_OVERLONG_4
+};
+
+/* indexed by the low nibble of the first byte of a pair */
+static const UINT8 ds_utf8_byte1_low[16] = {
+    DS_UTF8_CARRY | DS_UTF8_OVERLONG_3 | DS_UTF8_OVERLONG_2 | DS_UTF8_OVERLONG_4,
+    DS_UTF8_CARRY | DS_UTF8_OVERLONG_2,
+    DS_UTF8_CARRY,
+    DS_UTF8_CARRY,
+    DS_UTF8_CARRY | DS_UTF8_TOO_LARGE,
+    DS_UTF8_CARRY | DS_UTF8_TOO_LARGE | DS_UTF8_TOO_LARGE_1000,
+    DS_UTF8_CARRY | DS_UTF8_TOO_LARGE | DS_UTF8_TOO_LARGE_1000,
+    DS_UTF8_CARRY | DS_UTF8_TOO_LARGE | DS_UTF8_TOO_LARGE_1000,
+    DS_UTF8_CARRY | DS_UTF8_TOO_LARGE | DS_UTF8_TOO_LARGE_1000,
+    DS_UTF8_CARRY | DS_UTF8_TOO_LARGE | DS_UTF8_TOO_LARGE_1000,
+    DS_UTF8_CARRY | DS_UTF8_TOO_LARGE | DS_UTF8_TOO_LARGE_1000,
+    DS_UTF8_CARRY | DS_UTF8_TOO_LARGE | DS_UTF8_TOO_LARGE_1000,
+    DS_UTF8_CARRY | DS_UTF8_TOO_LARGE | DS_UTF8_TOO_LARGE_1000,
+    DS_UTF8_CARRY | DS_UTF8_TOO_LARGE | DS_UTF8_TOO_LARGE_1000 | DS_UTF8_SURROGATE,
+    DS_UTF8_CARRY | DS_UTF8_TOO_LARGE | DS_UTF8_TOO_LARGE_1000,
+    DS_UTF8_CARRY | DS_UTF8_TOO_LARGE | DS_UTF8_TOO_LARGE_1000
+};
+
+/* indexed by the high nibble of the second byte of a pair */
+static const UINT8 ds_utf8_byte2_high[16] = {
+    DS_UTF8_TOO_SHORT, DS_UTF8_TOO_SHORT, DS_UTF8_TOO_SHORT, DS_UTF8_TOO_SHORT,
+    DS_UTF8_TOO_SHORT, DS_UTF8_TOO_SHORT, DS_UTF8_TOO_SHORT, DS_UTF8_TOO_SHORT,
+    DS_UTF8_TOO_LONG | DS_UTF8_OVERLONG_2 | DS_UTF8_TWO_CONTS | DS_UTF8_OVERLONG_3 |
+        DS_UTF8_TOO_LARGE_1000 | DS_UTF8_OVERLONG_4,
+    DS_UTF8_TOO_LONG | DS_UTF8_OVERLONG_2 | DS_UTF8_TWO_CONTS | DS_UTF8_OVERLONG_3 | DS_UTF8_TOO_LARGE,
+    DS_UTF8_TOO_LONG | DS_UTF8_OVERLONG_2 | DS_UTF8_TWO_CONTS | DS_UTF8_SURROGATE | DS_UTF8_TOO_LARGE,
+    DS_UTF8_TOO_LONG | DS_UTF8_OVERLONG_2 | DS_UTF8_TWO_CONTS | DS_UTF8_SURROGATE | DS_UTF8_TOO_LARGE,
+    DS_UTF8_TOO_SHORT, DS_UTF8_TOO_SHORT, DS_UTF8_TOO_SHORT, DS_UTF8_TOO_SHORT
+};
+
+/* a block is incomplete when one of its last three bytes leads past its end */
+static const UINT8 ds_utf8_incomplete[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF
+};
+
+/* sequence length a lead byte announces, 0 for continuations and bytes never valid */
+static UINT32 ds_utf8_length(UINT8 lead)
+{
+    if (lead < 0x80) {
+        return 1;
+    }
+    if (lead < 0xC2) {
+        return 0;
+    }
+    if (lead < 0xE0) {
+        return 2;
+    }
+    if (lead < 0xF0) {
+        return 3;
+    }
+    return lead < 0xF5 ? 4 : 0;
+}
+
+/* end of the last whole character: a sequence cut off by the end of data is left out */
+static DSSize ds_utf8_complete(const UINT8 *data, DSSize size)
+{
+    DSSize i = size;
+    UINT32 length;
+
+    while (i > 0 && size - i < 3 && (data[i - 1] & 0xC0) == 0x80) {
+        --i;
+    }
+    if (i == 0) {
+        return size;
+    }
+    length = ds_utf8_length(data[i - 1]);
+    return length > size - (i - 1) ? i - 1 : size;
+}
+
+static DSSize ds_ascii_prefix_scalar(const UINT8 *data, DSSize size)
+{
+    DSSize i = 0;
+    UINT64 word;
+
+    for (; i + 8 <= size; i += 8) {
+        memcpy(&word, data + i, 8);
+        if (word & 0x8080808080808080ULL) {
+            break;
+        }
+    }
+    for (; i < size; ++i) {
+        if (data[i] & 0x80) {
+            return i;
+        }
+    }
+    return size;
+}
+
+static MYBOOL ds_utf8_valid_scalar(const UINT8 *data, DSSize size)
+{
+    DSSize i = 0;
+    UINT32 length, k;
+    UINT8 lo, hi;
+
+    while (i < size) {
+        i += ds_ascii_prefix_scalar(data + i, size - i);
+        if (i == size) {
+            break;
+        }
+        length = ds_utf8_length(data[i]);
+        if (length == 0 || length > size - i) {
+            return FALSE;
+        }
+        /* the second byte range rules out overlongs, surrogates and code points past U+10FFFF */
+        lo = data[i] == 0xE0 ? 0xA0 : data[i] == 0xF0 ? 0x90 : 0x80;
+        hi = data[i] == 0xED ? 0x9F : data[i] == 0xF4 ? 0x8F : 0xBF;
+        if (data[i + 1] < lo || data[i + 1] > hi) {
+            return FALSE;
+        }
+        for (k = 2; k < length; ++k) {
+            if ((data[i + k] & 0xC0) != 0x80) {
+                return FALSE;
+            }
+        }
+        i += length;
+    }
+    return TRUE;
+}
+
+#ifdef DS_VECTOR_X86
+DS_TARGET("sse2")
+static DSSize ds_ascii_prefix_sse2(const UINT8 *data, DSSize size)
+{
+    DSSize i = 0;
+    int mask;
+
+    for (; i + 16 <= size; i += 16) {
+        mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(data + i)));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + ds_ascii_prefix_scalar(data + i, size - i);
+}
+
+DS_TARGET("avx2")
+static DSSize ds_ascii_prefix_avx2(const UINT8 *data, DSSize size)
+{
+    DSSize i = 0;
+    UINT32 mask;
+
+    for (; i + 64 <= size; i += 64) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(data + i + 32));
+        if (_mm256_movemask_epi8(_mm256_or_si256(a, b))) {
+            break;
+        }
+    }
+    for (; i + 32 <= size; i += 32) {
+        mask = (UINT32)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(data + i)));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + ds_ascii_prefix_scalar(data + i, size - i);
+}
+
+DS_TARGET("ssse3")
+static MYBOOL ds_utf8_valid_ssse3(const UINT8 *data, DSSize size)
+{
+    __m128i byte1_high = _mm_loadu_si128((const __m128i *)ds_utf8_byte1_high);
+    __m128i byte1_low = _mm_loadu_si128((const __m128i *)ds_utf8_byte1_low);
+    __m128i byte2_high = _mm_loadu_si128((const __m128i *)ds_utf8_byte2_high);
+    __m128i max = _mm_loadu_si128((const __m128i *)(ds_utf8_incomplete + 16));
+    __m128i low4 = _mm_set1_epi8(0x0F);
+    __m128i prev = _mm_setzero_si128();
+    __m128i incomplete = _mm_setzero_si128();
+    __m128i error = _mm_setzero_si128();
+    UINT8 tail[16];
+    DSSize i;
+
+    for (i = 0; i < size; i += 16) {
+        __m128i v, prev1, special, must23;
+        if (i + 16 <= size) {
+            v = _mm_loadu_si128((const __m128i *)(data + i));
+        } else {
+            /* zero padding is ASCII, so a sequence cut off by the end still fails */
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, data + i, size - i);
+            v = _mm_loadu_si128((const __m128i *)tail);
+        }
+        if (!_mm_movemask_epi8(v)) {
+            error = _mm_or_si128(error, incomplete);
+            incomplete = _mm_setzero_si128();
+        } else {
+            prev1 = _mm_alignr_epi8(v, prev, 15);
+            special = _mm_and_si128(
+                _mm_and_si128(_mm_shuffle_epi8(byte1_high, _mm_and_si128(_mm_srli_epi16(prev1, 4), low4)),
+                              _mm_shuffle_epi8(byte1_low, _mm_and_si128(prev1, low4))),
+                _mm_shuffle_epi8(byte2_high, _mm_and_si128(_mm_srli_epi16(v, 4), low4)));
+            must23 = _mm_or_si128(_mm_subs_epu8(_mm_alignr_epi8(v, prev, 14), _mm_set1_epi8((char)(0xE0 - 0x80))),
+                                  _mm_subs_epu8(_mm_alignr_epi8(v, prev, 13), _mm_set1_epi8((char)(0xF0 - 0x80))));
+            must23 = _mm_and_si128(must23, _mm_set1_epi8((char)0x80));
+            error = _mm_or_si128(error, _mm_xor_si128(must23, special));
+            incomplete = _mm_subs_epu8(v, max);
+        }
+        prev = v;
+    }
+    error = _mm_or_si128(error, incomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+
+DS_TARGET("avx2")
+static MYBOOL ds_utf8_valid_avx2(const UINT8 *data, DSSize size)
+{
+    __m256i byte1_high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)ds_utf8_byte1_high));
+    __m256i byte1_low = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)ds_utf8_byte1_low));
+    __m256i byte2_high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)ds_utf8_byte2_high));
+    __m256i max = _mm256_loadu_si256((const __m256i *)ds_utf8_incomplete);
+    __m256i low4 = _mm256_set1_epi8(0x0F);
+    __m256i prev = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+    UINT8 tail[32];
+    DSSize i;
+
+    for (i = 0; i < size; i += 32) {
+        __m256i v, shifted, prev1, special, must23;
+        if (i + 32 <= size) {
+            v = _mm256_loadu_si256((const __m256i *)(data + i));
+        } else {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, data + i, size - i);
+            v = _mm256_loadu_si256((const __m256i *)tail);
+        }
+        if (!_mm256_movemask_epi8(v)) {
+            error = _mm256_or_si256(error, incomplete);
+            incomplete = _mm256_setzero_si256();
+        } else {
+            /* alignr works per 128-bit lane: pair each lane with the one before it */
+            shifted = _mm256_permute2x128_si256(prev, v, 0x21);
+            prev1 = _mm256_alignr_epi8(v, shifted, 15);
+            special = _mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_shuffle_epi8(byte1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low4)),
+                    _mm256_shuffle_epi8(byte1_low, _mm256_and_si256(prev1, low4))),
+                _mm256_shuffle_epi8(byte2_high, _mm256_and_si256(_mm256_srli_epi16(v, 4), low4)));
+            must23 = _mm256_or_si256(
+                _mm256_subs_epu8(_mm256_alignr_epi8(v, shifted, 14), _mm256_set1_epi8((char)(0xE0 - 0x80))),
+                _mm256_subs_epu8(_mm256_alignr_epi8(v, shifted, 13), _mm256_set1_epi8((char)(0xF0 - 0x80))));
+            must23 = _mm256_and_si256(must23, _mm256_set1_epi8((char)0x80));
+            error = _mm256_or_si256(error, _mm256_xor_si256(must23, special));
+            incomplete = _mm256_subs_epu8(v, max);
+        }
+        prev = v;
+    }
+    error = _mm256_or_si256(error, incomplete);
+    return _mm256_testz_si256(error, error);
+}
+#endif
+
+static DSSize ds_ascii_prefix(const UINT8 *data, DSSize size)
+{
+    switch (ds_vector_isa()) {
+#ifdef DS_VECTOR_X86
+    case DS_ISA_AVX2:
+        return ds_ascii_prefix_avx2(data, size);
+    case DS_ISA_SSE42:
+    case DS_ISA_SSSE3:
+    case DS_ISA_SSE2:
+        return ds_ascii_prefix_sse2(data, size);
+#endif
+    default:
+        return ds_ascii_prefix_scalar(data, size);
+    }
+}
+
+static MYBOOL ds_utf8_valid(const UINT8 *data, DSSize size)
+{
+    switch (ds_vector_isa()) {
+#ifdef DS_VECTOR_X86
+    case DS_ISA_AVX2:
+        return ds_utf8_valid_avx2(data, size);
+    case DS_ISA_SSE42:
+    case DS_ISA_SSSE3:
+        return ds_utf8_valid_ssse3(data, size);
+#endif
+    default:
+        return ds_utf8_valid_scalar(data, size);
+    }
+}
+
+MYBOOL ds_view_is_ascii(struct DSVectorView view)
+{
+    return !view.data || ds_ascii_prefix(view.data, view.size) == view.size;
+}
+
+MYBOOL ds_view_validate_utf8(struct DSVectorView view)
+{
+    return !view.data || ds_utf8_valid(view.data, view.size);
+}
+
+MYBOOL ds_vector_is_ascii(struct DSVector *vec)
+{
+    if (!vec) {
+        return FALSE;
+    }
+    if (vec->ascii_size > vec->size) {
+        vec->ascii_size = vec->size;
+    }
+    if (vec->ascii_size < vec->size) {
+        ds_vector_settle(vec);
+        vec->ascii_size += ds_ascii_prefix(vec->data + vec->ascii_size, vec->size - vec->ascii_size);
+    }
+    return vec->ascii_size == vec->size;
+}
+
+MYBOOL ds_vector_validate_utf8(struct DSVector *vec)
+{
+    DSSize from, end;
+
+    if (!vec) {
+        return FALSE;
+    }
+    if (vec->utf8_size > vec->size) {
+        vec->utf8_size = 0;
+    }
+    if (ds_vector_is_ascii(vec)) {
+        vec->utf8_size = vec->size;
+        return TRUE;
+    }
+    /* the ASCII prefix is valid UTF-8 and ends on a character boundary */
+    from = vec->utf8_size > vec->ascii_size ? vec->utf8_size : vec->ascii_size;
+    end = from + ds_utf8_complete(vec->data + from, vec->size - from);
+    if (!ds_utf8_valid(vec->data + from, end - from)) {
+        return FALSE;
+    }
+    vec->utf8_size = end;
+    return end == vec->size;
+}
+
+/*
+ * 64-bit non-cryptographic hash. Same algorithm and output as XXH64:
+ * four independent accumulator lanes over 32-byte stripes, then a tail
+ * and an avalanche step.
+ */
+#define DS_HASH_P1 0x9E3779B185EBCA87ULL
+#define DS_HASH_P2 0xC2B2AE3D27D4EB4FULL
+#define DS_HASH_P3 0x165667B19E3779F9ULL
+#define DS_HASH_P4 0x85EBCA77C2B2AE63ULL
+#define DS_HASH_P5 0x27D4EB2F165667C5ULL
+
+#define DS_ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static UINT64 ds_hash_round(UINT64 acc, UINT64 input)
+{
+    acc += input * DS_HASH_P2;
+    acc = DS_ROTL64(acc, 31);
+    return acc * DS_HASH_P1;
+}
+
+static UINT64 ds_hash_merge(UINT64 acc, UINT64 lane)
+{
+    acc ^= ds_hash_round(0, lane);
+    return acc * DS_HASH_P1 + DS_HASH_P4;
+}
+
+static UINT64 ds_hash_read64(const UINT8 *p)
+{
+    UINT64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static UINT32 ds_hash_read32(const UINT8 *p)
+{
+    UINT32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static UINT64 ds_hash64(const UINT8 *data, DSSize length, UINT64 seed)
+{
+    const UINT8 *end = data + length;
+    UINT64 h, v1, v2, v3, v4;
+
+    if (length >= 32) {
+        v1 = seed + DS_HASH_P1 + DS_HASH_P2;
+        v2 = seed + DS_HASH_P2;
+        v3 = seed;
+        v4 = seed - DS_HASH_P1;
+        do {
+            v1 = ds_hash_round(v1, ds_hash_read64(data));
+            v2 = ds_hash_round(v2, ds_hash_read64(data + 8));
+            v3 = ds_hash_round(v3, ds_hash_read64(data + 16));
+            v4 = ds_hash_round(v4, ds_hash_read64(data + 24));
+            data += 32;
+        } while (data + 32 <= end);
+        h = DS_ROTL64(v1, 1) + DS_ROTL64(v2, 7) + DS_ROTL64(v3, 12) + DS_ROTL64(v4, 18);
+        h = ds_hash_merge(h, v1);
+        h = ds_hash_merge(h, v2);
+        h = ds_hash_merge(h, v3);
+        h = ds_hash_merge(h, v4);
+    } else {
+        h = seed + DS_HASH_P5;
+    }
+    h += length;
+
+    for (; data + 8 <= end; data += 8) {
+        h ^= ds_hash_round(0, ds_hash_read64(data));
+        h = DS_ROTL64(h, 27) * DS_HASH_P1 + DS_HASH_P4;
+    }
+    if (data + 4 <= end) {
+        h ^= (UINT64)ds_hash_read32(data) * DS_HASH_P1;
+        h = DS_ROTL64(h, 23) * DS_HASH_P2 + DS_HASH_P3;
+        data += 4;
+    }
+    for (; data < end; ++data) {
+        h ^= *data * DS_HASH_P5;
+        h = DS_ROTL64(h, 11) * DS_HASH_P1;
+    }
+
+    h ^= h >> 33;
+    h *= DS_HASH_P2;
+    h ^= h >> 29;
+    h *= DS_HASH_P3;
+    h ^= h >> 32;
+    return h;
+}
+
+UINT64 ds_view_hash64(struct DSVectorView view, UINT64 seed)
+{
+    return ds_hash64(view.data, view.size, seed);
+}
+
+UINT64 ds_vector_hash64(struct DSVector *vec, UINT64 seed)
+{
+    if (!vec) {
+        return ds_hash64(NULL, 0, seed);
+    }
+    ds_vector_settle(vec);
+    return ds_hash64(vec->data, vec->size, seed);
+}
+
+/*
+ * LZ77 block compression.
+ *
+ * A frame is a header, a run of independent blocks and an end mark:
+ *
+ *   "DSLZ" version:1 flags:1 reserved:2 [content size:8 if flags & 1]
+ *   block*: header:4 (bit 31 set = stored, low 31 bits = payload size)
+ *           raw size:4 payload
+ *   end:    0:4 crc32c of the decompressed content:4
+ *
+ * All integers are little endian. A compressed payload is a list of
+ * sequences: a token (literal length << 4 | match length - 4, each
+ * nibble extended by 255-runs when it is 15), the literals, a 2-byte
+ * match offset and the match length extension. The last sequence of a
+ * block carries literals only.
+ */
+#define DS_LZ_MAGIC          "DSLZ"
+#define DS_LZ_VERSION        1
+#define DS_LZ_FLAG_SIZE      0x1
+#define DS_LZ_HEADER_SIZE    8
+#define DS_LZ_BLOCK_MAX      (1u << 22)
+#define DS_LZ_STORED         0x80000000u
+#define DS_LZ_MIN_MATCH      4
+#define DS_LZ_LAST_LITERALS  5
+#define DS_LZ_WINDOW         65535u
+#define DS_LZ_HASH_LOG_MAX   16
+#define DS_LZ_CHAIN_SIZE     65536u
+#define DS_LZ_LEVEL_MIN      1
+#define DS_LZ_LEVEL_MAX      9
+
+struct DSLzWork {
+    UINT32 *table;
+    UINT16 *chain;
+    UINT32 hash_log;
+};
+
+static void ds_lz_put32(UINT8 *p, UINT32 v)
+{
+    p[0] = (UINT8)v;
+    p[1] = (UINT8)(v >> 8);
+    p[2] = (UINT8)(v >> 16);
+    p[3] = (UINT8)(v >> 24);
+}
+
+static UINT32 ds_lz_get32(const UINT8 *p)
+{
+    return (UINT32)p[0] | (UINT32)p[1] << 8 | (UINT32)p[2] << 16 | (UINT32)p[3] << 24;
+}
+
+/* worst case payload for n input bytes: literals plus one length byte per 255 */
+static UINT32 ds_lz_block_bound(UINT32 n)
+{
+    return n + n / 255 + 16;
+}
+
+/* bytes a whole frame may take for n input bytes: header, blocks with their 8-byte headers, trailer */
+static UINT64 ds_lz_frame_bound(UINT64 n, MYBOOL with_size)
+{
+    UINT64 full = n / DS_LZ_BLOCK_MAX;
+    UINT32 rest = (UINT32)(n % DS_LZ_BLOCK_MAX);
+    return DS_LZ_HEADER_SIZE + (with_size ? 8 : 0) + full * (8 + ds_lz_block_bound(DS_LZ_BLOCK_MAX)) +
+           (rest ? 8 + ds_lz_block_bound(rest) : 0) + 8;
+}
+
+/* levels outside 1..9 are clamped, which keeps the chain depth at 256 or less */
+static INT32 ds_lz_level(INT32 level)
+{
+    return level < DS_LZ_LEVEL_MIN ? DS_LZ_LEVEL_MIN : level > DS_LZ_LEVEL_MAX ? DS_LZ_LEVEL_MAX : level;
+}
+
+static UINT32 ds_lz_hash(UINT32 v, UINT32 hash_log)
+{
+    return (v * 2654435761u) >> (32 - hash_log);
+}
+
+static UINT32 ds_lz_read32(const UINT8 *p)
+{
+    UINT32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static UINT8 *ds_lz_put_length(UINT8 *op, UINT32 len)
+{
+    for (; len >= 255; len -= 255) {
+        *op++ = 255;
+    }
+    *op++ = (UINT8)len;
+    return op;
+}
+
+static UINT8 *ds_lz_put_sequence(UINT8 *op, const UINT8 *literals, UINT32 lit_len, UINT32 offset, UINT32 match_len)
+{
+    UINT8 *token = op++;
+    UINT32 ml = match_len ? match_len - DS_LZ_MIN_MATCH : 0;
+
+    *token = (UINT8)((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15) {
+        op = ds_lz_put_length(op, lit_len - 15);
+    }
+    memcpy(op, literals, lit_len);
+    op += lit_len;
+    if (!match_len) {
+        return op;
+    }
+    *op++ = (UINT8)offset;
+    *op++ = (UINT8)(offset >> 8);
+    *token |= (UINT8)(ml >= 15 ? 15 : ml);
+    if (ml >= 15) {
+        op = ds_lz_put_length(op, ml - 15);
+    }
+    return op;
+}
+
+/*
+ * Greedy parse over one block. Level 1 probes a single hash slot and
+ * skips faster through incompressible input; higher levels follow the
+ * hash chain up to 2^(level - 1) candidates.
+ */
+static UINT32 ds_lz_compress_block(struct DSLzWork *work, const UINT8 *src, UINT32 n, UINT8 *out, INT32 level)
+{
+    UINT32 depth = level <= 1 ? 1 : 1u << (level - 1);
+    UINT32 ip = 0, anchor = 0, limit, h, cand, len, best_len, best_off, tries, delta;
+    UINT8 *op = out;
+
+    if (n < DS_LZ_MIN_MATCH + DS_LZ_LAST_LITERALS) {
+        return (UINT32)(ds_lz_put_sequence(op, src, n, 0, 0) - out);
+    }
+    memset(work->table, 0xFF, sizeof(UINT32) << work->hash_log);
+    limit = n - DS_LZ_LAST_LITERALS;
+
+    while (ip + DS_LZ_MIN_MATCH <= limit) {
+        h = ds_lz_hash(ds_lz_read32(src + ip), work->hash_log);
+        cand = work->table[h];
+        work->table[h] = ip;
+        delta = cand != 0xFFFFFFFFu ? ip - cand : 0;
+        work->chain[ip & (DS_LZ_CHAIN_SIZE - 1)] = (UINT16)(delta <= DS_LZ_WINDOW ? delta : 0);
+
+        best_len = 0;
+        best_off = 0;
+        for (tries = 0; tries < depth && delta && delta <= DS_LZ_WINDOW; ++tries) {
+            cand = ip - delta;
+            if (ds_lz_read32(src + cand) == ds_lz_read32(src + ip)) {
+                len = DS_LZ_MIN_MATCH;
+                while (ip + len < limit && src[cand + len] == src[ip + len]) {
+                    ++len;
+                }
+                if (len > best_len) {
+                    best_len = len;
+                    best_off = delta;
+                }
+            }
+            if (!work->chain[cand & (DS_LZ_CHAIN_SIZE - 1)]) {
+                break;
+            }
+            delta += work->chain[cand & (DS_LZ_CHAIN_SIZE - 1)];
+        }
+
+        if (best_len < DS_LZ_MIN_MATCH) {
+            ip += level <= 1 ? 1 + ((ip - anchor) >> 6) : 1;
+            continue;
+        }
+        op = ds_lz_put_sequence(op, src + anchor, ip - anchor, best_off, best_len);
+        if (level > 1) {
+            for (len = 1; len < best_len && ip + len + DS_LZ_MIN_MATCH <= limit; ++len) {
+                h = ds_lz_hash(ds_lz_read32(src + ip + len), work->hash_log);
+                delta = work->table[h] != 0xFFFFFFFFu ? ip + len - work->table[h] : 0;
+                work->chain[(ip + len) & (DS_LZ_CHAIN_SIZE - 1)] = (UINT16)(delta <= DS_LZ_WINDOW ? delta : 0);
+                work->table[h] = ip + len;
+            }
+        }
+        ip += best_len;
+        anchor = ip;
+    }
+    op = ds_lz_put_sequence(op, src + anchor, n - anchor, 0, 0);
+    return (UINT32)(op - out);
+}
+
+static MYBOOL ds_lz_get_length(const UINT8 **ip, const UINT8 *end, UINT32 *len)
+{
+    UINT32 b;
+    do {
+        if (*ip >= end) {
+            return FALSE;
+        }
+        b = *(*ip)++;
+        if (*len > DS_LZ_BLOCK_MAX) {
+            return FALSE;
+        }
+        *len += b;
+    } while (b == 255);
+    return TRUE;
+}
+
+/* decodes one payload into exactly raw_size bytes at out, FALSE on malformed input */
+static MYBOOL ds_lz_decompress_block(const UINT8 *ip, UINT32 n, UINT8 *out, UINT32 raw_size)
+{
+    const UINT8 *end = ip + n;
+    UINT8 *op = out, *oend = out + raw_size;
+    UINT32 token, lit_len, match_len, offset;
+
+    while (ip < end) {
+        token = *ip++;
+        lit_len = token >> 4;
+        if (lit_len == 15 && !ds_lz_get_length(&ip, end, &lit_len)) {
+            return FALSE;
+        }
+        if (lit_len > (UINT32)(end - ip) || lit_len > (UINT32)(oend - op)) {
+            return FALSE;
+        }
+        if (lit_len <= 16 && end - ip >= 16 && oend - op >= 16) {
+            memcpy(op, ip, 16);
+        } else {
+            memcpy(op, ip, lit_len);
+        }
+        ip += lit_len;
+        op += lit_len;
+        if (ip == end) {
+            break;
+        }
+        if (end - ip < 2) {
+            return FALSE;
+        }
+        offset = ip[0] | (UINT32)ip[1] << 8;
+        ip += 2;
+        match_len = token & 15;
+        if (match_len == 15 && !ds_lz_get_length(&ip, end, &match_len)) {
+            return FALSE;
+        }
+        match_len += DS_LZ_MIN_MATCH;
+        if (offset == 0 || offset > (UINT32)(op - out) || match_len > (UINT32)(oend - op)) {
+            return FALSE;
+        }
+        if (offset >= 8 && (UINT32)(oend - op) >= match_len + 8) {
+            /* 8-byte steps may overrun the match; the slack is rewritten later */
+            const UINT8 *from = op - offset;
+            UINT8 *stop = op + match_len;
+            do {
+                memcpy(op, from, 8);
+                op += 8;
+                from += 8;
+            } while (op < stop);
+            op = stop;
+        } else if (offset >= match_len) {
+            memcpy(op, op - offset, match_len);
+            op += match_len;
+        } else {
+            for (; match_len; --match_len, ++op) {
+                *op = *(op - offset);
+            }
+        }
+    }
+    return op == oend;
+}
+
+static MYBOOL ds_lz_work_init(struct DSLzWork *work, UINT32 n)
+{
+    work->hash_log = 10;
+    while (work->hash_log < DS_LZ_HASH_LOG_MAX && (1u << work->hash_log) < n) {
+        ++work->hash_log;
+    }
+    work->table = (UINT32 *)malloc(sizeof(UINT32) << work->hash_log);
+    work->chain = (UINT16 *)malloc(sizeof(UINT16) * DS_LZ_CHAIN_SIZE);
+    if (!work->table || !work->chain) {
+        free(work->table);
+        free(work->chain);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void ds_lz_work_free(struct DSLzWork *work)
+{
+    free(work->table);
+    free(work->chain);
+}
+
+/* compresses data into blocks written at out, returns the bytes written */
+static DSSize ds_lz_put_blocks(struct DSLzWork *work, const UINT8 *data, DSSize length, UINT8 *out, INT32 level)
+{
+    UINT8 *op = out;
+    UINT32 chunk, packed;
+
+    while (length > 0) {
+        chunk = length < DS_LZ_BLOCK_MAX ? (UINT32)length : DS_LZ_BLOCK_MAX;
+        packed = ds_lz_compress_block(work, data, chunk, op + 8, level);
+        if (packed >= chunk) {
+            memcpy(op + 8, data, chunk);
+            packed = chunk;
+            ds_lz_put32(op, chunk | DS_LZ_STORED);
+        } else {
+            ds_lz_put32(op, packed);
+        }
+        ds_lz_put32(op + 4, chunk);
+        op += 8 + packed;
+        data += chunk;
+        length -= chunk;
+    }
+    return (DSSize)(op - out);
+}
+
+static UINT8 *ds_lz_put_header(UINT8 *op, MYBOOL with_size, UINT64 content_size)
+{
+    UINT32 i;
+    memcpy(op, DS_LZ_MAGIC, 4);
+    op[4] = DS_LZ_VERSION;
+    op[5] = with_size ? DS_LZ_FLAG_SIZE : 0;
+    op[6] = 0;
+    op[7] = 0;
+    op += DS_LZ_HEADER_SIZE;
+    if (with_size) {
+        for (i = 0; i < 8; ++i) {
+            *op++ = (UINT8)(content_size >> (8 * i));
+        }
+    }
+    return op;
+}
+
+/* private function to reserve room for length more bytes, TRUE if the result fits in a DSSize */
+static MYBOOL ds_vector_reserve_more(struct DSVector *vec, UINT64 length)
+{
+    if (length > (UINT64)(DS_SIZE_MAX - vec->size - 1)) {
+        return FALSE;
+    }
+    return ds_vector_maybe_expand(vec, (DSSize)length);
+}
+
+DSSize ds_vector_compress(struct DSVector *dst, struct DSVector *src, INT32 level)
+{
+    struct DSLzWork work;
+    DSSize old_size;
+    UINT8 *op;
+
+    if (!dst || !src || dst == src) {
+        return 0;
+    }
+    ds_vector_settle(src);
+    if (!ds_vector_reserve_more(dst, ds_lz_frame_bound(src->size, TRUE))) {
+        return 0;
+    }
+    if (!ds_lz_work_init(&work, src->size < DS_LZ_BLOCK_MAX ? (UINT32)src->size : DS_LZ_BLOCK_MAX)) {
+        return 0;
+    }
+    old_size = dst->size;
+    op = ds_lz_put_header(dst->data + dst->size, TRUE, src->size);
+    op += ds_lz_put_blocks(&work, src->data, src->size, op, ds_lz_level(level));
+    ds_lz_put32(op, 0);
+    ds_lz_put32(op + 4, ds_crc32c_update(0, src->data, src->size));
+    op += 8;
+    ds_lz_work_free(&work);
+
+    dst->size = (DSSize)(op - dst->data);
+    ds_vector_appended(dst, old_size);
+    return dst->size - old_size;
+}
+
+UINT32 ds_vector_compress_begin(struct DSCompressStream *stream, struct DSVector *dst, INT32 level)
+{
+    DSSize old_size;
+
+    if (!stream || !dst || !ds_vector_maybe_expand(dst, DS_LZ_HEADER_SIZE)) {
+        return 0;
+    }
+    stream->level = ds_lz_level(level);
+    stream->crc = 0;
+    stream->raw_size = 0;
+    old_size = dst->size;
+    dst->size = (DSSize)(ds_lz_put_header(dst->data + dst->size, FALSE, 0) - dst->data);
+    ds_vector_appended(dst, old_size);
+    return DS_LZ_HEADER_SIZE;
+}
+
+UINT32 ds_vector_compress_write(struct DSCompressStream *stream, struct DSVector *dst, const UINT8 *data, UINT32 length)
+{
+    struct DSLzWork work;
+    DSSize old_size;
+
+    if (!stream || !dst || !data || length == 0) {
+        return 0;
+    }
+    if (!ds_vector_reserve_more(dst, ds_lz_frame_bound(length, FALSE) - DS_LZ_HEADER_SIZE)) {
+        return 0;
+    }
+    if (!ds_lz_work_init(&work, length < DS_LZ_BLOCK_MAX ? length : DS_LZ_BLOCK_MAX)) {
+        return 0;
+    }
+    old_size = dst->size;
+    dst->size += ds_lz_put_blocks(&work, data, length, dst->data + dst->size, stream->level);
+    ds_lz_work_free(&work);
+    stream->crc = ds_crc32c_update(stream->crc, data, length);
+    stream->raw_size += length;
+    ds_vector_appended(dst, old_size);
+    return (UINT32)(dst->size - old_size);
+}
+
+UINT32 ds_vector_compress_end(struct DSCompressStream *stream, struct DSVector *dst)
+{
+    DSSize old_size;
+
+    if (!stream || !dst || !ds_vector_maybe_expand(dst, 8)) {
+        return 0;
+    }
+    old_size = dst->size;
+    ds_lz_put32(dst->data + dst->size, 0);
+    ds_lz_put32(dst->data + dst->size + 4, stream->crc);
+    dst->size += 8;
+    ds_vector_appended(dst, old_size);
+    return 8;
+}
+
+/*
+ * Walks the block headers of a frame without decoding anything.
+ * Sets the decompressed size and the offset of the first block header.
+ */
+static MYBOOL ds_lz_scan_frame(const UINT8 *data, DSSize size, UINT64 *raw_size, DSSize *first_block)
+{
+    DSSize pos = DS_LZ_HEADER_SIZE;
+    UINT32 header, payload, raw, i;
+    UINT64 total = 0, declared = 0;
+
+    if (size < DS_LZ_HEADER_SIZE || memcmp(data, DS_LZ_MAGIC, 4) != 0 || data[4] != DS_LZ_VERSION) {
+        return FALSE;
+    }
+    if (data[5] & DS_LZ_FLAG_SIZE) {
+        if (size < pos + 8) {
+            return FALSE;
+        }
+        for (i = 0; i < 8; ++i) {
+            declared |= (UINT64)data[pos + i] << (8 * i);
+        }
+        pos += 8;
+    }
+    *first_block = pos;
+    for (;;) {
+        if (size - pos < 4) {
+            return FALSE;
+        }
+        header = ds_lz_get32(data + pos);
+        if (header == 0) {
+            break;
+        }
+        payload = header & ~DS_LZ_STORED;
+        if (size - pos < 8 || payload > size - pos - 8) {
+            return FALSE;
+        }
+        raw = ds_lz_get32(data + pos + 4);
+        if (raw > DS_LZ_BLOCK_MAX || (header & DS_LZ_STORED ? raw != payload : raw > (UINT64)payload * 255)) {
+            return FALSE;
+        }
+        total += raw;
+        pos += 8 + payload;
+    }
+    if (size - pos < 8 || ((data[5] & DS_LZ_FLAG_SIZE) && declared != total)) {
+        return FALSE;
+    }
+    *raw_size = total;
+    return TRUE;
+}
+
+DSSize ds_vector_decompress(struct DSVector *dst, struct DSVector *src)
 {
-    UINT8* new_data = NULL;
-    if (vec->size  + length < vec->capacity)
-        return TRUE;
+    UINT64 raw_size;
+    DSSize pos, old_size;
+    UINT32 header, payload, raw;
+    UINT8 *op;
 
-    vec->capacity = (INT32)(vec->capacity * DS_VECTOR_EXPAND_RATIO + length);
-    new_data = (UINT8 *)realloc(vec->data, vec->capacity * sizeof(vec->data));
-    if (!new_data) {
-        return FALSE;
+    if (!dst || !src || dst == src) {
+        return 0;
+    }
+    ds_vector_settle(src);
+    if (!ds_lz_scan_frame(src->data, src->size, &raw_size, &pos)) {
+        return 0;
+    }
+    if (!ds_vector_reserve_more(dst, raw_size)) {
+        return 0;
     }
+    old_size = dst->size;
+    op = dst->data + dst->size;
+    while ((header = ds_lz_get32(src->data + pos)) != 0) {
+        payload = header & ~DS_LZ_STORED;
+        raw = ds_lz_get32(src->data + pos + 4);
+        if (header & DS_LZ_STORED) {
+            memcpy(op, src->data + pos + 8, raw);
+        } else if (!ds_lz_decompress_block(src->data + pos + 8, payload, op, raw)) {
+            return 0;
+        }
+        op += raw;
+        pos += 8 + payload;
+    }
+    if (ds_crc32c_update(0, dst->data + old_size, (DSSize)raw_size) != ds_lz_get32(src->data + pos + 4)) {
+        return 0;
+    }
+    dst->size += (DSSize)raw_size;
+    ds_vector_appended(dst, old_size);
+    return (DSSize)raw_size;
+}
 
-    vec->data = new_data;
+/*
+ * Hex and base64 encoders/decoders. Each call computes its output size
+ * first and reserves once; the kernels then write straight into the
+ * vector. SIMD kernels may store up to DS_CODEC_SLACK bytes past the
+ * output, so that much extra room is reserved as well.
+ */
+#define DS_CODEC_SLACK 32
+
+/* returned by the SIMD decoders on an invalid character */
+#define DS_CODEC_BAD 0xFFFFFFFFu
+
+static const char ds_hex_digits[] = "0123456789abcdef";
+static const char ds_base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void ds_hex_encode_scalar(UINT8 *out, const UINT8 *data, UINT32 length)
+{
+    UINT32 i;
+    for (i = 0; i < length; ++i) {
+        out[2 * i] = ds_hex_digits[data[i] >> 4];
+        out[2 * i + 1] = ds_hex_digits[data[i] & 0x0F];
+    }
+}
+
+static INT32 ds_hex_value(UINT8 c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+static MYBOOL ds_hex_decode_scalar(UINT8 *out, const UINT8 *text, UINT32 pairs)
+{
+    UINT32 i;
+    INT32 hi, lo;
+    for (i = 0; i < pairs; ++i) {
+        hi = ds_hex_value(text[2 * i]);
+        lo = ds_hex_value(text[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return FALSE;
+        }
+        out[i] = (UINT8)(hi << 4 | lo);
+    }
     return TRUE;
 }
 
-struct DSVector *ds_vector_create(UINT32 capacity, float expand_ratio)
+static void ds_base64_encode_scalar(UINT8 *out, const UINT8 *data, UINT32 length)
 {
-    struct DSVector *vec = NULL;
-    vec = (struct DSVector *)malloc(sizeof(*vec));
-    if (!vec) {
-        return NULL;
+    UINT32 i, v;
+    for (i = 0; i + 3 <= length; i += 3, out += 4) {
+        v = (UINT32)data[i] << 16 | (UINT32)data[i + 1] << 8 | data[i + 2];
+        out[0] = ds_base64_alphabet[v >> 18];
+        out[1] = ds_base64_alphabet[(v >> 12) & 0x3F];
+        out[2] = ds_base64_alphabet[(v >> 6) & 0x3F];
+        out[3] = ds_base64_alphabet[v & 0x3F];
     }
-    vec->size = 0;
-    vec->capacity = capacity;
-    DS_VECTOR_BASE_CAPACITY = capacity;
-    DS_VECTOR_EXPAND_RATIO = expand_ratio;
-    vec->data = (UINT8 *)malloc(vec->capacity * sizeof(UINT8));
-    if (!vec->data) {
-        free(vec);
-        return NULL;
+    if (i < length) {
+        v = (UINT32)data[i] << 16 | (i + 1 < length ? (UINT32)data[i + 1] << 8 : 0);
+        out[0] = ds_base64_alphabet[v >> 18];
+        out[1] = ds_base64_alphabet[(v >> 12) & 0x3F];
+        out[2] = i + 1 < length ? ds_base64_alphabet[(v >> 6) & 0x3F] : '=';
+        out[3] = '=';
     }
+}
 
-    return vec;
+/* 6-bit value of every character, 0xFF for characters outside the alphabet */
+static const UINT8 ds_base64_table[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+/* decodes quads of unpadded characters, 3 bytes each */
+static MYBOOL ds_base64_decode_scalar(UINT8 *out, const UINT8 *text, UINT32 quads)
+{
+    const UINT8 *values = ds_base64_table;
+    UINT32 i, a, b, c, d;
+    for (i = 0; i < quads; ++i, text += 4, out += 3) {
+        a = values[text[0]];
+        b = values[text[1]];
+        c = values[text[2]];
+        d = values[text[3]];
+        if ((a | b | c | d) & 0x80) {
+            return FALSE;
+        }
+        out[0] = (UINT8)(a << 2 | b >> 4);
+        out[1] = (UINT8)(b << 4 | c >> 2);
+        out[2] = (UINT8)(c << 6 | d);
+    }
+    return TRUE;
 }
 
-struct DSVector *ds_vector_create_capacity(UINT32 capacity)
+#ifdef DS_VECTOR_X86
+DS_TARGET("ssse3")
+static UINT32 ds_hex_encode_ssse3(UINT8 *out, const UINT8 *data, UINT32 length)
 {
-    return ds_vector_create(capacity, DS_VECTOR_EXPAND_RATIO);
+    __m128i digits = _mm_loadu_si128((const __m128i *)ds_hex_digits);
+    __m128i low4 = _mm_set1_epi8(0x0F);
+    UINT32 i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), low4));
+        __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(v, low4));
+        _mm_storeu_si128((__m128i *)(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *)(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return i;
 }
 
-void ds_vector_free(struct DSVector *vec)
+DS_TARGET("avx2")
+static UINT32 ds_hex_encode_avx2(UINT8 *out, const UINT8 *data, UINT32 length)
 {
-    if (!vec) {
-        return;
+    __m256i digits = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)ds_hex_digits));
+    __m256i low4 = _mm256_set1_epi8(0x0F);
+    UINT32 i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i hi = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(v, 4), low4));
+        __m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(v, low4));
+        __m256i a = _mm256_unpacklo_epi8(hi, lo);
+        __m256i b = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i *)(out + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i *)(out + 2 * i + 32), _mm256_permute2x128_si256(a, b, 0x31));
     }
+    return i;
+}
 
-    free(vec->data);
-    free(vec);
+/* maps 16 hex characters to nibble values, sets *bad when any is not a hex digit */
+DS_TARGET("ssse3")
+static __m128i ds_hex_nibbles_ssse3(__m128i v, int *bad)
+{
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i l = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    __m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(5)), l);
+
+    *bad |= _mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha)) ^ 0xFFFF;
+    return _mm_or_si128(_mm_and_si128(is_digit, d),
+                        _mm_and_si128(is_alpha, _mm_add_epi8(l, _mm_set1_epi8(10))));
 }
 
-UINT32 ds_vector_append(struct DSVector *vec, UINT8* data, UINT32 length)
+/* returns the pairs decoded, or DS_CODEC_BAD on an invalid character */
+DS_TARGET("ssse3")
+static UINT32 ds_hex_decode_ssse3(UINT8 *out, const UINT8 *text, UINT32 pairs)
 {
+    __m128i weights = _mm_set1_epi16(0x0110);
     UINT32 i = 0;
-    if (!vec || !data || length <= 0) {
+    int bad = 0;
+
+    for (; i + 16 <= pairs; i += 16) {
+        __m128i a = ds_hex_nibbles_ssse3(_mm_loadu_si128((const __m128i *)(text + 2 * i)), &bad);
+        __m128i b = ds_hex_nibbles_ssse3(_mm_loadu_si128((const __m128i *)(text + 2 * i + 16)), &bad);
+        if (bad) {
+            return DS_CODEC_BAD;
+        }
+        _mm_storeu_si128((__m128i *)(out + i),
+                         _mm_packus_epi16(_mm_maddubs_epi16(a, weights), _mm_maddubs_epi16(b, weights)));
+    }
+    return i;
+}
+
+DS_TARGET("avx2")
+static __m256i ds_hex_nibbles_avx2(__m256i v, UINT32 *bad)
+{
+    __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+    __m256i l = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+    __m256i is_alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(l, _mm256_set1_epi8(5)), l);
+
+    *bad |= ~(UINT32)_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_alpha));
+    return _mm256_or_si256(_mm256_and_si256(is_digit, d),
+                           _mm256_and_si256(is_alpha, _mm256_add_epi8(l, _mm256_set1_epi8(10))));
+}
+
+DS_TARGET("avx2")
+static UINT32 ds_hex_decode_avx2(UINT8 *out, const UINT8 *text, UINT32 pairs)
+{
+    __m256i weights = _mm256_set1_epi16(0x0110);
+    UINT32 i = 0, bad = 0;
+
+    for (; i + 32 <= pairs; i += 32) {
+        __m256i a = ds_hex_nibbles_avx2(_mm256_loadu_si256((const __m256i *)(text + 2 * i)), &bad);
+        __m256i b = ds_hex_nibbles_avx2(_mm256_loadu_si256((const __m256i *)(text + 2 * i + 32)), &bad);
+        if (bad) {
+            return DS_CODEC_BAD;
+        }
+        a = _mm256_packus_epi16(_mm256_maddubs_epi16(a, weights), _mm256_maddubs_epi16(b, weights));
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_permute4x64_epi64(a, 0xD8));
+    }
+    return i;
+}
+
+/*
+ * Base64 kernels after Wojciech Mula's pshufb method: bytes are spread
+ * into 6-bit indices with multiplies, and a 16-entry offset table maps
+ * index ranges to ASCII (and back when decoding).
+ */
+DS_TARGET("ssse3")
+static __m128i ds_base64_indices_ssse3(__m128i in)
+{
+    __m128i t0, t1, t2, t3;
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    t0 = _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00));
+    t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    t2 = _mm_and_si128(in, _mm_set1_epi32(0x003F03F0));
+    t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+DS_TARGET("ssse3")
+static __m128i ds_base64_ascii_ssse3(__m128i indices)
+{
+    __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                  '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    __m128i r = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    r = _mm_or_si128(r, _mm_and_si128(less, _mm_set1_epi8(13)));
+    return _mm_add_epi8(_mm_shuffle_epi8(shift, r), indices);
+}
+
+/* encodes 12-byte groups while 16 input bytes are readable, returns bytes consumed */
+DS_TARGET("ssse3")
+static UINT32 ds_base64_encode_ssse3(UINT8 *out, const UINT8 *data, UINT32 length)
+{
+    UINT32 i = 0;
+    for (; i + 16 <= length; i += 12, out += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i *)(data + i));
+        _mm_storeu_si128((__m128i *)out, ds_base64_ascii_ssse3(ds_base64_indices_ssse3(in)));
+    }
+    return i;
+}
+
+DS_TARGET("avx2")
+static UINT32 ds_base64_encode_avx2(UINT8 *out, const UINT8 *data, UINT32 length)
+{
+    __m256i spread = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                     10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    __m256i shift = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                     '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                     'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                     '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    UINT32 i = 0;
+
+    for (; i + 28 <= length; i += 24, out += 32) {
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(data + i))),
+                                             _mm_loadu_si128((const __m128i *)(data + i + 12)), 1);
+        __m256i t0, t1, t2, t3, idx, r;
+        in = _mm256_shuffle_epi8(in, spread);
+        t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00));
+        t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0));
+        t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        idx = _mm256_or_si256(t1, t3);
+        r = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+        r = _mm256_or_si256(r, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx), _mm256_set1_epi8(13)));
+        _mm256_storeu_si256((__m256i *)out, _mm256_add_epi8(_mm256_shuffle_epi8(shift, r), idx));
+    }
+    return i;
+}
+
+/* maps 16 base64 characters to 6-bit values packed into 12 bytes at out */
+DS_TARGET("ssse3")
+static MYBOOL ds_base64_decode16_ssse3(UINT8 *out, __m128i in)
+{
+    __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                   0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                   0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i low4 = _mm_set1_epi8(0x0F);
+    __m128i hi_nibble = _mm_and_si128(_mm_srli_epi32(in, 4), low4);
+    __m128i lo = _mm_shuffle_epi8(lut_lo, _mm_and_si128(in, low4));
+    __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibble);
+    __m128i roll, merged;
+
+    if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128()))) {
+        return FALSE;
+    }
+    roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(_mm_cmpeq_epi8(in, _mm_set1_epi8('/')), hi_nibble));
+    in = _mm_add_epi8(in, roll);
+    merged = _mm_maddubs_epi16(in, _mm_set1_epi32(0x01400140));
+    merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    merged = _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128((__m128i *)out, merged);
+    return TRUE;
+}
+
+/* returns the quads decoded, or DS_CODEC_BAD on an invalid character */
+DS_TARGET("ssse3")
+static UINT32 ds_base64_decode_ssse3(UINT8 *out, const UINT8 *text, UINT32 quads)
+{
+    UINT32 i = 0;
+    for (; i + 4 <= quads; i += 4, text += 16, out += 12) {
+        if (!ds_base64_decode16_ssse3(out, _mm_loadu_si128((const __m128i *)text))) {
+            return DS_CODEC_BAD;
+        }
+    }
+    return i;
+}
+
+DS_TARGET("avx2")
+static UINT32 ds_base64_decode_avx2(UINT8 *out, const UINT8 *text, UINT32 quads)
+{
+    __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    __m256i low4 = _mm256_set1_epi8(0x0F);
+    UINT32 i = 0;
+
+    for (; i + 8 <= quads; i += 8, text += 32, out += 24) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)text);
+        __m256i hi_nibble = _mm256_and_si256(_mm256_srli_epi32(in, 4), low4);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, _mm256_and_si256(in, low4));
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibble);
+        __m256i merged;
+
+        if (_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256()))) {
+            return DS_CODEC_BAD;
+        }
+        in = _mm256_add_epi8(in, _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(_mm256_cmpeq_epi8(in, _mm256_set1_epi8('/')), hi_nibble)));
+        merged = _mm256_maddubs_epi16(in, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, pack);
+        merged = _mm256_permutevar8x32_epi32(merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+        _mm256_storeu_si256((__m256i *)out, merged);
+    }
+    return i;
+}
+#endif
+
+UINT32 ds_vector_append_hex(struct DSVector *vec, const UINT8 *data, UINT32 length)
+{
+    UINT32 done = 0;
+    DSSize old_size;
+    UINT8 *out;
+
+    if (!vec || !data || length == 0 || length > 0x7FFFFFFFu) {
+        return 0;
+    }
+    if (!ds_vector_reserve_more(vec, (UINT64)length * 2 + DS_CODEC_SLACK)) {
         return 0;
     }
+    out = vec->data + vec->size;
+#ifdef DS_VECTOR_X86
+    if (ds_vector_isa() >= DS_ISA_AVX2) {
+        done = ds_hex_encode_avx2(out, data, length);
+    } else if (ds_vector_isa() >= DS_ISA_SSSE3) {
+        done = ds_hex_encode_ssse3(out, data, length);
+    }
+#endif
+    ds_hex_encode_scalar(out + 2 * done, data + done, length - done);
+    old_size = vec->size;
+    vec->size += length * 2;
+    ds_vector_appended(vec, old_size);
+    return length * 2;
+}
 
-    if (!ds_vector_maybe_expand(vec, length)) {
+UINT32 ds_vector_decode_hex(struct DSVector *vec, const UINT8 *text, UINT32 length)
+{
+    UINT32 pairs = length / 2, done = 0;
+    DSSize old_size;
+    UINT8 *out;
+
+    if (!vec || !text || length == 0 || length % 2) {
         return 0;
     }
-    for (; i < length; ++i) {
-        vec->data[vec->size++] = data[i];
+    if (!ds_vector_reserve_more(vec, pairs + DS_CODEC_SLACK)) {
+        return 0;
     }
-    return length;
+    out = vec->data + vec->size;
+#ifdef DS_VECTOR_X86
+    if (ds_vector_isa() >= DS_ISA_AVX2) {
+        done = ds_hex_decode_avx2(out, text, pairs);
+    } else if (ds_vector_isa() >= DS_ISA_SSSE3) {
+        done = ds_hex_decode_ssse3(out, text, pairs);
+    }
+#endif
+    if (done == DS_CODEC_BAD || !ds_hex_decode_scalar(out + done, text + 2 * done, pairs - done)) {
+        return 0;
+    }
+    old_size = vec->size;
+    vec->size += pairs;
+    ds_vector_appended(vec, old_size);
+    return pairs;
 }
 
-UINT32 ds_vector_insert(struct DSVector *vec, UINT32 index, UINT8* data, UINT32 length)
+UINT32 ds_vector_append_base64(struct DSVector *vec, const UINT8 *data, UINT32 length)
 {
-    UINT32 i;
+    UINT32 out_len, done = 0;
+    DSSize old_size;
+    UINT8 *out;
 
-    if (!vec || !data|| index > vec->size) {
+    if (!vec || !data || length == 0 || length > 0xBFFFFFFDu) {
+        return 0;
+    }
+    out_len = (UINT32)(((UINT64)length + 2) / 3 * 4);
+    if (!ds_vector_reserve_more(vec, (UINT64)out_len + DS_CODEC_SLACK)) {
         return 0;
     }
+    out = vec->data + vec->size;
+#ifdef DS_VECTOR_X86
+    if (ds_vector_isa() >= DS_ISA_AVX2) {
+        done = ds_base64_encode_avx2(out, data, length);
+    }
+    if (ds_vector_isa() >= DS_ISA_SSSE3) {
+        done += ds_base64_encode_ssse3(out + done / 3 * 4, data + done, length - done);
+    }
+#endif
+    ds_base64_encode_scalar(out + done / 3 * 4, data + done, length - done);
+    old_size = vec->size;
+    vec->size += out_len;
+    ds_vector_appended(vec, old_size);
+    return out_len;
+}
 
-    if (!ds_vector_maybe_expand(vec, length)) {
+UINT32 ds_vector_decode_base64(struct DSVector *vec, const UINT8 *text, UINT32 length)
+{
+    UINT32 quads, pad = 0, out_len, done = 0;
+    DSSize old_size;
+    UINT8 tail[4];
+    UINT8 *out;
+
+    if (!vec || !text || length == 0 || length % 4) {
+        return 0;
+    }
+    if (text[length - 1] == '=') {
+        pad = text[length - 2] == '=' ? 2 : 1;
+    }
+    quads = length / 4 - (pad ? 1 : 0);
+    out_len = length / 4 * 3 - pad;
+    if (!ds_vector_reserve_more(vec, (UINT64)out_len + DS_CODEC_SLACK)) {
         return 0;
     }
+    out = vec->data + vec->size;
+#ifdef DS_VECTOR_X86
+    if (ds_vector_isa() >= DS_ISA_AVX2) {
+        done = ds_base64_decode_avx2(out, text, quads);
+    }
+    if (done != DS_CODEC_BAD && ds_vector_isa() >= DS_ISA_SSSE3) {
+        UINT32 more = ds_base64_decode_ssse3(out + done * 3, text + done * 4, quads - done);
+        done = more == DS_CODEC_BAD ? more : done + more;
+    }
+#endif
+    if (done == DS_CODEC_BAD || !ds_base64_decode_scalar(out + done * 3, text + done * 4, quads - done)) {
+        return 0;
+    }
+    if (pad) {
+        memcpy(tail, text + length - 4, 4);
+        tail[3] = 'A';
+        if (pad == 2) {
+            tail[2] = 'A';
+        }
+        if (!ds_base64_decode_scalar(tail, tail, 1)) {
+            return 0;
+        }
+        memcpy(out + quads * 3, tail, 3 - pad);
+    }
+    old_size = vec->size;
+    vec->size += out_len;
+    ds_vector_appended(vec, old_size);
+    return out_len;
+}
+
+/*
+ * Sorting. Integer keys use an LSD radix sort, one pass per key byte,
+ * skipping bytes that are equal in every key. Custom comparators use a
+ * pattern-defeating quicksort: median-of-3 / ninther pivots, detection
+ * of already partitioned ranges, shuffling after bad partitions and a
+ * heapsort fallback that bounds the worst case to O(n log n).
+ */
+#define DS_SORT_INSERTION_MAX 24
+#define DS_SORT_NINTHER_MIN   128
+#define DS_SORT_PARTIAL_LIMIT 8
+#define DS_RADIX_MIN          256
+
+struct DSSortCtx {
+    UINT8 *base;
+    size_t es;
+    DSCompare cmp;
+    void *arg;
+};
+
+#define DS_SORT_AT(ctx, i) ((ctx)->base + (size_t)(i) * (ctx)->es)
+
+static MYBOOL ds_sort_less(struct DSSortCtx *ctx, UINT32 a, UINT32 b)
+{
+    return ctx->cmp(DS_SORT_AT(ctx, a), DS_SORT_AT(ctx, b), ctx->arg) < 0;
+}
+
+static void ds_sort_swap(struct DSSortCtx *ctx, UINT32 a, UINT32 b)
+{
+    UINT8 tmp[64], *pa = DS_SORT_AT(ctx, a), *pb = DS_SORT_AT(ctx, b);
+    size_t left = ctx->es, step;
+
+    if (left == sizeof(UINT64)) {
+        memcpy(tmp, pa, sizeof(UINT64));
+        memcpy(pa, pb, sizeof(UINT64));
+        memcpy(pb, tmp, sizeof(UINT64));
+        return;
+    }
+    if (left == sizeof(UINT32)) {
+        memcpy(tmp, pa, sizeof(UINT32));
+        memcpy(pa, pb, sizeof(UINT32));
+        memcpy(pb, tmp, sizeof(UINT32));
+        return;
+    }
+    while (left > 0) {
+        step = left < sizeof(tmp) ? left : sizeof(tmp);
+        memcpy(tmp, pa, step);
+        memcpy(pa, pb, step);
+        memcpy(pb, tmp, step);
+        pa += step;
+        pb += step;
+        left -= step;
+    }
+}
 
-    for (i = vec->size - 1; i >= index && i < (i + 1); --i) {
-        vec->data[i + length] = vec->data[i];
+static void ds_sort_insertion(struct DSSortCtx *ctx, UINT32 begin, UINT32 end)
+{
+    UINT32 i, j;
+    for (i = begin + 1; i < end; ++i) {
+        for (j = i; j > begin && ds_sort_less(ctx, j, j - 1); --j) {
+            ds_sort_swap(ctx, j, j - 1);
+        }
     }
+}
 
-    for (i = 0; i < length; ++i) {
-        vec->data[index + i] = data[i];
-        ++vec->size;
+/* insertion sort that gives up after DS_SORT_PARTIAL_LIMIT moves */
+static MYBOOL ds_sort_partial_insertion(struct DSSortCtx *ctx, UINT32 begin, UINT32 end)
+{
+    UINT32 i, j, moves = 0;
+    for (i = begin + 1; i < end; ++i) {
+        for (j = i; j > begin && ds_sort_less(ctx, j, j - 1); --j) {
+            ds_sort_swap(ctx, j, j - 1);
+            ++moves;
+        }
+        if (moves > DS_SORT_PARTIAL_LIMIT) {
+            return FALSE;
+        }
     }
+    return TRUE;
+}
 
-    return length;
+static void ds_sort2(struct DSSortCtx *ctx, UINT32 a, UINT32 b)
+{
+    if (ds_sort_less(ctx, b, a)) {
+        ds_sort_swap(ctx, a, b);
+    }
 }
 
-UINT32 ds_vector_concat(struct DSVector *dest, struct DSVector *src) {
-    if (!dest || !src) {
+static void ds_sort3(struct DSSortCtx *ctx, UINT32 a, UINT32 b, UINT32 c)
+{
+    ds_sort2(ctx, a, b);
+    ds_sort2(ctx, b, c);
+    ds_sort2(ctx, a, b);
+}
+
+static void ds_sort_sift_down(struct DSSortCtx *ctx, UINT32 begin, UINT32 root, UINT32 n)
+{
+    UINT32 child;
+    while ((child = 2 * root + 1) < n) {
+        if (child + 1 < n && ds_sort_less(ctx, begin + child, begin + child + 1)) {
+            ++child;
+        }
+        if (!ds_sort_less(ctx, begin + root, begin + child)) {
+            return;
+        }
+        ds_sort_swap(ctx, begin + root, begin + child);
+        root = child;
+    }
+}
+
+static void ds_sort_heap(struct DSSortCtx *ctx, UINT32 begin, UINT32 end)
+{
+    UINT32 n = end - begin, i;
+    for (i = n / 2; i-- > 0;) {
+        ds_sort_sift_down(ctx, begin, i, n);
+    }
+    for (i = n - 1; i > 0; --i) {
+        ds_sort_swap(ctx, begin, begin + i);
+        ds_sort_sift_down(ctx, begin, 0, i);
+    }
+}
+
+/*
+ * Partitions [begin, end) around the pivot at begin: smaller elements
+ * to the left, the rest to the right. Returns the final pivot position
+ * and whether no element had to move.
+ */
+static UINT32 ds_sort_partition_right(struct DSSortCtx *ctx, UINT32 begin, UINT32 end, MYBOOL *already)
+{
+    UINT32 first = begin, last = end;
+
+    while (ds_sort_less(ctx, ++first, begin)) {
+    }
+    if (first - 1 == begin) {
+        while (first < last && !ds_sort_less(ctx, --last, begin)) {
+        }
+    } else {
+        while (!ds_sort_less(ctx, --last, begin)) {
+        }
+    }
+    *already = first >= last;
+    while (first < last) {
+        ds_sort_swap(ctx, first, last);
+        while (ds_sort_less(ctx, ++first, begin)) {
+        }
+        while (!ds_sort_less(ctx, --last, begin)) {
+        }
+    }
+    ds_sort_swap(ctx, begin, first - 1);
+    return first - 1;
+}
+
+/* like partition_right, but elements equal to the pivot go left */
+static UINT32 ds_sort_partition_left(struct DSSortCtx *ctx, UINT32 begin, UINT32 end)
+{
+    UINT32 first = begin, last = end;
+
+    while (ds_sort_less(ctx, begin, --last)) {
+    }
+    if (last + 1 == end) {
+        while (first < last && !ds_sort_less(ctx, begin, ++first)) {
+        }
+    } else {
+        while (!ds_sort_less(ctx, begin, ++first)) {
+        }
+    }
+    while (first < last) {
+        ds_sort_swap(ctx, first, last);
+        while (ds_sort_less(ctx, begin, --last)) {
+        }
+        while (!ds_sort_less(ctx, begin, ++first)) {
+        }
+    }
+    ds_sort_swap(ctx, begin, last);
+    return last;
+}
+
+static void ds_pdqsort(struct DSSortCtx *ctx, UINT32 begin, UINT32 end, INT32 bad_allowed, MYBOOL leftmost)
+{
+    UINT32 size, half, pivot, l_size, r_size;
+    MYBOOL already;
+
+    for (;;) {
+        size = end - begin;
+        if (size < DS_SORT_INSERTION_MAX) {
+            ds_sort_insertion(ctx, begin, end);
+            return;
+        }
+
+        half = size / 2;
+        if (size > DS_SORT_NINTHER_MIN) {
+            ds_sort3(ctx, begin, begin + half, end - 1);
+            ds_sort3(ctx, begin + 1, begin + half - 1, end - 2);
+            ds_sort3(ctx, begin + 2, begin + half + 1, end - 3);
+            ds_sort3(ctx, begin + half - 1, begin + half, begin + half + 1);
+            ds_sort_swap(ctx, begin, begin + half);
+        } else {
+            ds_sort3(ctx, begin + half, begin, end - 1);
+        }
+
+        /* pivot equal to the predecessor: everything equal to it is already in place */
+        if (!leftmost && !ds_sort_less(ctx, begin - 1, begin)) {
+            begin = ds_sort_partition_left(ctx, begin, end) + 1;
+            continue;
+        }
+
+        pivot = ds_sort_partition_right(ctx, begin, end, &already);
+        l_size = pivot - begin;
+        r_size = end - (pivot + 1);
+
+        if (l_size < size / 8 || r_size < size / 8) {
+            if (--bad_allowed == 0) {
+                ds_sort_heap(ctx, begin, end);
+                return;
+            }
+            if (l_size >= DS_SORT_INSERTION_MAX) {
+                ds_sort_swap(ctx, begin, begin + l_size / 4);
+                ds_sort_swap(ctx, pivot - 1, pivot - l_size / 4);
+                if (l_size > DS_SORT_NINTHER_MIN) {
+                    ds_sort_swap(ctx, begin + 1, begin + (l_size / 4 + 1));
+                    ds_sort_swap(ctx, begin + 2, begin + (l_size / 4 + 2));
+                    ds_sort_swap(ctx, pivot - 2, pivot - (l_size / 4 + 1));
+                    ds_sort_swap(ctx, pivot - 3, pivot - (l_size / 4 + 2));
+                }
+            }
+            if (r_size >= DS_SORT_INSERTION_MAX) {
+                ds_sort_swap(ctx, pivot + 1, pivot + (1 + r_size / 4));
+                ds_sort_swap(ctx, end - 1, end - r_size / 4);
+                if (r_size > DS_SORT_NINTHER_MIN) {
+                    ds_sort_swap(ctx, pivot + 2, pivot + (2 + r_size / 4));
+                    ds_sort_swap(ctx, pivot + 3, pivot + (3 + r_size / 4));
+                    ds_sort_swap(ctx, end - 2, end - (1 + r_size / 4));
+                    ds_sort_swap(ctx, end - 3, end - (2 + r_size / 4));
+                }
+            }
+        } else if (already && ds_sort_partial_insertion(ctx, begin, pivot) &&
+                   ds_sort_partial_insertion(ctx, pivot + 1, end)) {
+            return;
+        }
+
+        ds_pdqsort(ctx, begin, pivot, bad_allowed, leftmost);
+        begin = pivot + 1;
+        leftmost = FALSE;
+    }
+}
+
+static void ds_sort_elements(UINT8 *base, UINT32 n, size_t es, DSCompare cmp, void *arg)
+{
+    struct DSSortCtx ctx;
+    INT32 log2n = 0;
+
+    if (n < 2) {
+        return;
+    }
+    ctx.base = base;
+    ctx.es = es;
+    ctx.cmp = cmp;
+    ctx.arg = arg;
+    while ((n >> log2n) > 1) {
+        ++log2n;
+    }
+    ds_pdqsort(&ctx, 0, n, log2n, TRUE);
+}
+
+UINT32 ds_vector_sort(struct DSVector *vec, UINT32 elem_size, DSCompare cmp, void *arg)
+{
+    if (!vec || !cmp || elem_size == 0 || vec->size % elem_size || vec->size / elem_size > 0xFFFFFFFFu) {
         return 0;
     }
+    ds_vector_changed(vec, 0);
+    ds_sort_elements(vec->data, (UINT32)(vec->size / elem_size), elem_size, cmp, arg);
+    return (UINT32)(vec->size / elem_size);
+}
+
+#define DS_KEY_COMPARE(TYPE, NAME)                                  \
+    static INT32 NAME(const void *a, const void *b, void *arg)     \
+    {                                                               \
+        TYPE x, y;                                                  \
+        (void)arg;                                                  \
+        memcpy(&x, a, sizeof(x));                                   \
+        memcpy(&y, b, sizeof(y));                                   \
+        return x < y ? -1 : x > y;                                  \
+    }
 
-    return ds_vector_append(dest, src->data, src->size);
+DS_KEY_COMPARE(UINT8, ds_key_compare8)
+DS_KEY_COMPARE(UINT16, ds_key_compare16)
+DS_KEY_COMPARE(UINT32, ds_key_compare32)
+DS_KEY_COMPARE(UINT64, ds_key_compare64)
+
+/* one counting pass per key byte; histograms for every byte come from a single read */
+#define DS_RADIX_SORT(TYPE)                                                         \
+    {                                                                               \
+        TYPE *src = (TYPE *)data, *dst = (TYPE *)scratch, *tmp, key;                \
+        UINT32 digit, i, sum, c;                                                    \
+        memset(hist, 0, sizeof(hist));                                              \
+        for (i = 0; i < n; ++i) {                                                   \
+            key = src[i];                                                           \
+            for (digit = 0; digit < sizeof(TYPE); ++digit) {                        \
+                ++hist[digit][(key >> (8 * digit)) & 0xFF];                         \
+            }                                                                       \
+        }                                                                           \
+        for (digit = 0; digit < sizeof(TYPE); ++digit) {                            \
+            UINT32 *count = hist[digit];                                            \
+            if (count[(src[0] >> (8 * digit)) & 0xFF] == n) {                       \
+                continue;                                                           \
+            }                                                                       \
+            for (sum = 0, i = 0; i < 256; ++i) {                                    \
+                c = count[i];                                                       \
+                count[i] = sum;                                                     \
+                sum += c;                                                           \
+            }                                                                       \
+            for (i = 0; i < n; ++i) {                                               \
+                key = src[i];                                                       \
+                dst[count[(key >> (8 * digit)) & 0xFF]++] = key;                    \
+            }                                                                       \
+            tmp = src;                                                              \
+            src = dst;                                                              \
+            dst = tmp;                                                              \
+        }                                                                           \
+        if ((UINT8 *)src != data) {                                                 \
+            memcpy(data, src, (size_t)n * sizeof(TYPE));                            \
+        }                                                                           \
+    }
+
+/* radix sorts n keys of key_size bytes using scratch of the same size */
+static void ds_radix_sort(UINT8 *data, UINT8 *scratch, UINT32 n, UINT32 key_size)
+{
+    UINT32 hist[8][256];
+
+    switch (key_size) {
+    case 2:
+        DS_RADIX_SORT(UINT16)
+        break;
+    case 4:
+        DS_RADIX_SORT(UINT32)
+        break;
+    case 8:
+        DS_RADIX_SORT(UINT64)
+        break;
+    }
 }
 
-UINT32 ds_vector_sprintf(struct DSVector *dest, const char* format, ...) {
-    UINT32 size = 0, actually_size = 0;
-    va_list arg;
-    va_start(arg, format);
-    size = vsnprintf(NULL, 0, format, arg);
-    if (!ds_vector_maybe_expand(dest, size)) {
+/* counting sort for single-byte keys, in place */
+static void ds_count_sort8(UINT8 *data, UINT32 n)
+{
+    UINT32 count[256], i;
+    memset(count, 0, sizeof(count));
+    for (i = 0; i < n; ++i) {
+        ++count[data[i]];
+    }
+    for (i = 0; i < 256; ++i) {
+        memset(data, (int)i, count[i]);
+        data += count[i];
+    }
+}
+
+DSCompare ds_vector_key_compare(UINT32 key_size)
+{
+    switch (key_size) {
+    case 1:
+        return ds_key_compare8;
+    case 2:
+        return ds_key_compare16;
+    case 4:
+        return ds_key_compare32;
+    case 8:
+        return ds_key_compare64;
+    default:
+        return NULL;
+    }
+}
+
+/* sorts n keys, radix when scratch is given and n is large enough */
+static void ds_sort_keys(UINT8 *data, UINT8 *scratch, UINT32 n, UINT32 key_size)
+{
+    if (key_size == 1) {
+        ds_count_sort8(data, n);
+    } else if (n < DS_RADIX_MIN || !scratch) {
+        ds_sort_elements(data, n, key_size, ds_vector_key_compare(key_size), NULL);
+    } else {
+        ds_radix_sort(data, scratch, n, key_size);
+    }
+}
+
+void ds_sort_range(UINT8 *data, UINT32 count, UINT32 elem_size, DSCompare cmp, void *arg, UINT8 *scratch)
+{
+    if (!data || elem_size == 0) {
+        return;
+    }
+    if (cmp) {
+        ds_sort_elements(data, count, elem_size, cmp, arg);
+    } else if (ds_vector_key_compare(elem_size)) {
+        ds_sort_keys(data, scratch, count, elem_size);
+    }
+}
+
+UINT32 ds_vector_sort_keys(struct DSVector *vec, UINT32 key_size)
+{
+    UINT32 n;
+    UINT8 *scratch = NULL;
+
+    if (!vec || !ds_vector_key_compare(key_size) || vec->size % key_size || vec->size / key_size > 0xFFFFFFFFu) {
         return 0;
     }
-    va_start(arg, format);
-    actually_size = vsnprintf((char *)&dest->data[dest->size], size + 1, format, arg);
-    dest->size += actually_size;
-    return actually_size;
-}
\ No newline at end of file
+    n = (UINT32)(vec->size / key_size);
+    if (key_size > 1 && n >= DS_RADIX_MIN) {
+        scratch = (UINT8 *)malloc(vec->size);
+    }
+    ds_vector_changed(vec, 0);
+    ds_sort_keys(vec->data, scratch, n, key_size);
+    free(scratch);
+    return n;
+}
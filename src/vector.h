@@ -6,19 +6,91 @@
 #include <stdio.h>
 //#include "include/mys_include.h"
 typedef unsigned char UINT8;
+typedef unsigned short UINT16;
 typedef int INT32;
 typedef unsigned int UINT32;
+typedef unsigned long long UINT64;
+typedef long long INT64;
 typedef char MYBOOL;
 
+/*
+ * Width of vector sizes, capacities and offsets. 32 bits by default for
+ * small-object density; build with -DDS_VECTOR_WIDE for vectors past 4GB.
+ */
+#ifdef DS_VECTOR_WIDE
+typedef UINT64 DSSize;
+#else
+typedef UINT32 DSSize;
+#endif
+#define DS_SIZE_MAX ((DSSize)-1)
+
 #define E_NO_MEM 101
 #define TRUE    1
 #define FALSE   0
 /* some private constants for vector tuning */
 
+/* per-vector counters, collected only when built with -DDS_VECTOR_STATS */
+struct DSVectorStats {
+    UINT64 grows;               /* storage reallocations */
+    UINT64 bytes_moved;         /* bytes copied by reallocation and by shifting on insert/erase */
+    UINT64 sprintf_remeasures;  /* ds_vector_sprintf calls that did not fit the spare capacity */
+    UINT64 shrinks;             /* capacity reductions by ds_vector_shrink_to_fit or DS_VECTOR_AUTO_SHRINK */
+    DSSize peak_size;
+    DSSize peak_capacity;
+};
+
 struct DSVector {
-    UINT32 size;
-    UINT32 capacity;
+    DSSize size;
+    DSSize capacity;
     UINT8* data;
+    UINT32 flags;
+    UINT32 crc;         /* CRC32C of data[0, crc_size) */
+    DSSize crc_size;
+    DSSize ascii_size;  /* data[0, ascii_size) is ASCII */
+    DSSize utf8_size;   /* data[0, utf8_size) is valid UTF-8 ending on a character boundary */
+    struct DSPregrow* pregrow;  /* background growth state, DS_VECTOR_PREGROW only */
+    struct DSMigration* migration;  /* incremental growth state, DS_VECTOR_INCREMENTAL only */
+#ifdef DS_VECTOR_STATS
+    struct DSVectorStats stats;
+#endif
+#ifdef DS_VECTOR_TELEMETRY
+    struct DSVectorSite* site;  /* creation call site */
+    struct DSVector* site_prev;
+    struct DSVector* site_next;
+#endif
+};
+
+/* element comparator: negative, zero or positive like qsort, arg is passed through */
+typedef INT32 (*DSCompare)(const void* a, const void* b, void* arg);
+
+/* element predicate used by ds_vector_erase_if */
+typedef MYBOOL (*DSPredicate)(const UINT8* elem, void* arg);
+
+/* vector flags */
+#define DS_VECTOR_RUNNING_CRC 0x1   /* keep a running CRC32C as bytes are appended */
+#define DS_VECTOR_ALIGN_32    0x2   /* data is 32-byte aligned, also after growth */
+#define DS_VECTOR_ALIGN_64    0x4   /* data is 64-byte aligned, also after growth */
+#define DS_VECTOR_HUGE_PAGES  0x8   /* storage of 2MB and up is 2MB aligned and madvise(MADV_HUGEPAGE)d */
+#define DS_VECTOR_AUTO_SHRINK 0x10  /* give back capacity once the size drops below a quarter of it */
+#define DS_VECTOR_PREFAULT    0x20  /* fault in new capacity when it is allocated, not on first write */
+#define DS_VECTOR_LOCKED      0x40  /* page aligned storage pinned with mlock */
+#define DS_VECTOR_PREGROW     0x80  /* copy into the next block on a helper thread ahead of growth */
+#define DS_VECTOR_INCREMENTAL 0x100 /* move the contents into a grown block a piece per append */
+#define DS_VECTOR_MAPPED      0x200 /* data is a private file mapping, see ds_vector_create_mapped */
+#define DS_VECTOR_STORAGE_FLAGS (DS_VECTOR_ALIGN_32 | DS_VECTOR_ALIGN_64 | DS_VECTOR_HUGE_PAGES | \
+                                 DS_VECTOR_AUTO_SHRINK | DS_VECTOR_PREFAULT | DS_VECTOR_LOCKED | \
+                                 DS_VECTOR_PREGROW | DS_VECTOR_INCREMENTAL)
+
+/* returned by the search functions when nothing matches */
+#define DS_VECTOR_NPOS DS_SIZE_MAX
+
+/**
+ * A read-only window into vector bytes. Views do not own their data and
+ * are invalidated by any call that may grow or modify the vector.
+ */
+struct DSVectorView {
+    const UINT8* data;
+    DSSize size;
 };
 
 /**
@@ -26,13 +98,81 @@ struct DSVector {
  * ds_vector_free or ds_vector_free_no_data will need to be called
  * when done with the vector to avoid memory leaks.
  */
-struct DSVector *ds_vector_create(UINT32 capacity, float expand_ratio);
+struct DSVector *ds_vector_create(DSSize capacity, float expand_ratio);
+
+/**
+ * Creates a vector like ds_vector_create with storage flags
+ * (DS_VECTOR_ALIGN_32, DS_VECTOR_ALIGN_64, DS_VECTOR_HUGE_PAGES,
+ * DS_VECTOR_AUTO_SHRINK, DS_VECTOR_PREFAULT, DS_VECTOR_LOCKED).
+ * Aligned storage grows by copying instead of realloc.
+ * With DS_VECTOR_PREFAULT or DS_VECTOR_LOCKED the page faults of new
+ * capacity are taken by the call that allocates it; pair them with
+ * ds_vector_reserve to keep faults off the append path entirely.
+ * When mlock is refused (see RLIMIT_MEMLOCK) DS_VECTOR_LOCKED is
+ * replaced by DS_VECTOR_PREFAULT in the vector's flags.
+ * With DS_VECTOR_PREGROW a vector of 1MB and up allocates its next block
+ * once 3/4 full and a library thread copies the data over in the
+ * background, so the append that fills the vector only copies the
+ * bytes written since and swaps blocks. Such a vector must not be used
+ * from several threads at once, and writes through vec->data must be
+ * announced with ds_vector_modified before they happen.
+ * DS_VECTOR_INCREMENTAL does the same without a thread: growth of a
+ * vector of 1MB and up switches to the new block at once and moves the
+ * old contents over a bounded piece per later append, so no append
+ * copies the whole vector. While a move is pending only the bytes from
+ * the size at growth on are in vec->data; read through ds_vector_at or
+ * call ds_vector_settle first. Library functions settle as needed.
+ * DS_VECTOR_PREGROW takes precedence when both are given.
+ */
+struct DSVector *ds_vector_create_flags(DSSize capacity, float expand_ratio, UINT32 flags);
 
 /**
  * Creates a vector with the given capacity.
  * (N.B. This vector will still automatically increase in size if necessary.)
  */
-struct DSVector *ds_vector_create_capacity(UINT32 capacity);
+struct DSVector *ds_vector_create_capacity(DSSize capacity);
+
+/**
+ * Creates a vector like ds_vector_create_flags and records file:line as
+ * its creation site for the telemetry registry. expand_ratio < 0 keeps
+ * the current ratio. With DS_VECTOR_TELEMETRY defined the create
+ * functions become macros that pass __FILE__ and __LINE__ here.
+ */
+struct DSVector *ds_vector_create_at(DSSize capacity, float expand_ratio, UINT32 flags, const char* file, INT32 line);
+
+#ifdef DS_VECTOR_TELEMETRY
+#define ds_vector_create(capacity, expand_ratio) \
+    ds_vector_create_at((capacity), (expand_ratio), 0, __FILE__, __LINE__)
+#define ds_vector_create_flags(capacity, expand_ratio, flags) \
+    ds_vector_create_at((capacity), (expand_ratio), (flags), __FILE__, __LINE__)
+#define ds_vector_create_capacity(capacity) \
+    ds_vector_create_at((capacity), -1, 0, __FILE__, __LINE__)
+#endif
+
+/**
+ * Writes the telemetry registry, one entry per creation site with live
+ * vectors, live bytes (capacity), slack bytes (capacity - size), growth
+ * events and vectors created, as text or JSON. Returns the number of
+ * sites written, -1 on error or when built without DS_VECTOR_TELEMETRY.
+ */
+INT32 ds_vector_telemetry_dump(const char* path, MYBOOL json);
+INT32 ds_vector_telemetry_dump_fd(int fd, MYBOOL json);
+
+/**
+ * Installs a handler that dumps the registry to path whenever signo is
+ * delivered. The dump is async-signal-safe; path must stay valid.
+ */
+MYBOOL ds_vector_telemetry_on_signal(INT32 signo, const char* path, MYBOOL json);
+
+/**
+ * Creates a vector over a private (copy-on-write) mapping of capacity
+ * bytes at data, holding size bytes, and takes ownership of it. The
+ * mapping must come from mmap(MAP_PRIVATE) with exactly that length,
+ * and size < capacity. Writes stay in the process; the first growth or
+ * shrink_to_fit moves the contents to the heap and unmaps the pages.
+ * Returns NULL on bad arguments or no memory, leaving the mapping alone.
+ */
+struct DSVector *ds_vector_create_mapped(UINT8* data, DSSize size, DSSize capacity);
 
 /**
  * Free's a vector AND its data.
@@ -42,18 +182,289 @@ void ds_vector_free(struct DSVector *vec);
  * Adds an element to the end of a vector.
  * Runs in constant time.
  */
-UINT32 ds_vector_append(struct DSVector *vec, UINT8* data, UINT32 length);
+DSSize ds_vector_append(struct DSVector *vec, UINT8* data, DSSize length);
+
+/**
+ * Sets the size of a vector to size bytes, growing the storage when
+ * needed. New bytes are left uninitialized. Returns the new size.
+ */
+DSSize ds_vector_resize(struct DSVector *vec, DSSize size);
+
+/**
+ * Grows the storage so the vector can reach capacity bytes without
+ * reallocating. Never shrinks. Returns the new capacity, 0 on failure.
+ */
+DSSize ds_vector_reserve(struct DSVector *vec, DSSize capacity);
+
+/**
+ * Finishes a pending DS_VECTOR_INCREMENTAL move, so all of vec->data is
+ * valid. Never changes vec->data itself.
+ */
+void ds_vector_settle(struct DSVector *vec);
+
+/**
+ * Returns the address of byte pos, also while a DS_VECTOR_INCREMENTAL
+ * move is pending, or NULL when pos is past the size. Valid until the
+ * next call that may grow or modify the vector.
+ */
+UINT8* ds_vector_at(struct DSVector *vec, DSSize pos);
+
+/**
+ * Empties the vector and keeps its capacity for reuse.
+ */
+void ds_vector_clear(struct DSVector *vec);
+
+/**
+ * Reallocates the storage down to the current size (plus the spare
+ * byte). Returns FALSE when the reallocation fails; vec is unchanged.
+ */
+MYBOOL ds_vector_shrink_to_fit(struct DSVector *vec);
 
 /**
  * Places an element at index i, and shifts the rest of the vector
  * to the right by one. If index == size of vector, then the element
  * will be appended to the end of the vector.
  */
-UINT32 ds_vector_insert(struct DSVector *vec, UINT32 index, UINT8* data, UINT32 length);
+DSSize ds_vector_insert(struct DSVector *vec, DSSize index, UINT8* data, DSSize length);
+
+/**
+ * Removes length bytes starting at pos, moving the tail down with one
+ * memmove. length is clipped to the end of the vector.
+ * Returns the number of bytes removed.
+ */
+DSSize ds_vector_erase(struct DSVector *vec, DSSize pos, DSSize length);
+
+/**
+ * Replaces the length bytes at pos with new_length bytes from data,
+ * growing the vector at most once and moving the tail with one memmove.
+ * data must not point into vec. Returns TRUE on success.
+ */
+MYBOOL ds_vector_replace(struct DSVector *vec, DSSize pos, DSSize length, UINT8* data, DSSize new_length);
 
-UINT32 ds_vector_concat(struct DSVector *dest, struct DSVector *src);
+/**
+ * Removes every element of elem_size bytes for which pred returns TRUE,
+ * keeping the order of the rest. Each run of kept elements is moved
+ * once. Returns the number of elements removed.
+ */
+DSSize ds_vector_erase_if(struct DSVector *vec, UINT32 elem_size, DSPredicate pred, void* arg);
+
+DSSize ds_vector_concat(struct DSVector *dest, struct DSVector *src);
+
+/**
+ * Appends the contents of n vectors to dest, growing dest at most once.
+ * NULL entries are skipped; dest must not be one of the sources.
+ * Returns the number of bytes appended, 0 on failure (dest unchanged).
+ */
+DSSize ds_vector_concat_many(struct DSVector *dest, struct DSVector **srcs, UINT32 n);
 
 UINT32 ds_vector_sprintf(struct DSVector *dest, const char* format, ...);
 
+/**
+ * Returns a view of at most length bytes starting at pos.
+ * The view is clamped to the vector size; an empty view has data == NULL.
+ */
+struct DSVectorView ds_vector_view(struct DSVector *vec, DSSize pos, DSSize length);
+
+/**
+ * Returns the offset of the first byte equal to byte at or after from,
+ * or DS_VECTOR_NPOS. Uses SSE2/AVX2 when the CPU supports it.
+ */
+DSSize ds_vector_find_byte(struct DSVector *vec, DSSize from, UINT8 byte);
+
+/**
+ * Returns the offset of the last byte equal to byte before end,
+ * or DS_VECTOR_NPOS. Pass DS_VECTOR_NPOS as end to search the whole vector.
+ */
+DSSize ds_vector_rfind(struct DSVector *vec, DSSize end, UINT8 byte);
+
+/**
+ * Returns the offset of the first byte at or after from that is one of
+ * the set_len bytes in set, or DS_VECTOR_NPOS.
+ */
+DSSize ds_vector_find_any(struct DSVector *vec, DSSize from, const UINT8* set, UINT32 set_len);
+
+/**
+ * Returns the offset of the first occurrence of needle at or after from,
+ * or DS_VECTOR_NPOS. An empty needle matches at from.
+ */
+DSSize ds_vector_find_bytes(struct DSVector *vec, DSSize from, const UINT8* needle, UINT32 needle_len);
+
+/**
+ * CRC32C (Castagnoli) of the vector contents.
+ * Uses the SSE4.2 crc32 instruction when available.
+ */
+UINT32 ds_vector_crc32c(struct DSVector *vec);
+UINT32 ds_view_crc32c(struct DSVectorView view);
+
+/**
+ * Extends crc, the CRC32C of some preceding bytes (0 for none),
+ * with length more bytes.
+ */
+UINT32 ds_crc32c_update(UINT32 crc, const UINT8* data, DSSize length);
+
+/**
+ * Returns the heap bytes held by vec: the vector struct plus its data
+ * block, including allocator rounding (malloc_usable_size on glibc,
+ * unless built with -DDS_VECTOR_NO_USABLE_SIZE for a replacement allocator).
+ * A mapped data block counts as its capacity.
+ */
+UINT64 ds_vector_memory_usage(struct DSVector *vec);
+
+/**
+ * Hands the physical pages of the unused capacity back to the kernel
+ * with madvise(MADV_DONTNEED). The address range and the capacity are
+ * kept, so growing into it later needs no reallocation, only fresh zero
+ * pages. Meant for large buffers going idle, e.g. after ds_vector_clear.
+ * Returns the number of bytes released, 0 outside Linux.
+ */
+DSSize ds_vector_release_idle(struct DSVector *vec);
+
+/**
+ * Copies the counters of vec to out. Returns FALSE (and zeroes out)
+ * when the library was built without DS_VECTOR_STATS.
+ */
+MYBOOL ds_vector_stats(struct DSVector *vec, struct DSVectorStats *out);
+
+/**
+ * Turns the running CRC32C on or off. While on, ds_vector_append and
+ * ds_vector_sprintf fold new bytes into the checksum as they arrive.
+ * Operations that rewrite existing bytes (such as inserting before the
+ * end) discard it, and it is rebuilt on the next read.
+ */
+void ds_vector_track_crc32c(struct DSVector *vec, MYBOOL enable);
+
+/**
+ * Returns the CRC32C of the whole vector. With running CRC on this is
+ * O(1) after appends; only bytes not yet covered are hashed.
+ * Call ds_vector_modified after writing through vec->data.
+ */
+UINT32 ds_vector_running_crc32c(struct DSVector *vec);
+
+/**
+ * Returns TRUE when every byte of the vector is below 0x80. The checked
+ * prefix is remembered, so after appends only the new bytes are scanned.
+ * Uses SSE2/AVX2 when the CPU supports it.
+ */
+MYBOOL ds_vector_is_ascii(struct DSVector *vec);
+MYBOOL ds_view_is_ascii(struct DSVectorView view);
+
+/**
+ * Returns TRUE when the vector holds well-formed UTF-8: no overlong
+ * forms, surrogates, code points past U+10FFFF or cut-off sequences.
+ * Like ds_vector_is_ascii it remembers the prefix already checked, up to
+ * the last whole character, so validating after each append costs only
+ * the appended bytes. Uses SSSE3/AVX2 when the CPU supports it.
+ * Call ds_vector_modified after writing through vec->data.
+ */
+MYBOOL ds_vector_validate_utf8(struct DSVector *vec);
+MYBOOL ds_view_validate_utf8(struct DSVectorView view);
+
+/**
+ * Tells the vector that bytes from pos on were rewritten through
+ * vec->data, so derived state such as the running CRC or the validated
+ * UTF-8 prefix is refreshed.
+ * Vectors created with DS_VECTOR_PREGROW need the call before the writes.
+ */
+void ds_vector_modified(struct DSVector *vec, DSSize pos);
+
+/**
+ * Appends a compressed frame of src to dst and returns its size, or 0.
+ * level runs from 1 (fastest) to 9 (smallest output); other values are
+ * clamped to that range. dst is grown at most once, to the worst-case
+ * frame size.
+ */
+DSSize ds_vector_compress(struct DSVector *dst, struct DSVector *src, INT32 level);
+
+/**
+ * Appends the decompressed contents of the frame held in src to dst and
+ * returns the number of bytes added. Returns 0 and leaves dst->size
+ * unchanged when the frame is malformed or fails its checksum.
+ * dst is grown at most once.
+ */
+DSSize ds_vector_decompress(struct DSVector *dst, struct DSVector *src);
+
+/**
+ * Appends the lowercase hex encoding of data (2 characters per byte)
+ * and returns the number of characters added.
+ */
+UINT32 ds_vector_append_hex(struct DSVector *vec, const UINT8* data, UINT32 length);
+
+/**
+ * Appends the bytes encoded by length hex characters (either case).
+ * text must not point into vec.
+ * Returns the number of bytes added, or 0 with vec unchanged when the
+ * text has odd length or a non-hex character.
+ */
+UINT32 ds_vector_decode_hex(struct DSVector *vec, const UINT8* text, UINT32 length);
+
+/**
+ * Appends the padded base64 (RFC 4648) encoding of data and returns
+ * the number of characters added.
+ */
+UINT32 ds_vector_append_base64(struct DSVector *vec, const UINT8* data, UINT32 length);
+
+/**
+ * Appends the bytes encoded by padded base64 text (not pointing into
+ * vec). Returns the number
+ * of bytes added, or 0 with vec unchanged on malformed input.
+ */
+UINT32 ds_vector_decode_base64(struct DSVector *vec, const UINT8* text, UINT32 length);
+
+/**
+ * Sorts the vector contents in place as an array of unsigned integers
+ * of key_size bytes (1, 2, 4 or 8) in native byte order.
+ * Uses an LSD radix sort with a scratch buffer the size of the vector,
+ * or a comparison sort when the scratch cannot be allocated.
+ * Returns the number of keys, 0 if the size is not a multiple of key_size
+ * or there are more than 0xFFFFFFFF keys.
+ */
+UINT32 ds_vector_sort_keys(struct DSVector *vec, UINT32 key_size);
+
+/**
+ * Sorts the vector contents in place as elements of elem_size bytes
+ * ordered by cmp, using pattern-defeating quicksort (not stable,
+ * O(n log n) worst case, linear on sorted and reversed runs).
+ * Returns the number of elements, 0 if the size is not a multiple of elem_size
+ * or there are more than 0xFFFFFFFF elements.
+ */
+UINT32 ds_vector_sort(struct DSVector *vec, UINT32 elem_size, DSCompare cmp, void* arg);
+
+/**
+ * Sorts count elements of elem_size bytes at data. With cmp == NULL the
+ * elements are unsigned integer keys as for ds_vector_sort_keys, and
+ * scratch (count * elem_size bytes, may be NULL) enables the radix sort.
+ * Allocates nothing, so it may run on any thread.
+ */
+void ds_sort_range(UINT8* data, UINT32 count, UINT32 elem_size, DSCompare cmp, void* arg, UINT8* scratch);
+
+/**
+ * Returns the comparator ds_vector_sort_keys uses for key_size byte
+ * keys, or NULL when key_size is not 1, 2, 4 or 8.
+ */
+DSCompare ds_vector_key_compare(UINT32 key_size);
+
+/* streaming compressor state, see ds_vector_compress_begin */
+struct DSCompressStream {
+    INT32 level;
+    UINT32 crc;
+    UINT64 raw_size;
+};
+
+/**
+ * Streaming compression: begin writes a frame header to dst, each write
+ * appends the blocks for one chunk of input and end closes the frame.
+ * The result is read back with ds_vector_decompress.
+ */
+UINT32 ds_vector_compress_begin(struct DSCompressStream *stream, struct DSVector *dst, INT32 level);
+UINT32 ds_vector_compress_write(struct DSCompressStream *stream, struct DSVector *dst, const UINT8* data, UINT32 length);
+UINT32 ds_vector_compress_end(struct DSCompressStream *stream, struct DSVector *dst);
+
+/**
+ * Fast non-cryptographic 64-bit hash of the vector contents.
+ * The result matches XXH64 with the same seed.
+ */
+UINT64 ds_vector_hash64(struct DSVector *vec, UINT64 seed);
+UINT64 ds_view_hash64(struct DSVectorView view, UINT64 seed);
+
 #endif
 